@@ -22,8 +22,16 @@
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Common/b2GrowableStack.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define B2_RAY_PACKET_SSE 1
+#include <emmintrin.h>
+#endif
+
 #define b2_nullNode (-1)
 
+/// The most rays that can be cast together with b2DynamicTree::RayCastPacket.
+#define b2_maxRayPacketSize 16
+
 /// A node in the dynamic tree. The client does not interact with this directly.
 struct b2TreeNode
 {
@@ -101,6 +109,17 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Ray-cast a packet of up to b2_maxRayPacketSize rays against the proxies in the tree.
+	/// The tree is walked once for the whole packet, and each node's AABB is tested against
+	/// every ray still inside its parent at the same time, so this is much cheaper than
+	/// separate RayCast calls when the rays are coherent (e.g. neighbouring screen columns).
+	/// The callback is called as RayCastCallback(input, proxyId, rayIndex) and its return
+	/// value is treated the same way as RayCast's, but only for the ray at rayIndex.
+	/// @param inputs the ray-cast input data for each ray in the packet.
+	/// @param count the number of rays, at most b2_maxRayPacketSize.
+	template <typename T>
+	void RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const;
+
 	/// Validate this tree. For testing.
 	void Validate() const;
 
@@ -286,4 +305,184 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 	}
 }
 
+/// Structure-of-arrays form of a ray packet, padded out to a multiple of 4 rays.
+struct b2RayPacket
+{
+	/// Returns a bit mask of the rays in activeMask that pass through aabb before
+	/// reaching their max fraction.
+	uint32 TestOverlap(const b2AABB& aabb, uint32 activeMask) const;
+
+	float32 p1x[b2_maxRayPacketSize];
+	float32 p1y[b2_maxRayPacketSize];
+	float32 invDx[b2_maxRayPacketSize];
+	float32 invDy[b2_maxRayPacketSize];
+	float32 maxFraction[b2_maxRayPacketSize];
+	int32 groupCount;
+};
+
+inline uint32 b2RayPacket::TestOverlap(const b2AABB& aabb, uint32 activeMask) const
+{
+	uint32 hitMask = 0;
+
+#ifdef B2_RAY_PACKET_SSE
+	const __m128 lowerX = _mm_set1_ps(aabb.lowerBound.x);
+	const __m128 lowerY = _mm_set1_ps(aabb.lowerBound.y);
+	const __m128 upperX = _mm_set1_ps(aabb.upperBound.x);
+	const __m128 upperY = _mm_set1_ps(aabb.upperBound.y);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int32 group = 0; group < groupCount; ++group)
+	{
+		const int32 first = 4 * group;
+
+		if (((activeMask >> first) & 0xF) == 0)
+		{
+			continue;
+		}
+
+		const __m128 px = _mm_loadu_ps(p1x + first);
+		const __m128 py = _mm_loadu_ps(p1y + first);
+		const __m128 idx = _mm_loadu_ps(invDx + first);
+		const __m128 idy = _mm_loadu_ps(invDy + first);
+
+		// Slab test, in units of fraction along each ray.
+		const __m128 t1x = _mm_mul_ps(_mm_sub_ps(lowerX, px), idx);
+		const __m128 t2x = _mm_mul_ps(_mm_sub_ps(upperX, px), idx);
+		const __m128 t1y = _mm_mul_ps(_mm_sub_ps(lowerY, py), idy);
+		const __m128 t2y = _mm_mul_ps(_mm_sub_ps(upperY, py), idy);
+
+		const __m128 tEnter = _mm_max_ps(
+			_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), zero);
+		const __m128 tExit = _mm_min_ps(
+			_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_loadu_ps(maxFraction + first));
+
+		hitMask |= (uint32)_mm_movemask_ps(_mm_cmple_ps(tEnter, tExit)) << first;
+	}
+#else
+	for (int32 i = 0; i < 4 * groupCount; ++i)
+	{
+		if ((activeMask & (1u << i)) == 0)
+		{
+			continue;
+		}
+
+		const float32 t1x = (aabb.lowerBound.x - p1x[i]) * invDx[i];
+		const float32 t2x = (aabb.upperBound.x - p1x[i]) * invDx[i];
+		const float32 t1y = (aabb.lowerBound.y - p1y[i]) * invDy[i];
+		const float32 t2y = (aabb.upperBound.y - p1y[i]) * invDy[i];
+
+		const float32 tEnter = b2Max(b2Max(b2Min(t1x, t2x), b2Min(t1y, t2y)), 0.0f);
+		const float32 tExit = b2Min(b2Min(b2Max(t1x, t2x), b2Max(t1y, t2y)), maxFraction[i]);
+
+		if (tEnter <= tExit)
+		{
+			hitMask |= 1u << i;
+		}
+	}
+#endif
+
+	return hitMask & activeMask;
+}
+
+template <typename T>
+inline void b2DynamicTree::RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const
+{
+	b2Assert(0 < count && count <= b2_maxRayPacketSize);
+
+	// A direction component of zero would give an infinite inverse, and inf * 0 is NaN,
+	// so use a huge finite value instead.
+	const float32 hugeInverse = 1e30f;
+
+	b2RayPacket packet;
+	packet.groupCount = (count + 3) / 4;
+
+	for (int32 i = 0; i < 4 * packet.groupCount; ++i)
+	{
+		if (i < count)
+		{
+			const b2Vec2 d = inputs[i].p2 - inputs[i].p1;
+			b2Assert(d.LengthSquared() > 0.0f);
+
+			packet.p1x[i] = inputs[i].p1.x;
+			packet.p1y[i] = inputs[i].p1.y;
+			packet.invDx[i] = d.x != 0.0f ? 1.0f / d.x : (d.x < 0.0f ? -hugeInverse : hugeInverse);
+			packet.invDy[i] = d.y != 0.0f ? 1.0f / d.y : (d.y < 0.0f ? -hugeInverse : hugeInverse);
+			packet.maxFraction[i] = inputs[i].maxFraction;
+		}
+		else
+		{
+			packet.p1x[i] = 0.0f;
+			packet.p1y[i] = 0.0f;
+			packet.invDx[i] = hugeInverse;
+			packet.invDy[i] = hugeInverse;
+			packet.maxFraction[i] = 0.0f;
+		}
+	}
+
+	// The rays that haven't been terminated by the callback.
+	uint32 activeMask = (1u << count) - 1;
+
+	struct StackEntry
+	{
+		int32 nodeId;
+		// The rays that passed through the node's parent.
+		uint32 rayMask;
+	};
+
+	b2GrowableStack<StackEntry, 256> stack;
+	stack.Push({ m_root, activeMask });
+
+	while (stack.GetCount() > 0 && activeMask != 0)
+	{
+		const StackEntry entry = stack.Pop();
+		if (entry.nodeId == b2_nullNode)
+		{
+			continue;
+		}
+
+		const b2TreeNode* node = m_nodes + entry.nodeId;
+
+		const uint32 hitMask = packet.TestOverlap(node->aabb, entry.rayMask & activeMask);
+
+		if (hitMask == 0)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			for (int32 i = 0; i < count; ++i)
+			{
+				if ((hitMask & activeMask & (1u << i)) == 0)
+				{
+					continue;
+				}
+
+				b2RayCastInput subInput;
+				subInput.p1 = inputs[i].p1;
+				subInput.p2 = inputs[i].p2;
+				subInput.maxFraction = packet.maxFraction[i];
+
+				float32 value = callback->RayCastCallback(subInput, entry.nodeId, i);
+
+				if (value == 0.0f)
+				{
+					// The client has terminated this ray.
+					activeMask &= ~(1u << i);
+				}
+				else if (value > 0.0f)
+				{
+					// Clip the ray.
+					packet.maxFraction[i] = value;
+				}
+			}
+		}
+		else
+		{
+			stack.Push({ node->child1, hitMask });
+			stack.Push({ node->child2, hitMask });
+		}
+	}
+}
+
 #endif
@@ -1,5 +1,7 @@
 #include "Game.h"
 
+#include <cmath>
+
 #include <SFML/Audio/Listener.hpp>
 #include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
@@ -14,6 +16,7 @@
 #include "Quiver/Input/RawInput.h"
 #include "Quiver/Input/InputDebug.h"
 #include "Quiver/Misc/ImGuiHelpers.h"
+#include "Quiver/Physics/PhysicsUtils.h"
 #include "Quiver/World/World.h"
 #include "Quiver/World/WorldContext.h"
 
@@ -53,15 +56,16 @@ Game::~Game() {}
 
 void Game::ProcessFrame()
 {
-	using namespace std::chrono_literals;
-
 	if (GetContext().WindowResized()) {
-		const auto newSize = GetContext().GetWindow().getSize();
-		mFrameTex->create(newSize.x, newSize.y);
+		FinishPipelinedFrame();
+		UpdateFrameTexture(
+			*mFrameTex,
+			GetContext().GetWindow().getSize(),
+			GetContext().GetFrameTextureResolutionRatio());
 	}
 
-	// Clamp excessively large delta times.
-	const float delta = std::min(mFrameClock.restart().asSeconds(), 1.0f / 30.0f);
+	// Clamp excessively large delta times, like after sitting at a breakpoint.
+	const float delta = std::min(mFrameClock.restart().asSeconds(), 0.25f);
 
 	mTimeSinceLastStep += std::chrono::duration<float>(delta);
 
@@ -71,18 +75,26 @@ void Game::ProcessFrame()
 		FreeControl(mDefaultCamera3D, delta);
 	}
 
-	if (mCamera2DFollowCamera3D)
-	{
-		const Camera3D& currentCamera3D = mWorld->GetMainCamera() ? *mWorld->GetMainCamera() : mDefaultCamera3D;
-		mCamera2D.SetPosition(currentCamera3D.GetPosition());
-	}
-
 	const auto timestep = mWorld->GetTimestep();
 
-	// Take a step if 1/60th of a second has passed.
-	if (mTimeSinceLastStep >= timestep)
+	// Take as many steps as the time gone by calls for, and keep what's left over for the
+	// next frame. If the steps themselves take too long to keep up, catching up would only 
+	// put the next frame further behind, so after so many the World is left to run slow.
+	const int MaxStepsPerFrame = 4;
+
+	int stepsTaken = 0;
+
+	while (mTimeSinceLastStep >= timestep)
 	{
-		mTimeSinceLastStep = 0.0s;
+		if (stepsTaken == MaxStepsPerFrame)
+		{
+			mTimeSinceLastStep = std::chrono::duration<float>(
+				std::fmod(mTimeSinceLastStep.count(), timestep.count()));
+			break;
+		}
+
+		mTimeSinceLastStep -= timestep;
+		stepsTaken++;
 
 		mMouse.OnStep();
 		mKeyboard.Update();
@@ -97,20 +109,41 @@ void Game::ProcessFrame()
 		if (!mPaused) {
 			qvr::RawInputDevices devices(mMouse, mKeyboard, mJoysticks);
 
+			RecordStepStartCamera();
+
 			mWorld->TakeStep(devices);
 		}
+	}
 
-		// Render World:
-		{
-			mFrameTex->clear(sf::Color(128, 128, 255));
+	// Draw the World part way between its last two steps, by however much of the next step's
+	// worth of time has gone by already, so that things move smoothly whatever the frame 
+	// rate. Nothing moves while it's paused.
+	const float alpha = mPaused ? 1.0f : std::min(mTimeSinceLastStep / timestep, 1.0f);
 
-			mWorld->Render3D(
-				*mFrameTex,
-				mWorld->GetMainCamera() ? *mWorld->GetMainCamera() : mDefaultCamera3D,
-				mWorldRaycastRenderer);
+	mWorld->SetRenderInterpolation(alpha);
 
-			mFrameTex->display();
-		}
+	UpdateInterpolatedCamera3D(alpha);
+
+	if (mCamera2DFollowCamera3D)
+	{
+		mCamera2D.SetPosition(mInterpolatedCamera3D.GetPosition());
+	}
+
+	// Render World:
+	if (mPipelinedRendering)
+	{
+		RenderPipelined(mInterpolatedCamera3D);
+	}
+	else
+	{
+		mFrameTex->clear(sf::Color(128, 128, 255));
+
+		mWorld->Render3D(
+			*mFrameTex,
+			mInterpolatedCamera3D,
+			mWorldRaycastRenderer);
+
+		mFrameTex->display();
 	}
 
 	mMouse.OnFrame();
@@ -143,7 +176,9 @@ void Game::ProcessFrame()
 
 	if (mWorld->GetNextWorld())
 	{
+		FinishPipelinedFrame();
 		mWorld = std::move(mWorld->GetNextWorld());
+		mStepStartCamera = nullptr;
 	}
 	
 	{
@@ -154,6 +189,106 @@ void Game::ProcessFrame()
 	}
 }
 
+const Camera3D& Game::GetCurrentCamera3D() const
+{
+	return mWorld->GetMainCamera() ? *mWorld->GetMainCamera() : mDefaultCamera3D;
+}
+
+void Game::RecordStepStartCamera()
+{
+	mStepStartCamera = mWorld->GetMainCamera();
+
+	if (mStepStartCamera) {
+		mStepStartCameraTransform.Set(
+			mStepStartCamera->GetPosition(), 
+			mStepStartCamera->GetRotation());
+	}
+}
+
+void Game::UpdateInterpolatedCamera3D(const float alpha)
+{
+	mInterpolatedCamera3D = GetCurrentCamera3D();
+
+	// Only if it's the camera that was moved by the last step, and not the free one.
+	if (mStepStartCamera == nullptr || mStepStartCamera != mWorld->GetMainCamera()) return;
+
+	const b2Transform interpolated = Physics::Interpolate(
+		mStepStartCameraTransform,
+		b2Transform(
+			mInterpolatedCamera3D.GetPosition(), 
+			b2Rot(mInterpolatedCamera3D.GetRotation())),
+		alpha);
+
+	mInterpolatedCamera3D.SetPosition(interpolated.p);
+	mInterpolatedCamera3D.SetRotation(interpolated.q.GetAngle());
+}
+
+void Game::RenderPipelined(const Camera3D& camera)
+{
+	// Captured while the last frame's snapshot is still being drawn from the other one.
+	const int snapshotIndex = mNextRenderSnapshot;
+
+	RenderSnapshot& snapshot = mRenderSnapshots[snapshotIndex];
+	WorldRaycastRenderer& renderer = mSnapshotRenderers[snapshotIndex];
+
+	snapshot.Capture(*mWorld, camera);
+
+	mNextRenderSnapshot = (mNextRenderSnapshot + 1) % (int)mRenderSnapshots.size();
+
+	FinishPipelinedFrame();
+
+	mInFlightRenderSnapshot = snapshotIndex;
+
+	if (!mBackFrameTex) {
+		mBackFrameTex = std::make_unique<sf::RenderTexture>();
+	}
+
+	if (mBackFrameTex->getSize() != mFrameTex->getSize()) {
+		// With a depth buffer, like mFrameTex, since the two are swapped every frame.
+		mBackFrameTex->create(mFrameTex->getSize().x, mFrameTex->getSize().y, true);
+	}
+
+	// It can only be active on one thread at a time.
+	mBackFrameTex->setActive(false);
+
+	mRenderThread.Start([this, &snapshot, &renderer]()
+	{
+		const auto renderStart = std::chrono::steady_clock::now();
+
+		mBackFrameTex->setActive(true);
+
+		mBackFrameTex->clear(sf::Color(128, 128, 255));
+
+		snapshot.Render(*mBackFrameTex, renderer);
+
+		mBackFrameTex->display();
+
+		mBackFrameTex->setActive(false);
+
+		mPipelinedRenderTime = std::chrono::steady_clock::now() - renderStart;
+	});
+
+	mFrameInFlight = true;
+}
+
+void Game::FinishPipelinedFrame()
+{
+	if (!mFrameInFlight) return;
+
+	mRenderThread.Wait();
+
+	mFrameInFlight = false;
+
+	std::swap(mFrameTex, mBackFrameTex);
+
+	mWorld->OnRendered3D(mSnapshotRenderers[mInFlightRenderSnapshot], mPipelinedRenderTime);
+
+	// The overlay can draw anything, so it's drawn here rather than on the render thread.
+	GetCurrentCamera3D().DrawOverlay(*mFrameTex);
+
+	mFrameTex->display();
+}
+
 void Game::OnTogglePause()
 {
 	auto log = spdlog::get("console");
@@ -213,12 +348,18 @@ void Game::ProcessGui()
 			// Reload the World back to the state it was in when we entered Game mode.
 			auto newWorld = std::make_unique<World>(GetContext().GetWorldContext(), mWorldJson);
 
+			FinishPipelinedFrame();
+
 			mWorld.swap(newWorld);
 		}
 		catch (std::exception e)
 		{
+			FinishPipelinedFrame();
+
 			mWorld = std::make_unique<World>(GetContext().GetWorldContext());
 		}
+
+		mStepStartCamera = nullptr;
 	}
 
 	if (ImGui::CollapsingHeader("Options")) {
@@ -231,6 +372,13 @@ void Game::ProcessGui()
 					GetContext().GetFrameTextureResolutionRatio());
 			}
 		}
+		{
+			if (ImGui::Checkbox("Pipelined Rendering", &mPipelinedRendering)) {
+				if (!mPipelinedRendering) {
+					FinishPipelinedFrame();
+				}
+			}
+		}
 		{
 			float currentVolume = sf::Listener::getGlobalVolume();
 			if (ImGui::SliderFloat("Global Volume", &currentVolume, 0.0f, 100.0f)) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <chrono>
 
 #include "SFML/System/Clock.hpp"
@@ -7,10 +8,12 @@
 #include "Quiver/Application/ApplicationState.h"
 #include "Quiver/Graphics/Camera2D.h"
 #include "Quiver/Graphics/Camera3D.h"
+#include "Quiver/Graphics/RenderSnapshot.h"
 #include "Quiver/Graphics/WorldRaycastRenderer.h"
 #include "Quiver/Input/SfmlJoystick.h"
 #include "Quiver/Input/SfmlKeyboard.h"
 #include "Quiver/Input/SfmlMouse.h"
+#include "Quiver/Misc/TaskThread.h"
 
 namespace sf {
 class RenderTexture;
@@ -39,6 +42,24 @@ private:
 	void OnTogglePause();
 	void ProcessGui();
 
+	const Camera3D& GetCurrentCamera3D() const;
+
+	// Remembers where the World's main camera is before a step, so that it can be drawn 
+	// part way through the step afterwards.
+	void RecordStepStartCamera();
+
+	// Sets mInterpolatedCamera3D to the current camera, alpha of the way from where it was at
+	// the start of the last step to where it is now.
+	void UpdateInterpolatedCamera3D(const float alpha);
+
+	// Captures a RenderSnapshot of the World as it is to be drawn this frame and starts 
+	// drawing it on mRenderThread, once the frame before has been finished.
+	void RenderPipelined(const Camera3D& camera);
+
+	// Waits for the frame mRenderThread is drawing, if there is one, and swaps it in.
+	// Has to be done before anything the snapshot shares with the World goes away.
+	void FinishPipelinedFrame();
+
 	bool mCamera2DFollowCamera3D = true;
 	bool mDrawOverhead = false;
 
@@ -52,6 +73,13 @@ private:
 
 	Camera3D mDefaultCamera3D;
 
+	// Compared with the World's main camera, never dereferenced, in case it's gone.
+	const Camera3D* mStepStartCamera = nullptr;
+	b2Transform mStepStartCameraTransform;
+
+	// What each frame is drawn from.
+	Camera3D mInterpolatedCamera3D;
+
 	sf::Clock mFrameClock;
 
 	std::chrono::duration<float> mTimeSinceLastStep = std::chrono::seconds(0);
@@ -60,9 +88,35 @@ private:
 
 	bool mPaused = false;
 
+	// With pipelined rendering, each frame's RenderSnapshot is drawn into mBackFrameTex on 
+	// mRenderThread while the main thread gets on with the next frame, and then swapped with
+	// mFrameTex. The frame on screen is always a frame behind the World.
+	bool mPipelinedRendering = false;
+
+	std::array<RenderSnapshot, 2> mRenderSnapshots;
+
+	// One for each snapshot, so that each can reuse the columns it cast from its own 
+	// snapshot last time round.
+	std::array<WorldRaycastRenderer, 2> mSnapshotRenderers;
+
+	int mNextRenderSnapshot = 0;
+
+	// The one mRenderThread is drawing.
+	int mInFlightRenderSnapshot = 0;
+
+	std::unique_ptr<sf::RenderTexture> mBackFrameTex;
+
+	bool mFrameInFlight = false;
+
+	// Written by mRenderThread.
+	std::chrono::duration<float, std::milli> mPipelinedRenderTime;
+
 	qvr::SfmlJoystickSet mJoysticks;
 	qvr::SfmlKeyboard mKeyboard;
 	qvr::SfmlMouse mMouse;
+
+	// Declared last so that it's destroyed, and waits for whatever it's drawing, first.
+	TaskThread mRenderThread;
 };
 
 }
\ No newline at end of file
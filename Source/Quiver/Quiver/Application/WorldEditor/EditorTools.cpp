@@ -340,6 +340,8 @@ void MoveTool::OnMouseMove(WorldEditor & editor, const Camera2D& camera, const s
 	b2Vec2 pos = camera.ScreenToWorld(b2Vec2((float)mouseInfo.x, (float)mouseInfo.y));
 
 	mBodyBeingMoved->SetTransform(pos, mBodyBeingMoved->GetAngle());
+
+	editor.GetWorld()->OnStaticGeometryChanged(*mBodyBeingMoved);
 }
 
 void MoveTool::OnCancel(WorldEditor & editor, const Camera2D& camera)
@@ -351,6 +353,8 @@ void MoveTool::OnCancel(WorldEditor & editor, const Camera2D& camera)
 	// Move the body back to its original position.
 	mBodyBeingMoved->SetTransform(mOriginalPos, mBodyBeingMoved->GetAngle());
 
+	editor.GetWorld()->OnStaticGeometryChanged(*mBodyBeingMoved);
+
 	mBodyBeingMoved = nullptr;
 }
 
@@ -389,6 +393,8 @@ void RotateTool::OnMouseMove(WorldEditor & editor, const Camera2D& camera, const
 	float angle = atan2f(pos.y - mOriginalPos.y, pos.x - mOriginalPos.x);
 
 	mBody->SetTransform(mBody->GetPosition(), angle);
+
+	editor.GetWorld()->OnStaticGeometryChanged(*mBody);
 }
 
 void RotateTool::OnCancel(WorldEditor & editor, const Camera2D& camera)
@@ -398,6 +404,8 @@ void RotateTool::OnCancel(WorldEditor & editor, const Camera2D& camera)
 	}
 
 	mBody->SetTransform(mBody->GetPosition(), mOriginalAngle);
+
+	editor.GetWorld()->OnStaticGeometryChanged(*mBody);
 }
 
 void CreateInstanceOfPrefabTool::DoGui(WorldEditor& editor)
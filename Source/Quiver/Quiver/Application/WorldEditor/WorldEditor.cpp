@@ -74,8 +74,10 @@ WorldEditor::~WorldEditor() {}
 void WorldEditor::ProcessFrame()
 {
 	if (GetContext().WindowResized()) {
-		const auto newSize = GetContext().GetWindow().getSize();
-		mFrameTex->create(newSize.x, newSize.y);
+		UpdateFrameTexture(
+			*mFrameTex,
+			GetContext().GetWindow().getSize(),
+			GetContext().GetFrameTextureResolutionRatio());
 	}
 
 	auto dt = frameClock.restart();
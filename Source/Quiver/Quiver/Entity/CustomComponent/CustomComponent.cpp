@@ -4,6 +4,7 @@
 #include <spdlog/fmt/fmt.h>
 
 #include "Quiver/Entity/Entity.h"
+#include "Quiver/Entity/CustomComponent/CustomComponentUpdater.h"
 #include "Quiver/World/World.h"
 
 namespace qvr {
@@ -15,12 +16,24 @@ CustomComponentType::CustomComponentType(
 	mFactoryFunc(factoryFunc)
 {}
 
+std::unique_ptr<CustomComponent>
+CustomComponentType::CreateInstance(Entity & entity)
+{
+	auto instance = mFactoryFunc(entity);
+
+	if (instance) {
+		instance->mParallelSafe = mParallelSafe;
+	}
+
+	return instance;
+}
+
 std::unique_ptr<CustomComponent>
 CustomComponentType::CreateInstance(
 	Entity & entity,
 	const nlohmann::json & j)
 {
-	auto instance = mFactoryFunc(entity);
+	auto instance = CreateInstance(entity);
 
 	if (instance) {
 		if (!instance->FromJson(j)) {
@@ -94,6 +107,16 @@ CustomComponent::~CustomComponent()
 	GetEntity().GetWorld().UnregisterCustomComponent(*this);
 }
 
+void CustomComponent::Defer(Command command)
+{
+	if (mDeferredCommands) {
+		mDeferredCommands->Push(std::move(command));
+	}
+	else {
+		command();
+	}
+}
+
 bool CustomComponentTypeLibrary::IsValid(const nlohmann::json& j) const
 {
 	auto log = spdlog::get("console");
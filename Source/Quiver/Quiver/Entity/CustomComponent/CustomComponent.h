@@ -9,6 +9,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include <function2.hpp>
 #include <json.hpp>
 
 class b2Fixture;
@@ -21,7 +22,9 @@ namespace qvr {
 
 class CustomComponentEditor;
 class CustomComponentType;
+class CustomComponentUpdater;
 class RawInputDevices;
+struct DeferredCommandBuffer;
 
 // This type of Component defines custom behaviour for its Entity.
 class CustomComponent : public Component {
@@ -40,6 +43,12 @@ public:
 	virtual bool FromJson(const nlohmann::json& j) { return true; }
 
 	// Override this with per-frame behaviour.
+	// If the component's type is parallel-safe (see CustomComponentType::SetParallelSafe),
+	// this is called on a worker thread at the same time as other parallel-safe components'
+	// OnStep. It may change this component's own state, and read what nobody changes while
+	// the parallel-safe components are stepped: the World, the physics bodies and the 
+	// components that aren't parallel-safe. It mustn't read other parallel-safe components,
+	// since they're being changed at the same time. Anything else has to go through Defer.
 	virtual void OnStep(const std::chrono::duration<float> deltaTime) {}
 
 	virtual void HandleInput(
@@ -56,12 +65,30 @@ public:
 
 	bool GetRemoveFlag() const { return mRemoveFlag; }
 
+	bool IsParallelSafe() const { return mParallelSafe; }
+
+	using Command = fu2::unique_function<void()>;
+
 protected:
 	// Signal to the World that this Entity should be removed.
 	void SetRemoveFlag(const bool removeFlag) { mRemoveFlag = removeFlag; }
 
+	// Calls command once every parallel-safe OnStep has returned, in the order the 
+	// components were registered with the World in, or straight away if this component isn't
+	// being stepped in parallel. For spawning and removing Entities, touching physics bodies
+	// and anything else that isn't this component's own.
+	void Defer(Command command);
+
 private:
+	friend class CustomComponentType;
+	friend class CustomComponentUpdater;
+
 	bool mRemoveFlag = false;
+
+	bool mParallelSafe = false;
+
+	// Set by the CustomComponentUpdater while OnStep is running on a worker thread.
+	DeferredCommandBuffer* mDeferredCommands = nullptr;
 };
 
 class CustomComponentEditor
@@ -99,17 +126,21 @@ public:
 	CustomComponentType& operator=(const CustomComponentType&) = delete;
 	CustomComponentType& operator=(const CustomComponentType&&) = delete;
 
-	std::unique_ptr<CustomComponent> CreateInstance(Entity& entity) {
-		return mFactoryFunc(entity);
-	}
+	std::unique_ptr<CustomComponent> CreateInstance(Entity& entity);
 
 	std::unique_ptr<CustomComponent> CreateInstance(Entity& entity, const nlohmann::json& j);
 
 	std::string GetName() const { return mName; };
 
+	// Declares that the OnStep of every instance created from now on can be run in parallel
+	// with the others' (see CustomComponent::OnStep). HandleInput is always called serially.
+	void SetParallelSafe(const bool parallelSafe) { mParallelSafe = parallelSafe; }
+	bool IsParallelSafe() const { return mParallelSafe; }
+
 private:
 	std::string mName;
 	std::function<std::unique_ptr<CustomComponent>(Entity&)> mFactoryFunc;
+	bool mParallelSafe = false;
 };
 
 class CustomComponentTypeLibrary {
@@ -1,13 +1,19 @@
 #include "CustomComponentUpdater.h"
 
 #include <algorithm>
+#include <iterator>
 
 #include "CustomComponent.h"
 
 #include "Quiver/Misc/FindByAddress.h"
+#include "Quiver/Misc/WorkerPool.h"
 
 namespace qvr {
 
+CustomComponentUpdater::CustomComponentUpdater() = default;
+
+CustomComponentUpdater::~CustomComponentUpdater() = default;
+
 void CustomComponentUpdater::Update(const std::chrono::duration<float> deltaTime, qvr::RawInputDevices& inputDevices)
 {
 	for (m_Index = 0; m_Index < (int)m_CustomComponents.size(); m_Index++)
@@ -15,14 +21,98 @@ void CustomComponentUpdater::Update(const std::chrono::duration<float> deltaTime
 		m_CustomComponents[m_Index].get().HandleInput(inputDevices, deltaTime);
 	}
 
+	m_Index = -1;
+
+	StepParallelSafe(deltaTime);
+
 	for (m_Index = 0; m_Index < (int)m_CustomComponents.size(); m_Index++)
 	{
-		m_CustomComponents[m_Index].get().OnStep(deltaTime);
+		CustomComponent& customComponent = m_CustomComponents[m_Index].get();
+
+		if (customComponent.IsParallelSafe()) continue;
+
+		customComponent.OnStep(deltaTime);
 	}
 
 	m_Index = -1;
 }
 
+void CustomComponentUpdater::StepParallelSafe(const std::chrono::duration<float> deltaTime)
+{
+	m_ParallelSafeComponents.clear();
+
+	for (auto& customComponent : m_CustomComponents)
+	{
+		if (customComponent.get().IsParallelSafe()) {
+			m_ParallelSafeComponents.push_back(&customComponent.get());
+		}
+	}
+
+	if (m_ParallelSafeComponents.empty()) return;
+
+	if (!m_WorkerPool || m_WorkerPool->GetThreadCount() != (unsigned)m_ThreadCount) {
+		m_WorkerPool = std::make_unique<WorkerPool>((unsigned)m_ThreadCount);
+	}
+
+	m_DeferredCommands.resize(m_WorkerPool->GetThreadCount());
+
+	auto StepComponents = [this, deltaTime](const int begin, const int end, const int workerIndex)
+	{
+		DeferredCommandBuffer& commands = m_DeferredCommands[workerIndex];
+
+		for (int index = begin; index < end; index++)
+		{
+			CustomComponent& customComponent = *m_ParallelSafeComponents[index];
+
+			commands.m_CurrentOrder = index;
+
+			customComponent.mDeferredCommands = &commands;
+
+			customComponent.OnStep(deltaTime);
+
+			customComponent.mDeferredCommands = nullptr;
+		}
+	};
+
+	// Small chunks, since some components do a lot more than others.
+	const int ComponentsPerChunk = 16;
+
+	m_WorkerPool->ParallelFor((int)m_ParallelSafeComponents.size(), ComponentsPerChunk, StepComponents);
+
+	// Each component's commands all come from the same worker, already in the order they 
+	// were deferred in, so a stable sort puts them in the same order as stepping serially 
+	// would have.
+	m_OrderedCommands.clear();
+
+	for (auto& commands : m_DeferredCommands)
+	{
+		std::move(
+			commands.m_Entries.begin(),
+			commands.m_Entries.end(),
+			std::back_inserter(m_OrderedCommands));
+
+		commands.m_Entries.clear();
+	}
+
+	std::stable_sort(
+		m_OrderedCommands.begin(),
+		m_OrderedCommands.end(),
+		[](const auto& a, const auto& b) { return a.m_Order < b.m_Order; });
+
+	// The commands might remove components. Unregister leaves a null where they were, and
+	// the commands they deferred are skipped, since they'd be using what's been destroyed.
+	for (auto& entry : m_OrderedCommands)
+	{
+		if (m_ParallelSafeComponents[entry.m_Order] == nullptr) continue;
+
+		entry.m_Command();
+	}
+
+	m_OrderedCommands.clear();
+
+	m_ParallelSafeComponents.clear();
+}
+
 bool CustomComponentUpdater::Register(CustomComponent& customComponent)
 {
 	const auto it = FindByAddress(m_CustomComponents, customComponent);
@@ -45,6 +135,12 @@ bool CustomComponentUpdater::Unregister(CustomComponent& customComponent)
 	{
 		m_CustomComponents.erase(it);
 
+		std::replace(
+			m_ParallelSafeComponents.begin(), 
+			m_ParallelSafeComponents.end(), 
+			&customComponent, 
+			static_cast<CustomComponent*>(nullptr));
+
 		if (IsCurrentlyUpdating()) {
 			m_Index = std::min(0, m_Index - 1);
 		}
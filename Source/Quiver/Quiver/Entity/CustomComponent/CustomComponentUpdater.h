@@ -1,24 +1,77 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <vector>
 
+#include <function2.hpp>
+
 namespace qvr {
 
 class CustomComponent;
 class RawInputDevices;
+class WorkerPool;
+
+// Commands deferred by the CustomComponents one worker has stepped, each with the index of
+// the component that deferred it, so that they can all be run in the same order whichever
+// worker got which component.
+struct DeferredCommandBuffer
+{
+	struct Entry
+	{
+		int m_Order;
+		fu2::unique_function<void()> m_Command;
+	};
+
+	void Push(fu2::unique_function<void()> command) {
+		m_Entries.push_back(Entry{ m_CurrentOrder, std::move(command) });
+	}
+
+	int m_CurrentOrder = 0;
+	std::vector<Entry> m_Entries;
+};
 
 class CustomComponentUpdater
 {
 public:
+	CustomComponentUpdater();
+	~CustomComponentUpdater();
+
+	CustomComponentUpdater(const CustomComponentUpdater&) = delete;
+	CustomComponentUpdater(const CustomComponentUpdater&&) = delete;
+
+	CustomComponentUpdater& operator=(const CustomComponentUpdater&) = delete;
+	CustomComponentUpdater& operator=(const CustomComponentUpdater&&) = delete;
+
+	// Calls every component's HandleInput, then steps the parallel-safe ones on a 
+	// WorkerPool and runs the commands they deferred, then steps the rest.
 	void Update(const std::chrono::duration<float> deltaTime, qvr::RawInputDevices& inputDevices);
 	bool Register(CustomComponent& customComponent);
 	bool Unregister(CustomComponent& customComponent);
 	bool IsCurrentlyUpdating() const { return m_Index >= 0; }
 	auto GetRemoveFlaggers() const -> std::vector<std::reference_wrapper<CustomComponent>>;
+
+	// How many threads the parallel-safe components are stepped on, counting the one that
+	// calls Update. 1 by default.
+	void SetThreadCount(const int threadCount) { m_ThreadCount = std::max(1, threadCount); }
+	int GetThreadCount() const { return m_ThreadCount; }
 private:
+	void StepParallelSafe(const std::chrono::duration<float> deltaTime);
+
 	int m_Index = -1;
 	std::vector<std::reference_wrapper<CustomComponent>> m_CustomComponents;
+
+	int m_ThreadCount = 1;
+
+	// Created the first time there's a parallel-safe component to step, and again whenever
+	// the thread count changes.
+	std::unique_ptr<WorkerPool> m_WorkerPool;
+
+	// Reused from step to step.
+	std::vector<CustomComponent*> m_ParallelSafeComponents;
+	std::vector<DeferredCommandBuffer> m_DeferredCommands;
+	std::vector<DeferredCommandBuffer::Entry> m_OrderedCommands;
 };
 
 }
\ No newline at end of file
@@ -38,6 +38,8 @@ PhysicsComponent::PhysicsComponent(Entity& entity, const PhysicsComponentDef& de
 			log->error("Failed to create fixture!");
 		}
 	}
+
+	GetEntity().GetWorld().OnBodiesChanged();
 }
 
 PhysicsComponent::~PhysicsComponent()
@@ -45,6 +47,8 @@ PhysicsComponent::~PhysicsComponent()
 	assert(mBody->GetUserData() == this);
 	// We do this here to avoid a crash in ContactListener.
 	mBody->SetUserData(nullptr);
+
+	GetEntity().GetWorld().OnBodiesChanged();
 };
 
 namespace
@@ -5,8 +5,10 @@
 #include <ImGui/imgui.h>
 #include <spdlog/fmt/fmt.h>
 
+#include "Quiver/Entity/Entity.h"
 #include "Quiver/Entity/PhysicsComponent/PhysicsComponent.h"
 #include "Quiver/Misc/ImGuiHelpers.h"
+#include "Quiver/World/World.h"
 
 namespace qvr
 {
@@ -110,6 +112,11 @@ void GuiControls(b2Body& body, const BitNames& bitNames)
 			3))
 		{
 			body.SetType(type);
+
+			// The body may have just become static, or stopped being static.
+			if (auto physicsComponent = (PhysicsComponent*)body.GetUserData()) {
+				physicsComponent->GetEntity().GetWorld().OnStaticGeometryChanged(body);
+			}
 		}
 	}
 
@@ -1,9 +1,7 @@
 #include "RenderComponent.h"
 
-#include <Box2D/Collision/Shapes/b2EdgeShape.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
-#include <Box2D/Dynamics/b2World.h>
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/Shader.hpp>
 #include <SFML/Graphics/Texture.hpp>
@@ -30,8 +28,8 @@ TextureLibrary& GetTextureLibrary(const RenderComponent& renderComponent) {
 	return renderComponent.GetEntity().GetWorld().GetTextureLibrary();
 }
 
-b2World* GetPhysicsWorld(RenderComponent& rc) {
-	return const_cast<b2World*>(rc.GetEntity().GetWorld().GetPhysicsWorld());
+BillboardStore& GetBillboards(const RenderComponent& renderComponent) {
+	return renderComponent.GetEntity().GetWorld().GetBillboards();
 }
 
 Animation::Rect SfVecToRect(const sf::Vector2u& v) {
@@ -52,9 +50,7 @@ b2Fixture* RenderComponent::GetFixture() {
 }
 
 b2Body* RenderComponent::GetBody() {
-	return GetDetachedBody() != nullptr ?
-		GetDetachedBody() :
-		&GetEntity().GetPhysics()->GetBody();
+	return &GetEntity().GetPhysics()->GetBody();
 }
 
 RenderComponent::RenderComponent(Entity& entity)
@@ -62,6 +58,8 @@ RenderComponent::RenderComponent(Entity& entity)
 	, mFixtureRenderData(std::make_unique<qvr::FixtureRenderData>())
 {
 	GetFixture()->SetUserData(mFixtureRenderData.get());
+
+	GetEntity().GetWorld().OnBodiesChanged();
 }
 
 RenderComponent::~RenderComponent()
@@ -80,7 +78,10 @@ RenderComponent::~RenderComponent()
 
 	GetFixture()->SetUserData(nullptr);
 
-	if (mDetachedBody) {
+	GetEntity().GetWorld().OnBodiesChanged();
+
+	if (IsDetached()) {
+		GetBillboards(*this).Remove(mBillboard);
 		GetEntity().GetWorld().UnregisterDetachedRenderComponent(*this);
 	}
 }
@@ -93,6 +94,10 @@ bool RenderComponent::ToJson(nlohmann::json & j) const
 	j["Colour"] = ColourUtils::ToJson(GetColor());
 	j["SpriteRadius"] = GetSpriteRadius();
 
+	if (IsOpaque()) {
+		j["Opaque"] = true;
+	}
+
 	if (GetTexture()) {
 		j["Texture"] = mTextureFilename;
 	}
@@ -131,6 +136,7 @@ bool RenderComponent::FromJson(const nlohmann::json & j)
 
 	SetHeight(j.value<float>("Height", 1.0f));
 	SetGroundOffset(j.value<float>("GroundOffset", 0.0f));
+	SetOpaque(j.value<bool>("Opaque", false));
 
 	if (j.count("Colour") &&
 		!ColourUtils::DeserializeSFColorFromJson(
@@ -139,6 +145,8 @@ bool RenderComponent::FromJson(const nlohmann::json & j)
 	{
 		return false;
 	}
+
+	mFixtureRenderData->mRevision++;
 	
 	{
 		const auto renderType = j.value<std::string>("RenderType", {});
@@ -160,7 +168,10 @@ bool RenderComponent::FromJson(const nlohmann::json & j)
 		if (j["Texture"].is_string()) {
 			std::string filename = j["Texture"].get<std::string>();
 			if (filename.length() > 0) {
-				mFixtureRenderData->mTexture = GetEntity().GetWorld().GetTextureLibrary().LoadTexture(filename);
+				mFixtureRenderData->mTexture = GetTextureLibrary(*this).LoadTexture(filename);
+				mFixtureRenderData->mTextureLods = 
+					GetTexture() ? GetTextureLibrary(*this).LoadTextureLods(filename) : nullptr;
+				mFixtureRenderData->mRevision++;
 				if (GetTexture()) {
 					mTextureFilename = filename;
 					SetView(
@@ -208,43 +219,16 @@ bool RenderComponent::FromJson(const nlohmann::json & j)
 	return true;
 }
 
-void RenderComponent::UpdateDetachedBodyRotation(const float cameraAngle)
+void RenderComponent::UpdateBillboardPosition(const b2Vec2& position)
 {
 	assert(IsDetached());
 
-	mDetachedBody->SetTransform(mDetachedBody->GetPosition(), cameraAngle);
-}
-
-void RenderComponent::UpdateDetachedBodyPosition()
-{
-	assert(IsDetached());
+	if (position == mFixtureRenderData->mSpritePosition) return;
 
-	const b2Vec2 position = GetEntity().GetPhysics()->GetPosition();
-
-	mDetachedBody->SetTransform(position, mDetachedBody->GetAngle());
+	GetBillboards(*this).SetPosition(mBillboard, position);
 
 	mFixtureRenderData->mSpritePosition = position;
-}
-
-// User is responsible for setting the resulting fixture's user data.
-b2Fixture* CreateFlatSpriteFixture(b2Body* body, const float halfWidth) {
-	assert(body != nullptr);
-	assert(body->GetFixtureList() == nullptr);
-
-	b2FixtureDef fdef;
-	// Not sure what I'm doing with the filter tbh.
-	fdef.filter.categoryBits = 0xF000; // Detached RenderComponent category.
-	fdef.filter.maskBits = 0;          // Collide with nothing.
-	fdef.filter.groupIndex = -1;       // Never collide with anything. 
-
-	b2EdgeShape shape;
-	shape.Set(b2Vec2(-halfWidth, 0.0f), b2Vec2(halfWidth, 0.0f));
-
-	fdef.shape = &shape;
-
-	b2Fixture* newFixture = body->CreateFixture(&fdef);
-
-	return newFixture;
+	mFixtureRenderData->mRevision++;
 }
 
 void RenderComponent::SetDetached(const bool detached)
@@ -265,19 +249,13 @@ void RenderComponent::SetDetached(const bool detached)
 			}
 		}
 
-		{
-			b2BodyDef bdef;
-			bdef.type = b2BodyType::b2_staticBody;
+		mFixtureRenderData->mSpritePosition = GetEntity().GetPhysics()->GetPosition();
+		mFixtureRenderData->mRevision++;
 
-			mDetachedBody.reset(GetPhysicsWorld(*this)->CreateBody(&bdef));
-		}
-
-		{
-			b2Fixture* newFixture = CreateFlatSpriteFixture(mDetachedBody.get(), GetSpriteRadius());
-			assert(newFixture);
-
-			newFixture->SetUserData(mFixtureRenderData.get());
-		}
+		mBillboard = GetBillboards(*this).Add(
+			*mFixtureRenderData, 
+			mFixtureRenderData->mSpritePosition, 
+			GetSpriteRadius());
 
 		GetEntity().GetWorld().RegisterDetachedRenderComponent(*this);
 	}
@@ -287,31 +265,32 @@ void RenderComponent::SetDetached(const bool detached)
 
 		GetEntity().GetWorld().UnregisterDetachedRenderComponent(*this);
 		
-		mDetachedBody.reset();
+		GetBillboards(*this).Remove(mBillboard);
+
+		mBillboard = BillboardId(0);
 
 		GetFixture()->SetUserData(mFixtureRenderData.get());
 	}
+
+	GetEntity().GetWorld().OnBodiesChanged();
 }
 
-void RenderComponent::SetSpriteRadius(const float spriteRadius) 
+void RenderComponent::SetColor(const sf::Color& color)
 {
-	auto log = GetConsoleLogger();
+	if (color == mFixtureRenderData->mBlendColor) return;
+
+	mFixtureRenderData->mBlendColor = color;
+	mFixtureRenderData->mRevision++;
+}
 
+void RenderComponent::SetSpriteRadius(const float spriteRadius) 
+{
 	mFixtureRenderData->mSpriteRadius = spriteRadius;
+	mFixtureRenderData->mRevision++;
 
 	if (IsDetached())
 	{
-		// We can't just change shapes of fixtures after they've been created,
-		// so we need to re-create the fixture with the new length.
-
-		// Remove old fixture.
-		mDetachedBody->DestroyFixture(mDetachedBody->GetFixtureList());
-
-		// Create new one.
-		b2Fixture* newFixture = CreateFlatSpriteFixture(mDetachedBody.get(), GetSpriteRadius());
-		newFixture->SetUserData(mFixtureRenderData.get());
-
-		log->debug("RenderComponent::SetSpriteRadius: Recreated fixture for flat sprite.");
+		GetBillboards(*this).SetRadius(mBillboard, spriteRadius);
 	}
 }
 
@@ -320,6 +299,9 @@ bool RenderComponent::SetTexture(const std::string& filename)
 	std::shared_ptr<sf::Texture> texture = GetTextureLibrary(*this).LoadTexture(filename);
 
 	this->mFixtureRenderData->mTexture = texture;
+	this->mFixtureRenderData->mTextureLods = 
+		texture ? GetTextureLibrary(*this).LoadTextureLods(filename) : nullptr;
+	this->mFixtureRenderData->mRevision++;
 
 	if (texture)
 	{
@@ -337,6 +319,8 @@ bool RenderComponent::SetTexture(const std::string& filename)
 
 void RenderComponent::RemoveTexture() {
 	this->mFixtureRenderData->mTexture = nullptr;
+	this->mFixtureRenderData->mTextureLods = nullptr;
+	this->mFixtureRenderData->mRevision++;
 	this->mTextureFilename.clear();
 }
 
@@ -7,8 +7,8 @@
 #include <json.hpp>
 
 #include "Quiver/Animation/Animators.h"
+#include "Quiver/Graphics/BillboardStore.h"
 #include "Quiver/Graphics/FixtureRenderData.h"
-#include "Quiver/Physics/PhysicsUtils.h"
 
 class b2Fixture;
 class b2Body;
@@ -29,8 +29,8 @@ public:
 	bool ToJson(nlohmann::json& j) const;
 	bool FromJson(const nlohmann::json& j);
 
-	void UpdateDetachedBodyRotation(const float cameraAngle);
-	void UpdateDetachedBodyPosition();
+	// Moves the billboard to where the PhysicsComponent's body is drawn.
+	void UpdateBillboardPosition(const b2Vec2& position);
 
 	float GetHeight()                 const { return mFixtureRenderData->GetHeight(); }
 	float GetGroundOffset()           const { return mFixtureRenderData->GetGroundOffset(); }
@@ -39,12 +39,17 @@ public:
 	const b2Vec2& GetSpritePosition() const { return mFixtureRenderData->GetSpritePosition(); }
 	const sf::Color GetColor()        const { return mFixtureRenderData->GetColor(); }
 
-	void SetHeight      (const float height)       { mFixtureRenderData->mHeight = height; }
-	void SetGroundOffset(const float groundOffset) { mFixtureRenderData->mGroundOffset = groundOffset; }
-	void SetObjectAngle (const float radians)      { mFixtureRenderData->mObjectAngle = radians; }
-	void SetColor       (const sf::Color& color)   { mFixtureRenderData->mBlendColor = color; }
+	void SetHeight      (const float height)       { mFixtureRenderData->mHeight = height; mFixtureRenderData->mRevision++; }
+	void SetGroundOffset(const float groundOffset) { mFixtureRenderData->mGroundOffset = groundOffset; mFixtureRenderData->mRevision++; }
+	void SetObjectAngle (const float radians)      { mFixtureRenderData->mObjectAngle = radians; mFixtureRenderData->mRevision++; }
+	void SetColor       (const sf::Color& color);
 	void SetSpriteRadius(const float spriteRadius);
 
+	// Opaque fixtures hide everything behind them, which lets the renderer stop casting rays 
+	// once they're hit. Only set this if the texture has no transparent pixels.
+	bool IsOpaque() const { return mFixtureRenderData->mOpaque; }
+	void SetOpaque(const bool opaque) { mFixtureRenderData->mOpaque = opaque; mFixtureRenderData->mRevision++; }
+
 	const sf::Texture* GetTexture()         const { return mFixtureRenderData->GetTexture(); }
 	const char*        GetTextureFilename() const { return mTextureFilename.c_str(); }
 	bool SetTexture(const std::string& filename);
@@ -61,13 +66,13 @@ public:
 
 	void RemoveAnimation();
 	
-	// Returns true if the RenderComponent has its own (non-collidable) physical body.
-	bool IsDetached() const { return mDetachedBody != nullptr; }
+	// Returns true if the RenderComponent is drawn as a billboard that faces the camera, 
+	// instead of with the PhysicsComponent's fixture.
+	bool IsDetached() const { return mBillboard != BillboardId(0); }
 
 	void SetDetached(const bool detached);
 
 private:
-	b2Body* GetDetachedBody() { return mDetachedBody.get(); }
 	b2Body* GetBody();
 	b2Fixture* GetFixture();
 	
@@ -77,8 +82,8 @@ private:
 
 	std::unique_ptr<qvr::FixtureRenderData> mFixtureRenderData;
 
-	// Set when the RenderComponent has a different b2Body from the PhysicsComponent.
-	Physics::b2BodyUniquePtr mDetachedBody;
+	// Set when the RenderComponent is in the World's BillboardStore.
+	BillboardId mBillboard = BillboardId(0);
 };
 
 }
\ No newline at end of file
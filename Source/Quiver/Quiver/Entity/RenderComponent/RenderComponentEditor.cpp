@@ -64,6 +64,13 @@ void RenderComponentEditor::GuiControls()
 		}
 	}
 
+	{
+		bool opaque = m_RenderComponent.IsOpaque();
+		if (ImGui::Checkbox("Opaque", &opaque)) {
+			m_RenderComponent.SetOpaque(opaque);
+		}
+	}
+
 	{
 		sf::Color c = m_RenderComponent.GetColor();
 		ColourUtils::ImGuiColourEdit("Colour", c);
@@ -0,0 +1,134 @@
+#include "BillboardStore.h"
+
+#include <cassert>
+
+namespace qvr {
+
+BillboardId BillboardStore::Add(
+	const FixtureRenderData& renderData,
+	const b2Vec2& position,
+	const float radius)
+{
+	BillboardId id(0);
+
+	if (!mFreeIds.empty())
+	{
+		id = mFreeIds.back();
+		mFreeIds.pop_back();
+	}
+	else
+	{
+		// Skip 0.
+		if (mIndices.empty()) mIndices.push_back(-1);
+
+		id = BillboardId((int)mIndices.size());
+		mIndices.push_back(-1);
+	}
+
+	mIndices[id.get()] = GetCount();
+
+	mPositions.push_back(position);
+	mRadii.push_back(radius);
+	mRenderData.push_back(&renderData);
+	mProxies.push_back(mTree.CreateProxy(ComputeAABB(position, radius), (void*)(intptr_t)id.get()));
+	mIds.push_back(id);
+
+	return id;
+}
+
+void BillboardStore::Remove(const BillboardId id)
+{
+	assert(Contains(id));
+
+	const int index = GetIndex(id);
+	const int last = GetCount() - 1;
+
+	mTree.DestroyProxy(mProxies[index]);
+
+	// Fill the gap with the last one.
+	mPositions[index] = mPositions[last];
+	mRadii[index] = mRadii[last];
+	mRenderData[index] = mRenderData[last];
+	mProxies[index] = mProxies[last];
+	mIds[index] = mIds[last];
+
+	mIndices[mIds[index].get()] = index;
+
+	mPositions.pop_back();
+	mRadii.pop_back();
+	mRenderData.pop_back();
+	mProxies.pop_back();
+	mIds.pop_back();
+
+	mIndices[id.get()] = -1;
+	mFreeIds.push_back(id);
+}
+
+bool BillboardStore::Contains(const BillboardId id) const
+{
+	return id.get() > 0 && id.get() < (int)mIndices.size() && mIndices[id.get()] >= 0;
+}
+
+void BillboardStore::SetPosition(const BillboardId id, const b2Vec2& position)
+{
+	assert(Contains(id));
+
+	const int index = GetIndex(id);
+
+	if (mPositions[index] == position) return;
+
+	const b2Vec2 displacement = position - mPositions[index];
+
+	mPositions[index] = position;
+
+	// Only touches the tree once the billboard leaves its fattened bounds.
+	mTree.MoveProxy(mProxies[index], ComputeAABB(position, mRadii[index]), displacement);
+}
+
+void BillboardStore::SetRadius(const BillboardId id, const float radius)
+{
+	assert(Contains(id));
+
+	const int index = GetIndex(id);
+
+	mRadii[index] = radius;
+
+	mTree.MoveProxy(mProxies[index], ComputeAABB(mPositions[index], radius), b2Vec2_zero);
+}
+
+bool BillboardStore::RayCast(
+	const b2Vec2& start,
+	const b2Vec2& end,
+	const b2Vec2& forwards,
+	const b2Vec2& position,
+	const float radius,
+	const float32 maxFraction,
+	float32& fraction)
+{
+	const b2Vec2 direction = end - start;
+
+	// Heading away from it, or along it.
+	const float32 approach = b2Dot(direction, forwards);
+
+	if (approach <= b2_epsilon) return false;
+
+	fraction = b2Dot(position - start, forwards) / approach;
+
+	if (fraction < 0.0f || fraction > maxFraction) return false;
+
+	const b2Vec2 sideways(-forwards.y, forwards.x);
+
+	const b2Vec2 point = start + fraction * direction;
+
+	return b2Abs(b2Dot(point - position, sideways)) <= radius;
+}
+
+b2AABB BillboardStore::ComputeAABB(const b2Vec2& position, const float radius)
+{
+	b2AABB aabb;
+	aabb.lowerBound = position - b2Vec2(radius, radius);
+	aabb.upperBound = position + b2Vec2(radius, radius);
+	return aabb;
+}
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2Math.h>
+#include <named_type.hpp>
+
+namespace qvr {
+
+class FixtureRenderData;
+
+// BillboardId(0) is never given out.
+using BillboardId = fluent::NamedType<int, struct BillboardIdTag, fluent::Comparable>;
+
+// Flat sprites that always face the camera (detached RenderComponents). They're only there
+// to be looked at, so they're kept out of the physics world: there's no body to move every
+// frame, and they don't get in the way of anything else's ray casts. Instead they have a
+// tree of their own, and the WorldRaycastRenderer works out where its rays hit them as it
+// goes, as lines across the camera's view.
+// Stored as a structure of arrays, packed together so that removing one moves the last
+// one into its place.
+class BillboardStore {
+public:
+	BillboardId Add(const FixtureRenderData& renderData, const b2Vec2& position, const float radius);
+
+	void Remove(const BillboardId id);
+
+	bool Contains(const BillboardId id) const;
+
+	void SetPosition(const BillboardId id, const b2Vec2& position);
+	void SetRadius(const BillboardId id, const float radius);
+
+	int GetCount() const { return (int)mPositions.size(); }
+
+	// By index, which changes as billboards are removed.
+	const b2Vec2& GetPosition(const int index) const { return mPositions[index]; }
+	float GetRadius(const int index) const { return mRadii[index]; }
+	const FixtureRenderData& GetRenderData(const int index) const { return *mRenderData[index]; }
+
+	// Sets fraction to how far along the ray from start to end it hits a billboard at
+	// position, radius wide either side, turned to face along forwards. Returns false if the
+	// ray misses, or hits further along than maxFraction.
+	static bool RayCast(
+		const b2Vec2& start,
+		const b2Vec2& end,
+		const b2Vec2& forwards,
+		const b2Vec2& position,
+		const float radius,
+		const float32 maxFraction,
+		float32& fraction);
+
+	// Calls callback(index, fraction) for every billboard the ray from start to end hits,
+	// with them all facing along forwards, in no particular order. The callback returns the
+	// fraction to clip the ray to.
+	template<typename Callback>
+	void RayCast(
+		Callback& callback,
+		const b2Vec2& start,
+		const b2Vec2& end,
+		const b2Vec2& forwards,
+		const float32 maxFraction) const;
+
+	// Calls callback(index) for every billboard whose bounds overlap aabb, in no particular
+	// order, for as long as the callback returns true.
+	template<typename Callback>
+	void Query(Callback& callback, const b2AABB& aabb) const;
+
+private:
+	static b2AABB ComputeAABB(const b2Vec2& position, const float radius);
+
+	int GetIndex(const BillboardId id) const { return mIndices[id.get()]; }
+
+	std::vector<b2Vec2> mPositions;
+	std::vector<float> mRadii;
+	std::vector<const FixtureRenderData*> mRenderData;
+	std::vector<int32> mProxies;
+	std::vector<BillboardId> mIds;
+
+	// By id. -1 for ids that aren't in use.
+	std::vector<int> mIndices;
+	std::vector<BillboardId> mFreeIds;
+
+	// Each proxy's user data is its billboard's id. The bounds hold whichever way the
+	// billboard is facing.
+	b2DynamicTree mTree;
+};
+
+template<typename Callback>
+void BillboardStore::RayCast(
+	Callback& callback,
+	const b2Vec2& start,
+	const b2Vec2& end,
+	const b2Vec2& forwards,
+	const float32 maxFraction) const
+{
+	if (mPositions.empty()) return;
+
+	struct TreeCallback
+	{
+		float32 RayCastCallback(const b2RayCastInput& input, const int32 proxyId)
+		{
+			const int index = store->GetIndex(
+				BillboardId((int)(intptr_t)store->mTree.GetUserData(proxyId)));
+
+			float32 fraction;
+
+			if (!BillboardStore::RayCast(
+				input.p1,
+				input.p2,
+				*forwards,
+				store->mPositions[index],
+				store->mRadii[index],
+				input.maxFraction,
+				fraction))
+			{
+				return input.maxFraction;
+			}
+
+			return b2Min((float32)(*callback)(index, fraction), input.maxFraction);
+		}
+
+		const BillboardStore* store;
+		const b2Vec2* forwards;
+		Callback* callback;
+	};
+
+	TreeCallback treeCallback{ this, &forwards, &callback };
+
+	b2RayCastInput input;
+	input.p1 = start;
+	input.p2 = end;
+	input.maxFraction = maxFraction;
+
+	mTree.RayCast(&treeCallback, input);
+}
+
+template<typename Callback>
+void BillboardStore::Query(Callback& callback, const b2AABB& aabb) const
+{
+	if (mPositions.empty()) return;
+
+	struct TreeCallback
+	{
+		bool QueryCallback(const int32 proxyId)
+		{
+			return (*callback)(store->GetIndex(
+				BillboardId((int)(intptr_t)store->mTree.GetUserData(proxyId))));
+		}
+
+		const BillboardStore* store;
+		Callback* callback;
+	};
+
+	TreeCallback treeCallback{ this, &callback };
+
+	mTree.Query(&treeCallback, aabb);
+}
+
+}
@@ -0,0 +1,118 @@
+#include "ColumnDepthBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Quiver/Graphics/Camera3D.h"
+
+namespace qvr {
+
+namespace {
+
+// Where point is across the screen, from -1 on the left to 1 on the right, the same way
+// the WorldRaycastRenderer lays its rays out. Sets depth to how far ahead of camera it is.
+float GetScreenX(const Camera3D& camera, const b2Vec2& point, float& depth)
+{
+	const b2Vec2 forwards = camera.GetForwards();
+	const float viewPlaneWidthModifier = camera.GetViewPlaneWidthModifier();
+	const b2Vec2 viewPlane(
+		forwards.y * viewPlaneWidthModifier * (-1),
+		forwards.x * viewPlaneWidthModifier);
+
+	const b2Vec2 displacement = point - camera.GetPosition();
+
+	depth = b2Dot(displacement, forwards);
+
+	return b2Dot(displacement, viewPlane) / (depth * viewPlane.LengthSquared());
+}
+
+}
+
+void ColumnDepthBuffer::Resize(const int width)
+{
+	mDepths.resize(width);
+	mTops.resize(width);
+	mBottoms.resize(width);
+
+	Clear();
+}
+
+void ColumnDepthBuffer::Clear()
+{
+	std::fill(mDepths.begin(), mDepths.end(), std::numeric_limits<float>::max());
+	std::fill(mTops.begin(), mTops.end(), 0.0f);
+	std::fill(mBottoms.begin(), mBottoms.end(), 0.0f);
+}
+
+bool ColumnDepthBuffer::IsHidden(
+	const int column, 
+	const float distance, 
+	const float top, 
+	const float bottom) const
+{
+	if (column < 0 || column >= GetWidth()) return false;
+
+	return distance > mDepths[column] && top >= mTops[column] && bottom <= mBottoms[column];
+}
+
+bool ColumnDepthBuffer::IsHidden(const int column, const float distance) const
+{
+	return IsHidden(column, distance, mHorizon, mHorizon);
+}
+
+int ColumnDepthBuffer::GetColumn(const Camera3D& camera, const b2Vec2& point, float* distance) const
+{
+	float depth = 0.0f;
+	const float screenX = GetScreenX(camera, point, depth);
+
+	if (distance) *distance = depth;
+
+	// Every ray goes forwards.
+	if (depth <= b2_epsilon) return -1;
+
+	const int column = (int)std::floor((screenX + 1.0f) * GetWidth() / 2.0f + 0.5f);
+
+	return (column >= 0 && column < GetWidth()) ? column : -1;
+}
+
+bool ColumnDepthBuffer::IsHidden(const Camera3D& camera, const b2Vec2& point) const
+{
+	float distance = 0.0f;
+	const int column = GetColumn(camera, point, &distance);
+
+	return IsHidden(column, distance);
+}
+
+bool ColumnDepthBuffer::IsHidden(const Camera3D& camera, const b2Vec2& point, const float radius) const
+{
+	// Flat sprites always face the camera.
+	const b2Vec2 forwards = camera.GetForwards();
+	const b2Vec2 perp(-forwards.y, forwards.x);
+
+	float depth = 0.0f;
+	const float screenXA = GetScreenX(camera, point - (radius * perp), depth);
+	const float screenXB = GetScreenX(camera, point + (radius * perp), depth);
+
+	if (depth <= b2_epsilon) return false;
+
+	const float halfWidth = GetWidth() / 2.0f;
+
+	const int first = std::max(
+		(int)std::floor((std::min(screenXA, screenXB) + 1.0f) * halfWidth + 0.5f),
+		0);
+	const int last = std::min(
+		(int)std::floor((std::max(screenXA, screenXB) + 1.0f) * halfWidth + 0.5f),
+		GetWidth() - 1);
+
+	if (first > last) return false;
+
+	for (int column = first; column <= last; column++)
+	{
+		if (!IsHidden(column, depth)) return false;
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include <Box2D/Common/b2Math.h>
+
+namespace qvr {
+
+class Camera3D;
+
+// For each screen column of the last frame the WorldRaycastRenderer drew, how far away the
+// nearest opaque front face is, and the rows it covers on screen. Anything further away than
+// that, and between those rows, is hidden behind it.
+// Distances are measured straight ahead of the camera, like the renderer's.
+class ColumnDepthBuffer {
+public:
+	// Leaves every column with nothing hiding anything in it.
+	void Resize(const int width);
+
+	void Clear();
+
+	int GetWidth() const { return (int)mDepths.size(); }
+
+	float GetDepth(const int column) const { return mDepths[column]; }
+	float GetTop(const int column) const { return mTops[column]; }
+	float GetBottom(const int column) const { return mBottoms[column]; }
+
+	// By default, the face covers the whole column.
+	void SetDepth(
+		const int column,
+		const float depth,
+		const float top = -std::numeric_limits<float>::max(),
+		const float bottom = std::numeric_limits<float>::max())
+	{
+		mDepths[column] = depth;
+		mTops[column] = top;
+		mBottoms[column] = bottom;
+	}
+
+	// The row the camera's eye level is drawn in, at every distance.
+	float GetHorizon() const { return mHorizon; }
+	void SetHorizon(const float horizon) { mHorizon = horizon; }
+
+	// Whether something distance away, drawn between rows top and bottom, is hidden. False 
+	// if the column isn't in the buffer.
+	bool IsHidden(const int column, const float distance, const float top, const float bottom) const;
+
+	// The same, for something at the camera's eye level.
+	bool IsHidden(const int column, const float distance) const;
+
+	// The column point would be drawn in from camera, or -1 if it's off screen. If distance
+	// isn't null, it's set to how far point is from camera.
+	int GetColumn(const Camera3D& camera, const b2Vec2& point, float* distance = nullptr) const;
+
+	// True if point, at the camera's eye level, would be hidden, as long as it's no wider 
+	// than a column. False if it's off screen.
+	bool IsHidden(const Camera3D& camera, const b2Vec2& point) const;
+
+	// True if every column a flat sprite at point, at the camera's eye level and radius wide
+	// either side, would be drawn in hides it. False if the whole of it is off screen.
+	bool IsHidden(const Camera3D& camera, const b2Vec2& point, const float radius) const;
+
+private:
+	std::vector<float> mDepths;
+	std::vector<float> mTops;
+	std::vector<float> mBottoms;
+
+	float mHorizon = 0.0f;
+};
+
+}
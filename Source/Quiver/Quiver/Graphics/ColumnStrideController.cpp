@@ -0,0 +1,59 @@
+#include "ColumnStrideController.h"
+
+#include <algorithm>
+
+namespace qvr {
+
+void ColumnStrideController::AddSample(
+	const Profiler::SampleUnit renderTime,
+	const Profiler::SampleUnit budget,
+	const int maxStride)
+{
+	// Give the average time to settle after a change before making another, so that the
+	// stride doesn't flicker back and forth.
+	const int settleSampleCount = 10;
+	const float smoothing = 0.2f;
+	// Casting fewer columns doesn't make the rest of rendering any cheaper, so only go back
+	// down to a smaller stride if there's plenty of room for it.
+	const float headroom = 0.8f;
+
+	m_Stride = std::max(1, std::min(m_Stride, maxStride));
+
+	m_AverageMs =
+		(m_SampleCount == 0) ?
+		renderTime.count() :
+		m_AverageMs + (renderTime.count() - m_AverageMs) * smoothing;
+
+	m_SampleCount++;
+
+	if (m_SampleCount < settleSampleCount) return;
+
+	if (m_AverageMs > budget.count())
+	{
+		if (m_Stride < maxStride)
+		{
+			m_Stride++;
+			m_SampleCount = 0;
+		}
+	}
+	else if (m_Stride > 1)
+	{
+		// Roughly how long a frame would take with the smaller stride.
+		const float predictedMs = m_AverageMs * m_Stride / (m_Stride - 1);
+
+		if (predictedMs < budget.count() * headroom)
+		{
+			m_Stride--;
+			m_SampleCount = 0;
+		}
+	}
+}
+
+void ColumnStrideController::Reset()
+{
+	m_Stride = 1;
+	m_AverageMs = 0.0f;
+	m_SampleCount = 0;
+}
+
+}
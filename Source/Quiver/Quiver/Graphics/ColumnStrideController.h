@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Quiver/Misc/Profiler.h"
+
+namespace qvr {
+
+// Picks how many columns apart the WorldRaycastRenderer casts its rays, so that rendering
+// stays within a time budget. The columns in between are filled in from their neighbours.
+class ColumnStrideController
+{
+public:
+	// Takes how long the last frame took to render, at the current stride.
+	void AddSample(
+		const Profiler::SampleUnit renderTime,
+		const Profiler::SampleUnit budget,
+		const int maxStride);
+
+	int GetStride() const { return m_Stride; }
+
+	void Reset();
+
+private:
+	int m_Stride = 1;
+
+	// Exponential moving average of the samples since the stride last changed.
+	float m_AverageMs = 0.0f;
+	int m_SampleCount = 0;
+};
+
+}
@@ -0,0 +1,73 @@
+#include "FixtureRenderData.h"
+
+namespace qvr {
+
+namespace {
+
+std::vector<const FixtureRenderData*>& GetRegistry()
+{
+	static std::vector<const FixtureRenderData*> registry;
+	return registry;
+}
+
+std::vector<unsigned>& GetFreeRenderIds()
+{
+	static std::vector<unsigned> freeIds;
+	return freeIds;
+}
+
+}
+
+FixtureRenderData::FixtureRenderData()
+{
+	auto& registry = GetRegistry();
+	auto& freeIds = GetFreeRenderIds();
+
+	if (freeIds.empty())
+	{
+		mRenderId = (unsigned)registry.size();
+		registry.push_back(this);
+	}
+	else
+	{
+		mRenderId = freeIds.back();
+		freeIds.pop_back();
+		registry[mRenderId] = this;
+	}
+}
+
+FixtureRenderData::FixtureRenderData(const FixtureRenderData& other)
+	: FixtureRenderData()
+{
+	*this = other;
+}
+
+FixtureRenderData& FixtureRenderData::operator=(const FixtureRenderData& other)
+{
+	mHeight = other.mHeight;
+	mGroundOffset = other.mGroundOffset;
+	mSpriteRadius = other.mSpriteRadius;
+	mObjectAngle = other.mObjectAngle;
+	mSpritePosition = other.mSpritePosition;
+	mBlendColor = other.mBlendColor;
+	mOpaque = other.mOpaque;
+	mTexture = other.mTexture;
+	mTextureLods = other.mTextureLods;
+	mTextureRects.views = other.mTextureRects.views;
+	mRevision = other.mRevision;
+
+	return *this;
+}
+
+FixtureRenderData::~FixtureRenderData()
+{
+	GetRegistry()[mRenderId] = nullptr;
+	GetFreeRenderIds().push_back(mRenderId);
+}
+
+const std::vector<const FixtureRenderData*>& FixtureRenderData::GetAllByRenderId()
+{
+	return GetRegistry();
+}
+
+}
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
+#include <Box2D/Common/b2Math.h>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/Texture.hpp>
 
 #include "Quiver/Animation/Animators.h"
+#include "Quiver/Graphics/TextureLods.h"
 
 namespace qvr
 {
@@ -24,11 +27,37 @@ class FixtureRenderData
 
 	sf::Color mBlendColor = sf::Color(255, 255, 255, 255);
 
+	bool mOpaque = false;
+
 	std::shared_ptr<sf::Texture> mTexture;
 
+	std::shared_ptr<const TextureLods> mTextureLods;
+
 	AnimatorTarget mTextureRects;
 
+	// Incremented by the RenderComponent whenever it changes any of the above.
+	unsigned mRevision = 0;
+
+	unsigned mRenderId;
+
 public:
+	FixtureRenderData();
+	~FixtureRenderData();
+
+	// Copies get a render ID of their own. Assigning one copies everything but the ID.
+	FixtureRenderData(const FixtureRenderData& other);
+	FixtureRenderData& operator=(const FixtureRenderData& other);
+
+	// Small, and not shared with any other FixtureRenderData that exists at the same time,
+	// so that the renderer can keep what it needs to know about each one in a table. 
+	// The ones that have been destroyed get reused.
+	unsigned GetRenderId() const { return mRenderId; }
+
+	// Every FixtureRenderData there is, by render ID, with null where an ID isn't in use.
+	// They're only meant to be created and destroyed on the main thread, so only read this
+	// from there too.
+	static const std::vector<const FixtureRenderData*>& GetAllByRenderId();
+
 	float GetHeight() const { return mHeight; }
 	float GetGroundOffset() const { return mGroundOffset; }
 	float GetSpriteRadius() const { return mSpriteRadius; }
@@ -38,9 +67,35 @@ public:
 
 	sf::Color GetColor() const { return mBlendColor; }
 
+	// True if nothing behind the fixture can be seen through it.
+	bool IsOpaque() const { return mOpaque && mBlendColor.a == 255; }
+
 	const sf::Texture* GetTexture() const { return mTexture.get(); }
 
+	// Not counting the texture itself.
+	int GetTextureLodCount() const { return mTextureLods ? mTextureLods->GetLevelCount() : 0; }
+
+	// The texture (lod 0) or one of its smaller copies.
+	const sf::Texture* GetTexture(const int lod) const {
+		return lod > 0 ? &mTextureLods->GetLevel(lod) : mTexture.get();
+	}
+
+	// The pixels of GetTexture(lod), if it was loaded from the TextureLibrary.
+	const sf::Image* GetImage(const int lod) const {
+		return mTextureLods ? &mTextureLods->GetImage(lod) : nullptr;
+	}
+
+	// What texel coordinates on the texture have to be multiplied by to sample the same 
+	// place on GetTexture(lod).
+	sf::Vector2f GetTextureLodScale(const int lod) const {
+		return lod > 0 ? mTextureLods->GetScale(lod) : sf::Vector2f(1.0f, 1.0f);
+	}
+
 	const ViewBuffer& GetViews() const { return mTextureRects.views; }
+
+	// Changes whenever anything that affects how the fixture looks does, including its 
+	// animation frame. 
+	unsigned GetRevision() const { return mRevision + mTextureRects.views.revision; }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,589 @@
+#include "PotentiallyVisibleSets.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <tuple>
+
+#include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+#include "Quiver/Graphics/FixtureRenderData.h"
+#include "Quiver/Misc/Logging.h"
+#include "Quiver/Misc/WorkerPool.h"
+#include "Quiver/Physics/StaticGeometryGrid.h"
+
+namespace qvr {
+
+namespace {
+
+// What stays the same about a fixture when the World is saved and loaded again.
+struct FixtureKey
+{
+	b2Vec2 m_BodyPosition;
+	int m_FixtureIndex;
+	int m_ChildIndex;
+};
+
+bool operator<(const FixtureKey& a, const FixtureKey& b)
+{
+	return
+		std::tie(a.m_BodyPosition.x, a.m_BodyPosition.y, a.m_FixtureIndex, a.m_ChildIndex) <
+		std::tie(b.m_BodyPosition.x, b.m_BodyPosition.y, b.m_FixtureIndex, b.m_ChildIndex);
+}
+
+FixtureKey GetFixtureKey(const Physics::FixtureChild& child)
+{
+	const b2Body& body = *child.fixture->GetBody();
+
+	int fixtureIndex = 0;
+
+	for (const b2Fixture* fixture = body.GetFixtureList(); fixture != child.fixture; fixture = fixture->GetNext())
+	{
+		fixtureIndex++;
+	}
+
+	return FixtureKey{ body.GetPosition(), fixtureIndex, child.childIndex };
+}
+
+// Every fixture in the grid, in an order that stays the same when the World is saved and
+// loaded again.
+std::vector<std::pair<FixtureKey, Physics::FixtureChild>> GetFixtures(
+	const Physics::StaticGeometryGrid& grid)
+{
+	std::vector<std::pair<FixtureKey, Physics::FixtureChild>> fixtures;
+
+	grid.ForEachBody([&fixtures](const b2Body& body)
+	{
+		for (const b2Fixture* fixture = body.GetFixtureList(); fixture; fixture = fixture->GetNext())
+		{
+			for (int32 childIndex = 0; childIndex < fixture->GetShape()->GetChildCount(); childIndex++)
+			{
+				const Physics::FixtureChild child{ fixture, childIndex };
+
+				fixtures.push_back(std::make_pair(GetFixtureKey(child), child));
+			}
+		}
+	});
+
+	std::stable_sort(
+		fixtures.begin(),
+		fixtures.end(),
+		[](const auto& a, const auto& b) { return a.first < b.first; });
+
+	return fixtures;
+}
+
+struct SampleHit
+{
+	float32 m_Fraction;
+	int m_FixtureIndex;
+};
+
+b2AABB ComputeAABB(const Physics::FixtureChild& child)
+{
+	b2AABB aabb;
+	child.fixture->GetShape()->ComputeAABB(
+		&aabb,
+		child.fixture->GetBody()->GetTransform(),
+		child.childIndex);
+	return aabb;
+}
+
+std::array<b2Vec2, 4> GetCorners(const b2AABB& aabb)
+{
+	return {
+		aabb.lowerBound,
+		b2Vec2(aabb.upperBound.x, aabb.lowerBound.y),
+		aabb.upperBound,
+		b2Vec2(aabb.lowerBound.x, aabb.upperBound.y) };
+}
+
+// Whether every line from somewhere in cell to somewhere in target goes through blocker.
+// Every shape Box2D has is convex, so the points a point in one can be hidden from by it 
+// make up a convex region too. That means checking the lines between their corners is enough.
+bool BlocksEveryLine(
+	const Physics::FixtureChild& blocker,
+	const std::array<b2Vec2, 4>& cell,
+	const std::array<b2Vec2, 4>& target)
+{
+	for (const b2Vec2& from : cell)
+	{
+		if (blocker.fixture->GetShape()->TestPoint(blocker.fixture->GetBody()->GetTransform(), from))
+		{
+			continue;
+		}
+
+		for (const b2Vec2& to : target)
+		{
+			b2RayCastInput input;
+			input.p1 = from;
+			input.p2 = to;
+			input.maxFraction = 1.0f;
+
+			b2RayCastOutput output;
+
+			const bool blocked =
+				blocker.fixture->RayCast(&output, input, blocker.childIndex) &&
+				output.fraction < 1.0f;
+
+			if (!blocked) return false;
+		}
+	}
+
+	return true;
+}
+
+}
+
+void PotentiallyVisibleSets::Compute(
+	const Physics::StaticGeometryGrid& grid,
+	const ComputeSettings& settings)
+{
+	Clear();
+
+	mCellSize = settings.m_CellSize;
+	mRayLength = settings.m_RayLength;
+
+	const auto fixtures = GetFixtures(grid);
+
+	if (fixtures.empty()) return;
+
+	std::map<std::pair<const b2Fixture*, int32>, int> fixtureIndices;
+
+	std::vector<b2AABB> fixtureBounds;
+
+	b2AABB bounds;
+	bounds.lowerBound.Set(FLT_MAX, FLT_MAX);
+	bounds.upperBound.Set(-FLT_MAX, -FLT_MAX);
+
+	for (const auto& fixture : fixtures)
+	{
+		const Physics::FixtureChild& child = fixture.second;
+
+		fixtureIndices[std::make_pair(child.fixture, child.childIndex)] = (int)mFixtures.size();
+
+		mFixtures.push_back(child);
+
+		fixtureBounds.push_back(ComputeAABB(child));
+
+		bounds.Combine(fixtureBounds.back());
+	}
+
+	const int32 minX = ToCell(bounds.lowerBound.x);
+	const int32 minY = ToCell(bounds.lowerBound.y);
+	const int32 maxX = ToCell(bounds.upperBound.x);
+	const int32 maxY = ToCell(bounds.upperBound.y);
+
+	const int columnCount = maxX - minX + 1;
+	const int cellCount = columnCount * (maxY - minY + 1);
+
+	std::vector<std::vector<int>> visibleFromCell(cellCount);
+
+	auto ComputeCell = [&](
+		const int cellIndex,
+		std::vector<SampleHit>& hits,
+		std::vector<bool>& visible,
+		std::vector<bool>& blocks)
+	{
+		const b2Vec2 cellCorner(
+			(minX + cellIndex % columnCount) * mCellSize,
+			(minY + cellIndex / columnCount) * mCellSize);
+
+		visible.assign(mFixtures.size(), false);
+
+		// The fixtures that hid the rest of a ray. They're the ones worth trying as blockers.
+		blocks.assign(mFixtures.size(), false);
+
+		bool anySampleOutside = false;
+
+		const float sampleSpacing = mCellSize / settings.m_SamplesPerAxis;
+
+		for (int sampleY = 0; sampleY < settings.m_SamplesPerAxis; sampleY++)
+		{
+			for (int sampleX = 0; sampleX < settings.m_SamplesPerAxis; sampleX++)
+			{
+				const b2Vec2 samplePoint =
+					cellCorner +
+					b2Vec2((sampleX + 0.5f) * sampleSpacing, (sampleY + 0.5f) * sampleSpacing);
+
+				// The camera can't be inside a wall, so there's nothing to see from here.
+				const bool insideFixture = std::any_of(
+					mFixtures.begin(),
+					mFixtures.end(),
+					[&samplePoint](const Physics::FixtureChild& child) {
+						return child.fixture->TestPoint(samplePoint);
+					});
+
+				if (insideFixture) continue;
+
+				anySampleOutside = true;
+
+				for (int ray = 0; ray < settings.m_RaysPerSample; ray++)
+				{
+					const float angle = (b2_pi * 2.0f * ray) / settings.m_RaysPerSample;
+
+					const b2Vec2 rayEnd =
+						samplePoint + settings.m_RayLength * b2Vec2(cosf(angle), sinf(angle));
+
+					hits.clear();
+
+					auto collect = [&](const Physics::RayCastHit& hit)
+					{
+						const auto index =
+							fixtureIndices.find(std::make_pair(hit.fixture, hit.childIndex));
+
+						if (index != fixtureIndices.end())
+						{
+							hits.push_back(SampleHit{ hit.entryFraction, index->second });
+						}
+
+						return true;
+					};
+
+					grid.RayCast(collect, samplePoint, rayEnd);
+
+					std::sort(
+						hits.begin(),
+						hits.end(),
+						[](const SampleHit& a, const SampleHit& b) { return a.m_Fraction < b.m_Fraction; });
+
+					// Everything between these heights is hidden behind the opaque fixtures
+					// hit so far. Anything that sticks out above or below can still be seen.
+					float hiddenBottom = FLT_MAX;
+					float hiddenTop = -FLT_MAX;
+
+					for (const SampleHit& hit : hits)
+					{
+						const auto renderData =
+							(const FixtureRenderData*)mFixtures[hit.m_FixtureIndex].fixture->GetUserData();
+
+						// Without a RenderComponent there's nothing to see, but there could be
+						// later on, so err on the side of including it.
+						if (renderData == nullptr)
+						{
+							visible[hit.m_FixtureIndex] = true;
+							continue;
+						}
+
+						const float bottom = renderData->GetGroundOffset();
+						const float top = bottom + renderData->GetHeight();
+
+						if (bottom < hiddenBottom || top > hiddenTop)
+						{
+							visible[hit.m_FixtureIndex] = true;
+						}
+
+						const bool hidesEye =
+							renderData->IsOpaque() &&
+							bottom <= settings.m_MinEyeHeight &&
+							top >= settings.m_MaxEyeHeight;
+
+						if (hidesEye)
+						{
+							if (hiddenBottom > hiddenTop)
+							{
+								blocks[hit.m_FixtureIndex] = true;
+							}
+
+							hiddenBottom = std::min(hiddenBottom, bottom);
+							hiddenTop = std::max(hiddenTop, top);
+						}
+					}
+				}
+			}
+		}
+
+		// Every sample point was inside something, so leave the cell out.
+		if (!anySampleOutside) return;
+
+		// The rays can miss things seen through gaps narrower than they are apart, or from
+		// points in the cell between the sample points. So everything the rays didn't see is
+		// still in the set, unless one of the blockers hides it from all of the cell.
+		b2AABB cellBounds;
+		cellBounds.lowerBound = cellCorner;
+		cellBounds.upperBound = cellCorner + b2Vec2(mCellSize, mCellSize);
+
+		const auto cellCorners = GetCorners(cellBounds);
+
+		b2AABB inReach = cellBounds;
+		inReach.lowerBound -= b2Vec2(settings.m_RayLength, settings.m_RayLength);
+		inReach.upperBound += b2Vec2(settings.m_RayLength, settings.m_RayLength);
+
+		std::vector<int> blockers;
+
+		for (int index = 0; index < (int)blocks.size(); index++)
+		{
+			if (blocks[index]) blockers.push_back(index);
+		}
+
+		for (int index = 0; index < (int)visible.size(); index++)
+		{
+			if (visible[index] || !b2TestOverlap(inReach, fixtureBounds[index])) continue;
+
+			const auto renderData = (const FixtureRenderData*)mFixtures[index].fixture->GetUserData();
+
+			if (renderData == nullptr)
+			{
+				visible[index] = true;
+				continue;
+			}
+
+			const float bottom = renderData->GetGroundOffset();
+			const float top = bottom + renderData->GetHeight();
+
+			const auto targetCorners = GetCorners(fixtureBounds[index]);
+
+			const auto blocker = std::find_if(
+				blockers.begin(),
+				blockers.end(),
+				[&](const int blockerIndex)
+			{
+				if (blockerIndex == index) return false;
+
+				const auto blockerData =
+					(const FixtureRenderData*)mFixtures[blockerIndex].fixture->GetUserData();
+
+				const float blockerBottom = blockerData->GetGroundOffset();
+				const float blockerTop = blockerBottom + blockerData->GetHeight();
+
+				return
+					bottom >= blockerBottom &&
+					top <= blockerTop &&
+					BlocksEveryLine(mFixtures[blockerIndex], cellCorners, targetCorners);
+			});
+
+			if (blocker == blockers.end())
+			{
+				visible[index] = true;
+			}
+			else
+			{
+				// Neighbouring fixtures tend to be hidden by the same one, so try it first.
+				std::rotate(blockers.begin(), blocker, blocker + 1);
+			}
+		}
+
+		for (int index = 0; index < (int)visible.size(); index++)
+		{
+			if (visible[index])
+			{
+				visibleFromCell[cellIndex].push_back(index);
+			}
+		}
+	};
+
+	WorkerPool workerPool(GetHardwareThreadCount());
+
+	workerPool.ParallelFor(cellCount, 1, [&](const int begin, const int end, const int)
+	{
+		std::vector<SampleHit> hits;
+		std::vector<bool> visible;
+		std::vector<bool> blocks;
+
+		for (int cellIndex = begin; cellIndex < end; cellIndex++)
+		{
+			ComputeCell(cellIndex, hits, visible, blocks);
+		}
+	});
+
+	for (int cellIndex = 0; cellIndex < cellCount; cellIndex++)
+	{
+		// Nothing can be seen from it, or every sample point was inside something. Either 
+		// way, leave it out so the renderer falls back to casting against everything.
+		if (visibleFromCell[cellIndex].empty()) continue;
+
+		const CellKey key =
+			MakeKey(minX + cellIndex % columnCount, minY + cellIndex / columnCount);
+
+		mCellIndices[key] = std::move(visibleFromCell[cellIndex]);
+
+		auto& cell = mCells[key];
+
+		for (const int index : mCellIndices[key])
+		{
+			cell.push_back(mFixtures[index]);
+		}
+	}
+
+	auto log = GetConsoleLogger();
+
+	log->info(
+		"Worked out the potentially visible sets of {} cells, from {} fixtures.",
+		mCells.size(),
+		mFixtures.size());
+}
+
+void PotentiallyVisibleSets::Clear()
+{
+	mFixtures.clear();
+	mCellIndices.clear();
+	mCells.clear();
+}
+
+const std::vector<Physics::FixtureChild>* PotentiallyVisibleSets::GetVisibleFixtures(
+	const b2Vec2& position,
+	const float rayLength) const
+{
+	// Anything further away than the sets were worked out for could have been left out.
+	if (rayLength > mRayLength) return nullptr;
+
+	const auto it = mCells.find(MakeKey(ToCell(position.x), ToCell(position.y)));
+
+	if (it == mCells.end()) return nullptr;
+
+	return &it->second;
+}
+
+bool PotentiallyVisibleSets::ToJson(nlohmann::json& j) const
+{
+	if (IsEmpty()) return false;
+
+	j["CellSize"] = mCellSize;
+	j["RayLength"] = mRayLength;
+
+	// The fixtures are in the same order GetFixtures would put them in.
+	for (const Physics::FixtureChild& child : mFixtures)
+	{
+		const FixtureKey key = GetFixtureKey(child);
+
+		j["Fixtures"].push_back({
+			{ "Position", { key.m_BodyPosition.x, key.m_BodyPosition.y } },
+			{ "Fixture", key.m_FixtureIndex },
+			{ "Child", key.m_ChildIndex } });
+	}
+
+	// Sorted, so that the file doesn't change if the sets don't.
+	std::vector<CellKey> keys;
+
+	for (const auto& cell : mCellIndices)
+	{
+		keys.push_back(cell.first);
+	}
+
+	std::sort(keys.begin(), keys.end());
+
+	for (const CellKey key : keys)
+	{
+		j["Cells"].push_back({
+			{ "X", (int32)(std::uint32_t)(key >> 32) },
+			{ "Y", (int32)(std::uint32_t)(key & 0xffffffff) },
+			{ "Visible", mCellIndices.at(key) } });
+	}
+
+	return true;
+}
+
+bool PotentiallyVisibleSets::FromJson(
+	const nlohmann::json& j,
+	const Physics::StaticGeometryGrid& grid)
+{
+	auto log = GetConsoleLogger();
+
+	static const char* logContext = "PotentiallyVisibleSets::FromJson:";
+
+	Clear();
+
+	if (!j.is_object() ||
+		j.count("CellSize") == 0 ||
+		j.count("RayLength") == 0 ||
+		!j["Fixtures"].is_array() ||
+		!j["Cells"].is_array())
+	{
+		log->error("{} Must have CellSize, RayLength, Fixtures and Cells.", logContext);
+		return false;
+	}
+
+	try
+	{
+		mCellSize = j["CellSize"].get<float>();
+		mRayLength = j["RayLength"].get<float>();
+
+		const auto fixtures = GetFixtures(grid);
+
+		if (fixtures.size() != j["Fixtures"].size())
+		{
+			log->warn(
+				"{} Saved for {} fixtures, but there are {}. The static geometry has changed.",
+				logContext,
+				j["Fixtures"].size(),
+				fixtures.size());
+			return false;
+		}
+
+		for (unsigned index = 0; index < fixtures.size(); index++)
+		{
+			const nlohmann::json& fixtureJson = j["Fixtures"][index];
+
+			const FixtureKey key{
+				b2Vec2(fixtureJson["Position"][0].get<float>(), fixtureJson["Position"][1].get<float>()),
+				fixtureJson["Fixture"].get<int>(),
+				fixtureJson["Child"].get<int>() };
+
+			const FixtureKey& actualKey = fixtures[index].first;
+
+			if (key < actualKey || actualKey < key)
+			{
+				log->warn(
+					"{} Fixture {} doesn't match. The static geometry has changed.",
+					logContext,
+					index);
+				Clear();
+				return false;
+			}
+
+			mFixtures.push_back(fixtures[index].second);
+		}
+
+		for (const nlohmann::json& cellJson : j["Cells"])
+		{
+			const CellKey key = MakeKey(cellJson["X"].get<int32>(), cellJson["Y"].get<int32>());
+
+			std::vector<int> indices = cellJson["Visible"].get<std::vector<int>>();
+
+			auto& cell = mCells[key];
+
+			for (const int index : indices)
+			{
+				if (index < 0 || index >= (int)mFixtures.size())
+				{
+					log->error("{} Fixture index {} is out of range.", logContext, index);
+					Clear();
+					return false;
+				}
+
+				cell.push_back(mFixtures[index]);
+			}
+
+			mCellIndices[key] = std::move(indices);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		log->error("{} {}", logContext, e.what());
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+std::string GetPotentiallyVisibleSetsFilename(const std::string& worldFilename)
+{
+	const std::string extension = ".json";
+
+	const bool hasExtension =
+		worldFilename.size() >= extension.size() &&
+		worldFilename.compare(worldFilename.size() - extension.size(), extension.size(), extension) == 0;
+
+	const std::string stem =
+		hasExtension ?
+		worldFilename.substr(0, worldFilename.size() - extension.size()) :
+		worldFilename;
+
+	return stem + ".pvs.json";
+}
+
+}
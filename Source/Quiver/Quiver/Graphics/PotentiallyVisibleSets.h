@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Common/b2Math.h>
+#include <json.hpp>
+
+#include "Quiver/Physics/RayCastEntryExit.h"
+
+namespace qvr {
+
+namespace Physics {
+class StaticGeometryGrid;
+}
+
+// Splits the level up into square cells, and lists the static geometry that can be seen from
+// somewhere inside each one, so that the WorldRaycastRenderer only has to cast against that.
+// The sets are conservative: everything within m_RayLength of a cell is in its set, unless a
+// single fixture blocks every line from the cell to it. The rays cast out from a few points
+// in each cell only pick out which fixtures to try as blockers. A fixture only hides what's
+// behind it if it's opaque, and tall enough that it would hide it from any eye height between
+// m_MinEyeHeight and m_MaxEyeHeight.
+// The sets need working out again whenever static geometry moves or changes shape, or its
+// RenderComponent's opacity, height or ground offset changes.
+class PotentiallyVisibleSets {
+public:
+	struct ComputeSettings {
+		float m_CellSize = 4.0f;
+		// The points the rays are cast from, along each side of a cell.
+		int m_SamplesPerAxis = 3;
+		int m_RaysPerSample = 512;
+		// The sets can't be used by a renderer that casts rays any longer than this.
+		float m_RayLength = 50.0f;
+		float m_MinEyeHeight = 0.25f;
+		float m_MaxEyeHeight = 0.75f;
+	};
+
+	// Works out the sets for the cells covering everything in grid. Spreads the work over
+	// every hardware thread.
+	void Compute(const Physics::StaticGeometryGrid& grid, const ComputeSettings& settings);
+
+	void Clear();
+
+	bool IsEmpty() const { return mCells.empty(); }
+
+	int GetCellCount() const { return (int)mCells.size(); }
+
+	// Returns null if position isn't in a cell with a set, or rayLength is longer than the one
+	// the sets were worked out for.
+	const std::vector<Physics::FixtureChild>* GetVisibleFixtures(
+		const b2Vec2& position,
+		const float rayLength) const;
+
+	// Fixtures are saved by their body's position and their index in its fixture list, since
+	// that's all that stays the same when the World is saved and loaded.
+	bool ToJson(nlohmann::json& j) const;
+
+	// Fails if any of the saved fixtures can't be found in grid, or grid has fixtures that
+	// weren't there when the sets were saved.
+	bool FromJson(const nlohmann::json& j, const Physics::StaticGeometryGrid& grid);
+
+private:
+	using CellKey = std::uint64_t;
+
+	static CellKey MakeKey(const int32 x, const int32 y) {
+		return ((CellKey)(std::uint32_t)x << 32) | (CellKey)(std::uint32_t)y;
+	}
+
+	int32 ToCell(const float32 coordinate) const {
+		return (int32)floorf(coordinate / mCellSize);
+	}
+
+	float mCellSize = 4.0f;
+	float mRayLength = 0.0f;
+
+	// Every fixture (or chain child) in the grid when the sets were worked out.
+	std::vector<Physics::FixtureChild> mFixtures;
+
+	// Indices into mFixtures, sorted.
+	std::unordered_map<CellKey, std::vector<int>> mCellIndices;
+
+	std::unordered_map<CellKey, std::vector<Physics::FixtureChild>> mCells;
+};
+
+// The file the World saved to filename keeps its PotentiallyVisibleSets in.
+std::string GetPotentiallyVisibleSetsFilename(const std::string& worldFilename);
+
+}
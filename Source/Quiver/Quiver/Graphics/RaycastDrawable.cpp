@@ -0,0 +1,182 @@
+#include "RaycastDrawable.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace qvr {
+
+void SortBackToFront(RaycastDrawable* begin, RaycastDrawable* end)
+{
+	if (begin == end) return;
+
+	for (RaycastDrawable* it = begin + 1; it != end; ++it)
+	{
+		if (!IsDrawnBefore(*it, *(it - 1))) continue;
+
+		const RaycastDrawable drawable = *it;
+
+		RaycastDrawable* hole = it;
+
+		do
+		{
+			*hole = *(hole - 1);
+			--hole;
+		} while (hole != begin && IsDrawnBefore(drawable, *(hole - 1)));
+
+		*hole = drawable;
+	}
+}
+
+namespace {
+
+// The range of slopes a line through an anchor sample can have and still pass within 
+// some tolerance of every sample added so far.
+class SlopeCone
+{
+public:
+	bool Add(const float dx, const float dy, const float tolerance)
+	{
+		m_Min = std::max(m_Min, (dy - tolerance) / dx);
+		m_Max = std::min(m_Max, (dy + tolerance) / dx);
+		return m_Min <= m_Max;
+	}
+
+	float GetSlope() const { return (m_Min + m_Max) / 2.0f; }
+
+private:
+	float m_Min = -std::numeric_limits<float>::max();
+	float m_Max = std::numeric_limits<float>::max();
+};
+
+bool CanMerge(const RaycastDrawable& drawable)
+{
+	return drawable.m_DrawFront && drawable.m_DistanceNear > 0.0f;
+}
+
+bool CanMerge(const RaycastDrawable& left, const RaycastDrawable& right)
+{
+	return
+		CanMerge(right) &&
+		right.m_X == left.m_X + 1.0f &&
+		right.m_RenderData == left.m_RenderData &&
+		right.m_Texture == left.m_Texture &&
+		right.m_BlendColor == left.m_BlendColor &&
+		right.m_Normal == left.m_Normal &&
+		right.m_VTop == left.m_VTop &&
+		right.m_VBottom == left.m_VBottom;
+}
+
+}
+
+void MergeFrontFaces(
+	std::vector<RaycastDrawable>& drawables,
+	std::vector<RaycastFrontQuad>& quads,
+	const float farFieldDistance)
+{
+	// Across a flat face, a column's top, bottom, 1/distance and u/distance all change 
+	// linearly with its x. A run of columns can be replaced with a quad if there's a line 
+	// through each of those that passes close enough to every column's value.
+	// Close enough rather than exactly, so edge pixels and texels can come out differently
+	// from the lines'. The values are rounded floats, so an exact fit would merge nothing.
+	const float nearPixelTolerance = 0.25f;
+	const float inverseDistanceTolerance = 1e-3f;
+	const float nearTexelTolerance = 0.25f;
+
+	// Far-field faces are a few pixels tall at most, so being out by a pixel doesn't show.
+	const float farPixelTolerance = 1.0f;
+	const float farTexelTolerance = 1.0f;
+
+	const int drawableCount = (int)drawables.size();
+
+	int first = 0;
+
+	while (first < drawableCount)
+	{
+		RaycastDrawable& anchor = drawables[first];
+
+		if (!CanMerge(anchor))
+		{
+			first++;
+			continue;
+		}
+
+		const float anchorInverseDistance = 1.0f / anchor.m_DistanceNear;
+		const float anchorUOverDistance = anchor.m_U * anchorInverseDistance;
+
+		const bool farField = anchor.m_DistanceNear >= farFieldDistance;
+		const float pixelTolerance = farField ? farPixelTolerance : nearPixelTolerance;
+		const float texelTolerance = farField ? farTexelTolerance : nearTexelTolerance;
+
+		SlopeCone top, bottom, inverseDistance, uOverDistance;
+
+		int last = first;
+
+		while (last + 1 < drawableCount && CanMerge(drawables[last], drawables[last + 1]))
+		{
+			const RaycastDrawable& next = drawables[last + 1];
+
+			const float dx = next.m_X - anchor.m_X;
+			const float nextInverseDistance = 1.0f / next.m_DistanceNear;
+
+			const bool fits =
+				top.Add(dx, next.m_Top - anchor.m_Top, pixelTolerance) &&
+				bottom.Add(dx, next.m_Bottom - anchor.m_Bottom, pixelTolerance) &&
+				inverseDistance.Add(
+					dx, 
+					nextInverseDistance - anchorInverseDistance, 
+					inverseDistanceTolerance * anchorInverseDistance) &&
+				uOverDistance.Add(
+					dx, 
+					(next.m_U * nextInverseDistance) - anchorUOverDistance, 
+					texelTolerance * anchorInverseDistance);
+
+			if (!fits) break;
+
+			last++;
+		}
+
+		// A quad one column wide is no cheaper than a line.
+		if (last == first)
+		{
+			first++;
+			continue;
+		}
+
+		// The drawables' values are for the middle of their columns, and the quad's edges 
+		// are half a column further out.
+		const float dxLeft = -0.5f;
+		const float dxRight = (drawables[last].m_X - anchor.m_X) + 0.5f;
+
+		const float inverseDistanceLeft = anchorInverseDistance + (inverseDistance.GetSlope() * dxLeft);
+		const float inverseDistanceRight = anchorInverseDistance + (inverseDistance.GetSlope() * dxRight);
+
+		RaycastFrontQuad quad;
+		quad.m_Left = anchor.m_X;
+		quad.m_Right = drawables[last].m_X + 1.0f;
+		quad.m_TopLeft = anchor.m_Top + (top.GetSlope() * dxLeft);
+		quad.m_TopRight = anchor.m_Top + (top.GetSlope() * dxRight);
+		quad.m_BottomLeft = anchor.m_Bottom + (bottom.GetSlope() * dxLeft);
+		quad.m_BottomRight = anchor.m_Bottom + (bottom.GetSlope() * dxRight);
+		quad.m_DistanceLeft = 1.0f / inverseDistanceLeft;
+		quad.m_DistanceRight = 1.0f / inverseDistanceRight;
+		quad.m_ULeft = (anchorUOverDistance + (uOverDistance.GetSlope() * dxLeft)) / inverseDistanceLeft;
+		quad.m_URight = (anchorUOverDistance + (uOverDistance.GetSlope() * dxRight)) / inverseDistanceRight;
+		quad.m_VTop = anchor.m_VTop;
+		quad.m_VBottom = anchor.m_VBottom;
+		quad.m_BlendColor = anchor.m_BlendColor;
+		quad.m_Normal = anchor.m_Normal;
+		quad.m_Texture = anchor.m_Texture;
+
+		quads.push_back(quad);
+
+		// Their top and bottom faces still get drawn as lines.
+		for (int index = first; index <= last; index++)
+		{
+			drawables[index].m_DrawFront = false;
+		}
+
+		first = last + 1;
+	}
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector3.hpp>
+
+namespace sf {
+class Texture;
+}
+
+namespace qvr {
+
+class FixtureRenderData;
+
+// One screen column's slice of a fixture, as worked out by the WorldRaycastRenderer.
+// It's drawn as up to three vertical lines: the front face, and the top or bottom face.
+struct RaycastDrawable {
+	float m_Top;
+	float m_Bottom;
+	float m_X;
+	float m_DistanceFar;
+	float m_DistanceNear;
+	float m_U;
+	float m_VTop;
+	float m_VBottom;
+	float m_FarY;
+	// Where the texture's top-left texel is in m_Texture. Only not (0, 0) once m_Texture has 
+	// been swapped for a TextureAtlas page.
+	float m_UOrigin;
+	float m_VOrigin;
+	sf::Color m_BlendColor;
+	sf::Vector3f m_Normal;
+	const sf::Texture* m_Texture;
+	// The fixture this is a slice of.
+	const FixtureRenderData* m_RenderData;
+	bool m_DrawFront;
+	bool m_DrawTop;
+	bool m_DrawBottom;
+};
+
+// The front face of a run of neighbouring columns' drawables, drawn as one textured quad.
+// Its left and right edges lie on pixel boundaries.
+struct RaycastFrontQuad {
+	float m_Left;
+	float m_Right;
+	float m_TopLeft;
+	float m_BottomLeft;
+	float m_TopRight;
+	float m_BottomRight;
+	float m_DistanceLeft;
+	float m_DistanceRight;
+	float m_ULeft;
+	float m_URight;
+	float m_VTop;
+	float m_VBottom;
+	sf::Color m_BlendColor;
+	sf::Vector3f m_Normal;
+	const sf::Texture* m_Texture;
+};
+
+// True if a has to be drawn before b (i.e. it's further away).
+inline bool IsDrawnBefore(const RaycastDrawable& a, const RaycastDrawable& b)
+{
+	if (a.m_DistanceFar != b.m_DistanceFar)
+	{
+		return (a.m_DistanceFar > b.m_DistanceFar);
+	}
+
+	return (a.m_FarY > b.m_FarY);
+}
+
+// Puts one column's drawables in back-to-front order. Columns never overlap each other,
+// so there's no need to sort the whole screen's worth together.
+// They come out of the renderer almost sorted already, which is why this is an insertion sort.
+void SortBackToFront(RaycastDrawable* begin, RaycastDrawable* end);
+
+// Replaces the front faces of runs of neighbouring drawables (one layer of them, in column
+// order) with quads, wherever a quad can stand in for the lines without being visibly 
+// different. It isn't exact: each column's top and bottom can be out by a quarter of a pixel,
+// and its texture coordinate by a quarter of a texel. Runs that start beyond 
+// farFieldDistance can be out by a whole one.
+void MergeFrontFaces(
+	std::vector<RaycastDrawable>& drawables,
+	std::vector<RaycastFrontQuad>& quads,
+	const float farFieldDistance);
+
+}
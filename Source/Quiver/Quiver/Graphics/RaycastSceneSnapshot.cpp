@@ -0,0 +1,302 @@
+#include "RaycastSceneSnapshot.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
+
+#include "Quiver/Graphics/BillboardStore.h"
+#include "Quiver/Graphics/FixtureRenderData.h"
+
+namespace qvr {
+
+namespace {
+
+bool operator==(const b2Transform& a, const b2Transform& b)
+{
+	return a.p == b.p && a.q.s == b.q.s && a.q.c == b.q.c;
+}
+
+template<typename State>
+bool CompareKeys(const State& a, const State& b)
+{
+	return std::less<const void*>()(a.m_Key, b.m_Key);
+}
+
+template<typename State>
+b2AABB ComputeAABB(const State& state)
+{
+	if (!state.m_Fixture)
+	{
+		const b2Vec2 extent(state.m_Radius, state.m_Radius);
+
+		b2AABB aabb;
+		aabb.lowerBound = state.m_Transform.p - extent;
+		aabb.upperBound = state.m_Transform.p + extent;
+		return aabb;
+	}
+
+	const b2Shape* shape = state.m_Fixture->GetShape();
+
+	b2AABB aabb;
+	shape->ComputeAABB(&aabb, state.m_Transform, 0);
+
+	for (int32 childIndex = 1; childIndex < shape->GetChildCount(); childIndex++)
+	{
+		b2AABB childAABB;
+		shape->ComputeAABB(&childAABB, state.m_Transform, childIndex);
+
+		aabb.Combine(childAABB);
+	}
+
+	return aabb;
+}
+
+}
+
+unsigned NewBodiesRevision()
+{
+	// Shared by every World and RenderSnapshot, so that no two have the same one.
+	static unsigned nextRevision = 1;
+	return nextRevision++;
+}
+
+const b2Transform& GetDrawnTransform(
+	const b2Body& body, 
+	const std::vector<DrawnTransform>* drawnTransforms)
+{
+	if (drawnTransforms)
+	{
+		const auto it = std::lower_bound(
+			drawnTransforms->begin(),
+			drawnTransforms->end(),
+			&body,
+			[](const DrawnTransform& drawn, const b2Body* key)
+			{
+				return std::less<const b2Body*>()(drawn.m_Body, key);
+			});
+
+		if (it != drawnTransforms->end() && it->m_Body == &body) return it->m_Transform;
+	}
+
+	return body.GetTransform();
+}
+
+void RaycastSceneSnapshot::Update(
+	const b2World& world, 
+	const BillboardStore* billboards, 
+	const BodyChanges* changes,
+	const std::vector<DrawnTransform>* drawnTransforms)
+{
+	m_ChangedRegions.clear();
+
+	const bool movedOnly =
+		changes &&
+		m_World == &world &&
+		m_Revision == changes->m_Revision &&
+		(m_RenderCount == changes->m_RenderCount || m_RenderCount + 1 == changes->m_RenderCount) &&
+		UpdateMovedFixtures(*changes, drawnTransforms);
+
+	if (!movedOnly)
+	{
+		std::swap(m_Fixtures, m_Previous);
+
+		CaptureFixtures(world, drawnTransforms);
+
+		Compare(m_Fixtures, m_Previous);
+	}
+
+	m_World = changes ? &world : nullptr;
+	m_RenderCount = changes ? changes->m_RenderCount : 0;
+	m_Revision = changes ? changes->m_Revision : 0;
+
+	// There aren't many of them, and most of them move every step.
+	std::swap(m_Billboards, m_Previous);
+
+	m_Billboards.clear();
+
+	if (billboards)
+	{
+		CaptureBillboards(*billboards);
+	}
+
+	Compare(m_Billboards, m_Previous);
+}
+
+void RaycastSceneSnapshot::CaptureFixtures(
+	const b2World& world, 
+	const std::vector<DrawnTransform>* drawnTransforms)
+{
+	m_Fixtures.clear();
+
+	for (const b2Body* body = world.GetBodyList(); body; body = body->GetNext())
+	{
+		for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+		{
+			if (fixture->GetUserData() == nullptr) continue;
+
+			const auto renderData = (const FixtureRenderData*)fixture->GetUserData();
+
+			m_Fixtures.push_back(
+				FixtureState{
+					fixture,
+					fixture,
+					renderData,
+					renderData->GetRevision(),
+					GetDrawnTransform(*body, drawnTransforms),
+					0.0f,
+					b2AABB() });
+		}
+	}
+
+	// Bodies and fixtures don't get reordered, so this is usually sorted already.
+	if (!std::is_sorted(m_Fixtures.begin(), m_Fixtures.end(), CompareKeys<FixtureState>))
+	{
+		std::sort(m_Fixtures.begin(), m_Fixtures.end(), CompareKeys<FixtureState>);
+	}
+}
+
+void RaycastSceneSnapshot::CaptureBillboards(const BillboardStore& billboards)
+{
+	for (int index = 0; index < billboards.GetCount(); index++)
+	{
+		const FixtureRenderData& renderData = billboards.GetRenderData(index);
+
+		m_Billboards.push_back(
+			FixtureState{
+				&renderData,
+				nullptr,
+				&renderData,
+				renderData.GetRevision(),
+				b2Transform(billboards.GetPosition(index), b2Rot(0.0f)),
+				billboards.GetRadius(index),
+				b2AABB() });
+	}
+
+	if (!std::is_sorted(m_Billboards.begin(), m_Billboards.end(), CompareKeys<FixtureState>))
+	{
+		std::sort(m_Billboards.begin(), m_Billboards.end(), CompareKeys<FixtureState>);
+	}
+}
+
+bool RaycastSceneSnapshot::UpdateMovedFixtures(
+	const BodyChanges& changes, 
+	const std::vector<DrawnTransform>* drawnTransforms)
+{
+	// Nothing's been created or destroyed, so every fixture and FixtureRenderData is still 
+	// there.
+	auto Changed = [this](FixtureState& state)
+	{
+		m_ChangedRegions.push_back(state.m_AABB);
+
+		state.m_AABB = ComputeAABB(state);
+
+		m_ChangedRegions.push_back(state.m_AABB);
+	};
+
+	for (FixtureState& state : m_Fixtures)
+	{
+		if (state.m_RenderData->GetRevision() == state.m_Revision) continue;
+
+		state.m_Revision = state.m_RenderData->GetRevision();
+		state.m_Transform = GetDrawnTransform(*state.m_Fixture->GetBody(), drawnTransforms);
+
+		Changed(state);
+	}
+
+	for (const b2Body* body : changes.m_MovedBodies)
+	{
+		for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+		{
+			if (fixture->GetUserData() == nullptr) continue;
+
+			const auto it = std::lower_bound(
+				m_Fixtures.begin(),
+				m_Fixtures.end(),
+				fixture,
+				[](const FixtureState& state, const b2Fixture* key)
+				{
+					return std::less<const void*>()(state.m_Key, key);
+				});
+
+			// Something's been changed without OnBodiesChanged being called.
+			if (it == m_Fixtures.end() || it->m_Key != fixture) return false;
+
+			const b2Transform& transform = GetDrawnTransform(*body, drawnTransforms);
+
+			if (it->m_Transform == transform) continue;
+
+			it->m_Transform = transform;
+
+			Changed(*it);
+		}
+	}
+
+	return true;
+}
+
+void RaycastSceneSnapshot::Compare(
+	std::vector<FixtureState>& states, 
+	const std::vector<FixtureState>& previousStates)
+{
+	// Walk through both snapshots together.
+	auto previous = previousStates.begin();
+
+	for (FixtureState& state : states)
+	{
+		// Removed.
+		while (previous != previousStates.end() && CompareKeys(*previous, state))
+		{
+			m_ChangedRegions.push_back(previous->m_AABB);
+			++previous;
+		}
+
+		if (previous != previousStates.end() && previous->m_Key == state.m_Key)
+		{
+			if (previous->m_RenderData == state.m_RenderData &&
+				previous->m_Revision == state.m_Revision &&
+				previous->m_Transform == state.m_Transform &&
+				previous->m_Radius == state.m_Radius)
+			{
+				state.m_AABB = previous->m_AABB;
+			}
+			else
+			{
+				state.m_AABB = ComputeAABB(state);
+
+				m_ChangedRegions.push_back(previous->m_AABB);
+				m_ChangedRegions.push_back(state.m_AABB);
+			}
+
+			++previous;
+		}
+		else
+		{
+			// Added.
+			state.m_AABB = ComputeAABB(state);
+
+			m_ChangedRegions.push_back(state.m_AABB);
+		}
+	}
+
+	// Removed.
+	for (; previous != previousStates.end(); ++previous)
+	{
+		m_ChangedRegions.push_back(previous->m_AABB);
+	}
+}
+
+void RaycastSceneSnapshot::Clear()
+{
+	m_Fixtures.clear();
+	m_Billboards.clear();
+	m_Previous.clear();
+	m_ChangedRegions.clear();
+
+	m_World = nullptr;
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Common/b2Math.h>
+
+class b2Body;
+class b2Fixture;
+class b2World;
+
+namespace qvr {
+
+class BillboardStore;
+class FixtureRenderData;
+
+// What a World knows about which of its bodies might have moved, so that a 
+// RaycastSceneSnapshot only has to look at those.
+struct BodyChanges
+{
+	// Goes up by one every time the World is rendered.
+	int m_RenderCount = 0;
+	// Changes whenever a body is created or destroyed, moved outside of a step, or has its
+	// type or fixtures changed, or which of them have FixtureRenderData. No two Worlds ever
+	// have the same one.
+	unsigned m_Revision = 0;
+	// The bodies that might have moved since the World was last rendered: the ones that 
+	// were awake at the start or the end of any step since, and the ones render 
+	// interpolation moves. Nothing else can have.
+	std::vector<const b2Body*> m_MovedBodies;
+};
+
+// A BodyChanges::m_Revision that nothing has had before.
+unsigned NewBodiesRevision();
+
+// Where a body is drawn, when that isn't where it is: part way through the World's last 
+// step, for render interpolation.
+struct DrawnTransform
+{
+	const b2Body* m_Body;
+	b2Transform m_Transform;
+};
+
+// drawnTransforms has to be sorted by body, and can be null.
+const b2Transform& GetDrawnTransform(
+	const b2Body& body, 
+	const std::vector<DrawnTransform>* drawnTransforms);
+
+// Remembers the state of every fixture the WorldRaycastRenderer can see, so that it can tell
+// which parts of the World have changed from one frame to the next.
+class RaycastSceneSnapshot
+{
+public:
+	// Takes a new snapshot, and works out the regions covered by every fixture that has
+	// been added, removed, moved or changed since the last one. A fixture that has moved
+	// gives both the region it used to cover and the one it covers now. Billboards count 
+	// as fixtures too.
+	// With the World's BodyChanges, and as long as it was last updated with them either
+	// this time round or the last time the World was rendered, only the bodies they say 
+	// might have moved get their transforms looked at. Every fixture's FixtureRenderData still gets its revision looked at, since 
+	// animations change those without touching the bodies.
+	// Bodies in drawnTransforms are taken to be where it says rather than where they are.
+	void Update(
+		const b2World& world, 
+		const BillboardStore* billboards = nullptr, 
+		const BodyChanges* changes = nullptr,
+		const std::vector<DrawnTransform>* drawnTransforms = nullptr);
+
+	const std::vector<b2AABB>& GetChangedRegions() const { return m_ChangedRegions; }
+
+	// Forgets the last snapshot, so that everything counts as added next time.
+	void Clear();
+
+private:
+	struct FixtureState
+	{
+		// The fixture, or for a billboard, its render data.
+		const void* m_Key;
+		// Null for a billboard.
+		const b2Fixture* m_Fixture;
+		const FixtureRenderData* m_RenderData;
+		unsigned m_Revision;
+		b2Transform m_Transform;
+		// Billboards only.
+		float m_Radius;
+		b2AABB m_AABB;
+	};
+
+	// Each sorted by key.
+	std::vector<FixtureState> m_Fixtures;
+	std::vector<FixtureState> m_Billboards;
+	std::vector<FixtureState> m_Previous;
+
+	std::vector<b2AABB> m_ChangedRegions;
+
+	// The BodyChanges the fixtures were last updated with.
+	const b2World* m_World = nullptr;
+	int m_RenderCount = 0;
+	unsigned m_Revision = 0;
+
+	void CaptureFixtures(const b2World& world, const std::vector<DrawnTransform>* drawnTransforms);
+	void CaptureBillboards(const BillboardStore& billboards);
+
+	// Only looks at the bodies that might have moved. False if it can't be done that way.
+	bool UpdateMovedFixtures(
+		const BodyChanges& changes, 
+		const std::vector<DrawnTransform>* drawnTransforms);
+
+	// Fills in states' AABBs, and adds the regions of everything that's different from 
+	// the previous states.
+	void Compare(std::vector<FixtureState>& states, const std::vector<FixtureState>& previous);
+};
+
+}
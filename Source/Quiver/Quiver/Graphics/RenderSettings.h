@@ -7,17 +7,99 @@ namespace qvr {
 struct RenderSettings
 {
 	float m_RayLength = 50.0f;
+	// Stop rays where the World's fog reaches full intensity, if its maximum intensity is 1.
+	// Fog is added to the colour of what it covers rather than replacing it, so this only 
+	// looks the same if the fog washes out anything that far away.
+	bool m_ClampRayLengthToFog = false;
+	// Beyond this distance, only draw the front faces of fixtures, and merge them more 
+	// loosely. 0 turns it off.
+	float m_FarFieldDistance = 0.0f;
+	// How many threads the raycast renderer splits the screen columns between.
+	int m_ThreadCount = 1;
+	// How many neighbouring columns get cast through the broadphase together (1, 4, 8 or 16).
+	int m_RayPacketSize = 8;
+	// Cast against the World's static geometry grid first, and only against everything
+	// else through the broadphase.
+	bool m_UseStaticGeometryGrid = true;
+	// Gather the fixtures inside the camera's view (as far as m_RayLength reaches) into a 
+	// small tree every frame, and cast against that instead of the whole broadphase.
+	bool m_CullToView = false;
+	// Cast against only the static geometry the World's PotentiallyVisibleSets say can be 
+	// seen from the camera's cell, when it has a set for it.
+	bool m_UsePotentiallyVisibleSets = true;
+	// Draw the front faces of runs of neighbouring columns that hit the same face as one
+	// textured quad instead of one line per column. Off by default, because the quads only
+	// come close to the lines: edges can be out by a fraction of a pixel, and texture 
+	// coordinates by a fraction of a texel (see MergeFrontFaces).
+	bool m_MergeFrontFaces = false;
+	// Draw opaque drawables with depth testing, in whatever order batches best, and only keep
+	// the translucent ones in back-to-front order. Texels that are mostly see-through get 
+	// thrown away rather than blended. Needs a render target with a depth buffer.
+	bool m_UseDepthBuffer = false;
+	// Draw with the pages of the TextureLibrary's atlas, if it has one, in place of the 
+	// textures packed onto them.
+	bool m_UseTextureAtlas = true;
+	// Draw far-away things from smaller copies of their textures.
+	bool m_UseTextureLods = true;
+	// Draw with the SoftwareRasterizer instead of through OpenGL, and copy the result over.
+	bool m_UseSoftwareRasterizer = false;
+	// Only cast the columns that could look different from last frame.
+	bool m_ReuseColumns = true;
+	// Cast every Nth column's ray, and fill in the ones in between from their neighbours 
+	// wherever they hit the same face. Anything thin enough to fit between two cast columns 
+	// can go missing.
+	int m_ColumnStride = 1;
+	// Pick m_ColumnStride automatically to keep rendering within m_RenderBudgetMs.
+	bool m_AdaptiveColumnStride = false;
+	float m_RenderBudgetMs = 8.0f;
+	int m_MaxColumnStride = 4;
 
 	RenderSettings() = default;
 
 	RenderSettings(const nlohmann::json& j) noexcept {
 		if (j.is_object()) {
 			m_RayLength = j.value<float>("RayLength", 50.0f);
+			m_ClampRayLengthToFog = j.value<bool>("ClampRayLengthToFog", false);
+			m_FarFieldDistance = j.value<float>("FarFieldDistance", 0.0f);
+			m_ThreadCount = j.value<int>("ThreadCount", 1);
+			m_RayPacketSize = j.value<int>("RayPacketSize", 8);
+			m_UseStaticGeometryGrid = j.value<bool>("UseStaticGeometryGrid", true);
+			m_CullToView = j.value<bool>("CullToView", false);
+			m_UsePotentiallyVisibleSets = j.value<bool>("UsePotentiallyVisibleSets", true);
+			m_MergeFrontFaces = j.value<bool>("MergeFrontFaces", false);
+			m_UseDepthBuffer = j.value<bool>("UseDepthBuffer", false);
+			m_UseTextureAtlas = j.value<bool>("UseTextureAtlas", true);
+			m_UseTextureLods = j.value<bool>("UseTextureLods", true);
+			m_UseSoftwareRasterizer = j.value<bool>("UseSoftwareRasterizer", false);
+			m_ReuseColumns = j.value<bool>("ReuseColumns", true);
+			m_ColumnStride = j.value<int>("ColumnStride", 1);
+			m_AdaptiveColumnStride = j.value<bool>("AdaptiveColumnStride", false);
+			m_RenderBudgetMs = j.value<float>("RenderBudgetMs", 8.0f);
+			m_MaxColumnStride = j.value<int>("MaxColumnStride", 4);
 		}
 	}
 
 	nlohmann::json ToJson() const {
-		return nlohmann::json{ {"RayLength", m_RayLength} };
+		return nlohmann::json{ 
+			{"RayLength", m_RayLength},
+			{"ClampRayLengthToFog", m_ClampRayLengthToFog},
+			{"FarFieldDistance", m_FarFieldDistance},
+			{"ThreadCount", m_ThreadCount},
+			{"RayPacketSize", m_RayPacketSize},
+			{"UseStaticGeometryGrid", m_UseStaticGeometryGrid},
+			{"CullToView", m_CullToView},
+			{"UsePotentiallyVisibleSets", m_UsePotentiallyVisibleSets},
+			{"MergeFrontFaces", m_MergeFrontFaces},
+			{"UseDepthBuffer", m_UseDepthBuffer},
+			{"UseTextureAtlas", m_UseTextureAtlas},
+			{"UseTextureLods", m_UseTextureLods},
+			{"UseSoftwareRasterizer", m_UseSoftwareRasterizer},
+			{"ReuseColumns", m_ReuseColumns},
+			{"ColumnStride", m_ColumnStride},
+			{"AdaptiveColumnStride", m_AdaptiveColumnStride},
+			{"RenderBudgetMs", m_RenderBudgetMs},
+			{"MaxColumnStride", m_MaxColumnStride}
+		};
 	}
 };
 
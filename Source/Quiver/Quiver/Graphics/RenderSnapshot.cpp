@@ -0,0 +1,297 @@
+#include "RenderSnapshot.h"
+
+#include <cassert>
+
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include "Quiver/Graphics/BillboardStore.h"
+#include "Quiver/Graphics/FixtureRenderData.h"
+#include "Quiver/Graphics/Sky.h"
+#include "Quiver/Graphics/TextureLibrary.h"
+#include "Quiver/Physics/StaticGeometryGrid.h"
+#include "Quiver/World/World.h"
+
+namespace qvr {
+
+RenderSnapshot::RenderSnapshot()
+	: mPhysicsWorld(std::make_unique<b2World>(b2Vec2_zero))
+	, mStaticGeometry(std::make_unique<Physics::StaticGeometryGrid>())
+	, mBillboards(std::make_unique<BillboardStore>())
+{
+	mBodyChanges.m_Revision = NewBodiesRevision();
+}
+
+RenderSnapshot::~RenderSnapshot() = default;
+
+void RenderSnapshot::Capture(World& world, const Camera3D& camera)
+{
+	assert(world.GetPhysicsWorld());
+
+	world.UpdateDetachedRenderComponents();
+
+	mCamera = camera;
+	mCamera.SetOverlayDrawer(nullptr);
+
+	mAmbientLight = world.GetAmbientLight();
+	mDirectionalLight = world.GetDirectionalLight();
+	mFog = world.GetFog();
+	mGroundColor = world.groundColor;
+	mSkyColor = world.skyColor;
+	mRenderSettings = world.GetRenderSettings();
+
+	mSky = &world.GetSky();
+	mAtlas = &world.GetTextureLibrary().GetAtlas();
+
+	for (auto& entry : mBodies)
+	{
+		entry.second.mCaptured = false;
+	}
+
+	const Physics::StaticGeometryGrid& worldGrid = world.GetStaticGeometry();
+
+	if (mStaticGeometry->GetCellSize() != worldGrid.GetCellSize())
+	{
+		mStaticGeometry = std::make_unique<Physics::StaticGeometryGrid>(worldGrid.GetCellSize());
+
+		for (auto& entry : mBodies)
+		{
+			if (entry.second.mInGrid)
+			{
+				mStaticGeometry->AddBody(*entry.second.mBody);
+			}
+		}
+	}
+
+	mBodyChanges.m_RenderCount++;
+	mBodyChanges.m_MovedBodies.clear();
+
+	bool bodiesChanged = false;
+
+	const b2World& physicsWorld = *world.GetPhysicsWorld();
+
+	// Captured where the World's render interpolation says to draw the bodies.
+	const std::vector<DrawnTransform>& drawnTransforms = world.GetDrawnTransforms();
+
+	for (const b2Body* body = physicsWorld.GetBodyList(); body; body = body->GetNext())
+	{
+		mFixtures.clear();
+		mSourceRenderData.clear();
+
+		for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+		{
+			if (fixture->GetUserData() == nullptr) continue;
+
+			mFixtures.push_back(fixture);
+			mSourceRenderData.push_back((const FixtureRenderData*)fixture->GetUserData());
+		}
+
+		if (mFixtures.empty()) continue;
+
+		auto it = mBodies.find(body);
+
+		// Fixtures don't change shape once they're made, so the body only has to be mirrored
+		// again if it has different ones.
+		if (it != mBodies.end() &&
+			(it->second.mFixtures != mFixtures || it->second.mSourceRenderData != mSourceRenderData))
+		{
+			DestroyMirroredBody(it->second);
+			mBodies.erase(it);
+			it = mBodies.end();
+		}
+
+		if (it == mBodies.end())
+		{
+			it = mBodies.emplace(body, MirroredBody{}).first;
+
+			MirrorBody(it->second, *body, GetDrawnTransform(*body, &drawnTransforms));
+
+			bodiesChanged = true;
+		}
+
+		MirroredBody& mirrored = it->second;
+
+		const b2Transform& transform = GetDrawnTransform(*body, &drawnTransforms);
+
+		if (!(mirrored.mBody->GetPosition() == transform.p) ||
+			mirrored.mBody->GetAngle() != transform.q.GetAngle())
+		{
+			mirrored.mBody->SetTransform(transform.p, transform.q.GetAngle());
+
+			mBodyChanges.m_MovedBodies.push_back(mirrored.mBody);
+
+			if (mirrored.mInGrid)
+			{
+				mStaticGeometry->UpdateBody(*mirrored.mBody);
+			}
+		}
+
+		if (mirrored.mInGrid != worldGrid.Contains(*body))
+		{
+			mirrored.mInGrid = !mirrored.mInGrid;
+
+			if (mirrored.mInGrid)
+			{
+				mStaticGeometry->AddBody(*mirrored.mBody);
+			}
+			else
+			{
+				mStaticGeometry->RemoveBody(*mirrored.mBody);
+			}
+
+			bodiesChanged = true;
+		}
+
+		for (unsigned index = 0; index < mirrored.mRenderData.size(); index++)
+		{
+			const FixtureRenderData& source = *mirrored.mSourceRenderData[index];
+
+			if (mirrored.mRenderData[index]->GetRevision() != source.GetRevision())
+			{
+				*mirrored.mRenderData[index] = source;
+			}
+		}
+
+		mirrored.mCaptured = true;
+	}
+
+	for (auto it = mBodies.begin(); it != mBodies.end();)
+	{
+		if (it->second.mCaptured)
+		{
+			++it;
+			continue;
+		}
+
+		DestroyMirroredBody(it->second);
+		it = mBodies.erase(it);
+
+		bodiesChanged = true;
+	}
+
+	if (bodiesChanged)
+	{
+		mBodyChanges.m_Revision = NewBodiesRevision();
+	}
+
+	CaptureBillboards(world.GetBillboards());
+
+	mRenderData.clear();
+
+	for (const auto& entry : mBodies)
+	{
+		for (const auto& renderData : entry.second.mRenderData)
+		{
+			mRenderData.push_back(renderData.get());
+		}
+	}
+
+	for (const auto& renderData : mBillboardRenderData)
+	{
+		mRenderData.push_back(renderData.get());
+	}
+}
+
+void RenderSnapshot::MirrorBody(
+	MirroredBody& mirrored, 
+	const b2Body& body, 
+	const b2Transform& transform)
+{
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_staticBody;
+	bodyDef.position = transform.p;
+	bodyDef.angle = transform.q.GetAngle();
+	// The grid only takes bodies with user data.
+	bodyDef.userData = const_cast<b2Body*>(&body);
+
+	mirrored.mBody = mPhysicsWorld->CreateBody(&bodyDef);
+	mirrored.mFixtures = mFixtures;
+	mirrored.mSourceRenderData = mSourceRenderData;
+
+	for (unsigned index = 0; index < mFixtures.size(); index++)
+	{
+		mirrored.mRenderData.push_back(
+			std::make_unique<FixtureRenderData>(*mSourceRenderData[index]));
+
+		b2FixtureDef fixtureDef;
+		fixtureDef.shape = mFixtures[index]->GetShape();
+		fixtureDef.userData = mirrored.mRenderData.back().get();
+
+		mirrored.mBody->CreateFixture(&fixtureDef);
+	}
+
+	mirrored.mInGrid = false;
+}
+
+void RenderSnapshot::DestroyMirroredBody(MirroredBody& mirrored)
+{
+	if (mirrored.mInGrid)
+	{
+		mStaticGeometry->RemoveBody(*mirrored.mBody);
+	}
+
+	mPhysicsWorld->DestroyBody(mirrored.mBody);
+}
+
+void RenderSnapshot::CaptureBillboards(const BillboardStore& billboards)
+{
+	// There aren't many, and most of them move every step, so they're copied from scratch.
+	mBillboards = std::make_unique<BillboardStore>();
+
+	const int count = billboards.GetCount();
+
+	while ((int)mBillboardRenderData.size() < count)
+	{
+		mBillboardRenderData.push_back(std::make_unique<FixtureRenderData>());
+	}
+
+	mBillboardRenderData.resize(count);
+
+	for (int index = 0; index < count; index++)
+	{
+		*mBillboardRenderData[index] = billboards.GetRenderData(index);
+
+		mBillboards->Add(
+			*mBillboardRenderData[index],
+			billboards.GetPosition(index),
+			billboards.GetRadius(index));
+	}
+}
+
+RaycastScene RenderSnapshot::GetRaycastScene() const
+{
+	RaycastScene scene;
+	scene.m_PhysicsWorld = mPhysicsWorld.get();
+	scene.m_StaticGeometry = mStaticGeometry.get();
+	scene.m_Billboards = mBillboards.get();
+	scene.m_Atlas = mAtlas;
+	scene.m_AmbientLight = &mAmbientLight;
+	scene.m_DirectionalLight = &mDirectionalLight;
+	scene.m_Fog = &mFog;
+	scene.m_RenderData = &mRenderData;
+	scene.m_BodyChanges = &mBodyChanges;
+	return scene;
+}
+
+void RenderSnapshot::Render(sf::RenderTarget& target, WorldRaycastRenderer& raycastRenderer) const
+{
+	assert(!IsEmpty());
+
+	RenderBackground3D(
+		target,
+		mCamera,
+		mGroundColor,
+		mSkyColor,
+		mAmbientLight,
+		mDirectionalLight,
+		mFog,
+		*mSky);
+
+	const RaycastView view{ &mCamera, &target };
+
+	raycastRenderer.Render(GetRaycastScene(), gsl::make_span(&view, 1), mRenderSettings);
+}
+
+}
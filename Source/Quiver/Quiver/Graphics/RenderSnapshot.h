@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+
+#include "Quiver/Graphics/Camera3D.h"
+#include "Quiver/Graphics/Fog.h"
+#include "Quiver/Graphics/Light.h"
+#include "Quiver/Graphics/RaycastSceneSnapshot.h"
+#include "Quiver/Graphics/RenderSettings.h"
+#include "Quiver/Graphics/WorldRaycastRenderer.h"
+
+class b2Body;
+class b2Fixture;
+class b2World;
+
+namespace sf {
+class RenderTarget;
+}
+
+namespace qvr {
+
+class BillboardStore;
+class FixtureRenderData;
+class Sky;
+class TextureAtlas;
+class World;
+
+namespace Physics {
+class StaticGeometryGrid;
+}
+
+// A copy of what it takes to draw a World's 3D view, as it was when it was captured (with
+// the World's render interpolation applied), so that it can be drawn on another thread 
+// while the World gets on with its next steps.
+// The fixtures that have FixtureRenderData are copied into a b2World of the snapshot's own,
+// which never gets stepped, along with copies of their FixtureRenderData. Capturing again
+// only copies what's changed since the last time.
+// The World's textures, sky and texture atlas are shared rather than copied, so they
+// mustn't change while a snapshot of it is being rendered.
+// The mirrored bodies of the World's static geometry get a StaticGeometryGrid of their own.
+// The World's PotentiallyVisibleSets list the World's fixtures rather than the mirrored 
+// ones, so they aren't used: RenderSettings::m_UsePotentiallyVisibleSets does nothing here.
+// Mirrored fixtures stay the same from one capture to the next as long as what they mirror
+// does, so a WorldRaycastRenderer that only ever renders this snapshot can reuse columns 
+// (see RenderSettings::m_ReuseColumns). One that takes turns between two snapshots can't,
+// and mustn't try: the columns it kept from the other one point at its copies.
+class RenderSnapshot {
+public:
+	RenderSnapshot();
+	~RenderSnapshot();
+
+	RenderSnapshot(const RenderSnapshot&) = delete;
+	RenderSnapshot(const RenderSnapshot&&) = delete;
+
+	RenderSnapshot& operator=(const RenderSnapshot&) = delete;
+	RenderSnapshot& operator=(const RenderSnapshot&&) = delete;
+
+	// On the thread that steps the World, and never while this snapshot is being rendered.
+	// The camera is copied without its overlay, which has to be drawn on that thread too.
+	void Capture(World& world, const Camera3D& camera);
+
+	bool IsEmpty() const { return mSky == nullptr; }
+
+	const Camera3D& GetCamera() const { return mCamera; }
+
+	// Only touches the snapshot, so it can be done on any thread.
+	RaycastScene GetRaycastScene() const;
+
+	// Draws the ground, the sky and the raycast view into target, with the World's
+	// RenderSettings as they were when the snapshot was captured.
+	void Render(sf::RenderTarget& target, WorldRaycastRenderer& raycastRenderer) const;
+
+private:
+	// A static body in mPhysicsWorld standing in for one of the World's. Its user data is 
+	// the body it mirrors, which is never dereferenced.
+	struct MirroredBody
+	{
+		b2Body* mBody;
+		// The fixtures it copies, with their FixtureRenderData, in order.
+		std::vector<const b2Fixture*> mFixtures;
+		std::vector<const FixtureRenderData*> mSourceRenderData;
+		std::vector<std::unique_ptr<FixtureRenderData>> mRenderData;
+		// Whether it's in mStaticGeometry, because what it mirrors is in the World's grid.
+		bool mInGrid;
+		bool mCaptured;
+	};
+
+	// At transform, which is where the World draws body.
+	void MirrorBody(MirroredBody& mirrored, const b2Body& body, const b2Transform& transform);
+
+	void DestroyMirroredBody(MirroredBody& mirrored);
+
+	void CaptureBillboards(const BillboardStore& billboards);
+
+	Camera3D mCamera;
+
+	AmbientLight mAmbientLight;
+	DirectionalLight mDirectionalLight;
+	Fog mFog;
+	sf::Color mGroundColor;
+	sf::Color mSkyColor;
+	RenderSettings mRenderSettings;
+
+	const Sky* mSky = nullptr;
+	const TextureAtlas* mAtlas = nullptr;
+
+	std::unique_ptr<b2World> mPhysicsWorld;
+
+	std::unordered_map<const b2Body*, MirroredBody> mBodies;
+
+	std::unique_ptr<Physics::StaticGeometryGrid> mStaticGeometry;
+
+	// Which of the mirrored bodies have moved, counting each capture as a render.
+	BodyChanges mBodyChanges;
+
+	std::unique_ptr<BillboardStore> mBillboards;
+	std::vector<std::unique_ptr<FixtureRenderData>> mBillboardRenderData;
+
+	// Every one of the copies above.
+	std::vector<const FixtureRenderData*> mRenderData;
+
+	// Reused from capture to capture.
+	std::vector<const b2Fixture*> mFixtures;
+	std::vector<const FixtureRenderData*> mSourceRenderData;
+};
+
+}
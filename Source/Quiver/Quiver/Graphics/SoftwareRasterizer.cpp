@@ -0,0 +1,349 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QVR_SOFTWARE_RASTERIZER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace qvr {
+
+void SoftwareFramebuffer::Resize(const int width, const int height)
+{
+	assert(width >= 0);
+	assert(height >= 0);
+
+	m_Width = width;
+	m_Height = height;
+
+	m_Pixels.assign(width * height * 4, 0);
+}
+
+void SoftwareFramebuffer::Clear()
+{
+	std::fill(m_Pixels.begin(), m_Pixels.end(), (sf::Uint8)0);
+}
+
+sf::Color SoftwareFramebuffer::GetPixel(const int x, const int y) const
+{
+	assert(x >= 0 && x < m_Width);
+	assert(y >= 0 && y < m_Height);
+
+	const sf::Uint8* pixel = &m_Pixels[(y * m_Width + x) * 4];
+
+	return sf::Color(pixel[0], pixel[1], pixel[2], pixel[3]);
+}
+
+void SoftwareRasterizer::SetTexture(const sf::Texture* texture, const SoftwareTexture& pixels)
+{
+	m_Textures[texture] = pixels;
+}
+
+void SoftwareRasterizer::RemoveTexture(const sf::Texture* texture)
+{
+	m_Textures.erase(texture);
+}
+
+void SoftwareRasterizer::ClearTextures()
+{
+	m_Textures.clear();
+}
+
+namespace {
+
+// RGBA, from 0 to 1, like a colour in GLSL.
+#ifdef QVR_SOFTWARE_RASTERIZER_SSE
+
+struct Color4
+{
+	__m128 v;
+};
+
+inline Color4 MakeColor4(const float r, const float g, const float b, const float a)
+{
+	return Color4{ _mm_setr_ps(r, g, b, a) };
+}
+
+inline Color4 Load(const sf::Uint8* rgba)
+{
+	int packed;
+	std::memcpy(&packed, rgba, 4);
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bytes = _mm_cvtsi32_si128(packed);
+	const __m128i ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+
+	return Color4{ _mm_mul_ps(_mm_cvtepi32_ps(ints), _mm_set1_ps(1.0f / 255.0f)) };
+}
+
+inline Color4 Clamp(const Color4& c)
+{
+	return Color4{ _mm_min_ps(_mm_max_ps(c.v, _mm_setzero_ps()), _mm_set1_ps(1.0f)) };
+}
+
+// Rounds to the nearest of the 256 levels, as writing to an 8-bit framebuffer does.
+inline void Store(const Color4& c, sf::Uint8* rgba)
+{
+	const __m128i ints = _mm_cvtps_epi32(_mm_mul_ps(Clamp(c).v, _mm_set1_ps(255.0f)));
+	const __m128i shorts = _mm_packs_epi32(ints, ints);
+	const __m128i bytes = _mm_packus_epi16(shorts, shorts);
+
+	const int packed = _mm_cvtsi128_si32(bytes);
+	std::memcpy(rgba, &packed, 4);
+}
+
+inline Color4 operator+(const Color4& a, const Color4& b) { return Color4{ _mm_add_ps(a.v, b.v) }; }
+inline Color4 operator*(const Color4& a, const Color4& b) { return Color4{ _mm_mul_ps(a.v, b.v) }; }
+inline Color4 operator*(const Color4& a, const float b) { return Color4{ _mm_mul_ps(a.v, _mm_set1_ps(b)) }; }
+
+// Blends src over dst the way sf::BlendAlpha does, with dst premultiplied by its alpha.
+inline Color4 BlendOver(const Color4& src, const Color4& dst)
+{
+	const __m128 alpha = _mm_shuffle_ps(src.v, src.v, _MM_SHUFFLE(3, 3, 3, 3));
+
+	// (r * a, g * a, b * a, a)
+	const __m128 premultiplied = _mm_mul_ps(
+		src.v,
+		_mm_add_ps(
+			_mm_mul_ps(alpha, _mm_setr_ps(1.0f, 1.0f, 1.0f, 0.0f)),
+			_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f)));
+
+	return Color4{
+		_mm_add_ps(
+			premultiplied,
+			_mm_mul_ps(dst.v, _mm_sub_ps(_mm_set1_ps(1.0f), alpha))) };
+}
+
+#else
+
+struct Color4
+{
+	float v[4];
+};
+
+inline Color4 MakeColor4(const float r, const float g, const float b, const float a)
+{
+	return Color4{ { r, g, b, a } };
+}
+
+inline Color4 Load(const sf::Uint8* rgba)
+{
+	return MakeColor4(rgba[0] / 255.0f, rgba[1] / 255.0f, rgba[2] / 255.0f, rgba[3] / 255.0f);
+}
+
+inline Color4 Clamp(const Color4& c)
+{
+	Color4 result;
+	for (int i = 0; i < 4; i++) result.v[i] = std::min(std::max(c.v[i], 0.0f), 1.0f);
+	return result;
+}
+
+// Rounds to the nearest of the 256 levels, as writing to an 8-bit framebuffer does.
+inline void Store(const Color4& c, sf::Uint8* rgba)
+{
+	const Color4 clamped = Clamp(c);
+	for (int i = 0; i < 4; i++) rgba[i] = (sf::Uint8)std::nearbyint(clamped.v[i] * 255.0f);
+}
+
+inline Color4 operator+(const Color4& a, const Color4& b)
+{
+	Color4 result;
+	for (int i = 0; i < 4; i++) result.v[i] = a.v[i] + b.v[i];
+	return result;
+}
+
+inline Color4 operator*(const Color4& a, const Color4& b)
+{
+	Color4 result;
+	for (int i = 0; i < 4; i++) result.v[i] = a.v[i] * b.v[i];
+	return result;
+}
+
+inline Color4 operator*(const Color4& a, const float b)
+{
+	Color4 result;
+	for (int i = 0; i < 4; i++) result.v[i] = a.v[i] * b;
+	return result;
+}
+
+// Blends src over dst the way sf::BlendAlpha does, with dst premultiplied by its alpha.
+inline Color4 BlendOver(const Color4& src, const Color4& dst)
+{
+	const float alpha = src.v[3];
+
+	return MakeColor4(
+		src.v[0] * alpha + dst.v[0] * (1.0f - alpha),
+		src.v[1] * alpha + dst.v[1] * (1.0f - alpha),
+		src.v[2] * alpha + dst.v[2] * (1.0f - alpha),
+		alpha + dst.v[3] * (1.0f - alpha));
+}
+
+#endif
+
+inline Color4 Load(const sf::Color& color)
+{
+	return Load(&color.r);
+}
+
+inline Color4 Lerp(const Color4& a, const Color4& b, const float t)
+{
+	return (a * (1.0f - t)) + (b * t);
+}
+
+float CalculateFogIntensity(const RaycastShading& shading, const float distance)
+{
+	if (shading.m_FogMaxDistance <= shading.m_FogMinDistance)
+	{
+		return distance >= shading.m_FogMaxDistance ? shading.m_FogMaxIntensity : 0.0f;
+	}
+
+	const float clamped = std::min(std::max(distance, shading.m_FogMinDistance), shading.m_FogMaxDistance);
+
+	return std::min(
+		(clamped - shading.m_FogMinDistance) / (shading.m_FogMaxDistance - shading.m_FogMinDistance),
+		shading.m_FogMaxIntensity);
+}
+
+// Nearest-neighbour, with coordinates in texels and clamped to the edges, like an sf::Texture
+// that isn't smooth or repeated.
+Color4 Sample(const SoftwareTexture* texture, const float u, const float v)
+{
+	if (!texture)
+	{
+		return MakeColor4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	const int x = std::min(std::max((int)std::floor(u), 0), texture->m_Width - 1);
+	const int y = std::min(std::max((int)std::floor(v), 0), texture->m_Height - 1);
+
+	return Load(texture->m_Pixels + (y * texture->m_Width + x) * 4);
+}
+
+struct LineVertex
+{
+	float m_Y;
+	float m_Distance;
+	float m_U;
+	float m_V;
+};
+
+// Draws a line straight down the middle of pixel column x, the way the shader would draw it.
+// Fog is worked out at each end and interpolated, like it is in the vertex shader.
+void DrawLine(
+	SoftwareFramebuffer& target,
+	const RaycastShading& shading,
+	const int x,
+	const LineVertex& a,
+	const LineVertex& b,
+	const sf::Vector3f& normal,
+	const Color4& color,
+	const SoftwareTexture* texture)
+{
+	if (a.m_Y == b.m_Y) return;
+
+	const Color4 fogColor = Load(shading.m_FogColor);
+	const Color4 fogA = fogColor * CalculateFogIntensity(shading, a.m_Distance);
+	const Color4 fogB = fogColor * CalculateFogIntensity(shading, b.m_Distance);
+
+	const sf::Vector3f& direction = shading.m_DirectionalLightDirection;
+	const float directionalLightIntensity = std::min(std::max(
+		-(normal.x * direction.x + normal.y * direction.y + normal.z * direction.z),
+		0.0f), 1.0f);
+	const Color4 directionalLight = Load(shading.m_DirectionalLightColor) * directionalLightIntensity;
+
+	// Pixels whose centres lie on the line.
+	const float yMin = std::min(a.m_Y, b.m_Y);
+	const float yMax = std::max(a.m_Y, b.m_Y);
+
+	const int firstRow = std::max((int)std::ceil(yMin - 0.5f), 0);
+	const int endRow = std::min((int)std::ceil(yMax - 0.5f), target.GetHeight());
+
+	const float inverseLength = 1.0f / (b.m_Y - a.m_Y);
+
+	sf::Uint8* pixel = target.GetPixels() + (firstRow * target.GetWidth() + x) * 4;
+	const int stride = target.GetWidth() * 4;
+
+	for (int row = firstRow; row < endRow; row++, pixel += stride)
+	{
+		const float t = ((row + 0.5f) - a.m_Y) * inverseLength;
+
+		const Color4 textureColor = Sample(
+			texture,
+			a.m_U + (b.m_U - a.m_U) * t,
+			a.m_V + (b.m_V - a.m_V) * t);
+
+		const Color4 fragment = Clamp((color * textureColor) + Lerp(fogA, fogB, t) + directionalLight);
+
+		Store(BlendOver(fragment, Load(pixel)), pixel);
+	}
+}
+
+}
+
+void SoftwareRasterizer::RasterizeColumn(
+	SoftwareFramebuffer& target,
+	const RaycastDrawable* begin,
+	const RaycastDrawable* end) const
+{
+	const Color4 ambientLightColor = Load(m_Shading.m_AmbientLightColor);
+
+	for (const RaycastDrawable* drawable = begin; drawable != end; ++drawable)
+	{
+		const int x = (int)drawable->m_X;
+
+		if (x < 0 || x >= target.GetWidth()) continue;
+
+		const SoftwareTexture* texture = nullptr;
+
+		if (drawable->m_Texture)
+		{
+			const auto it = m_Textures.find(drawable->m_Texture);
+
+			if (it != m_Textures.end())
+			{
+				texture = &it->second;
+			}
+		}
+
+		const Color4 color = Clamp(ambientLightColor * Load(drawable->m_BlendColor));
+
+		if (drawable->m_DrawTop)
+		{
+			DrawLine(
+				target, m_Shading, x,
+				LineVertex{ drawable->m_FarY, drawable->m_DistanceFar, 0.0f, 0.0f },
+				LineVertex{ drawable->m_Top, drawable->m_DistanceNear, 0.0f, 0.0f },
+				sf::Vector3f(0.0f, 0.0f, 1.0f),
+				color,
+				texture);
+		}
+
+		if (drawable->m_DrawBottom)
+		{
+			DrawLine(
+				target, m_Shading, x,
+				LineVertex{ drawable->m_Bottom, drawable->m_DistanceNear, 0.0f, 0.0f },
+				LineVertex{ drawable->m_FarY, drawable->m_DistanceFar, 0.0f, 0.0f },
+				sf::Vector3f(0.0f, 0.0f, -1.0f),
+				color,
+				texture);
+		}
+
+		if (drawable->m_DrawFront)
+		{
+			DrawLine(
+				target, m_Shading, x,
+				LineVertex{ drawable->m_Top, drawable->m_DistanceNear, drawable->m_U, drawable->m_VTop },
+				LineVertex{ drawable->m_Bottom, drawable->m_DistanceNear, drawable->m_U, drawable->m_VBottom },
+				drawable->m_Normal,
+				color,
+				texture);
+		}
+	}
+}
+
+}
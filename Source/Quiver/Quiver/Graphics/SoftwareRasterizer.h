@@ -0,0 +1,88 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Config.hpp>
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector3.hpp>
+
+#include "Quiver/Graphics/RaycastDrawable.h"
+
+namespace sf {
+class Texture;
+}
+
+namespace qvr {
+
+// An RGBA image in the same layout as sf::Image, except that its colours are premultiplied
+// by alpha. Draw it over something else with sf::BlendMode(One, OneMinusSrcAlpha).
+class SoftwareFramebuffer
+{
+public:
+	void Resize(const int width, const int height);
+
+	// Makes every pixel transparent.
+	void Clear();
+
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+
+	const sf::Uint8* GetPixels() const { return m_Pixels.data(); }
+	sf::Uint8* GetPixels() { return m_Pixels.data(); }
+
+	sf::Color GetPixel(const int x, const int y) const;
+
+private:
+	int m_Width = 0;
+	int m_Height = 0;
+
+	std::vector<sf::Uint8> m_Pixels;
+};
+
+// A texture's pixels, in the same layout as sf::Image.
+struct SoftwareTexture
+{
+	const sf::Uint8* m_Pixels = nullptr;
+	int m_Width = 0;
+	int m_Height = 0;
+};
+
+// The uniforms of the WorldRaycastRenderer's shader.
+struct RaycastShading
+{
+	sf::Color m_AmbientLightColor = sf::Color(255, 255, 255, 255);
+	sf::Vector3f m_DirectionalLightDirection = sf::Vector3f(0.0f, 0.0f, -1.0f);
+	sf::Color m_DirectionalLightColor = sf::Color(0, 0, 0, 0);
+	sf::Color m_FogColor = sf::Color(0, 0, 0, 0);
+	float m_FogMaxIntensity = 0.0f;
+	float m_FogMinDistance = 0.0f;
+	float m_FogMaxDistance = 1.0f;
+};
+
+// Draws RaycastDrawables into a SoftwareFramebuffer without OpenGL, doing the same lighting,
+// fog and texture sampling as the WorldRaycastRenderer's shader.
+class SoftwareRasterizer
+{
+public:
+	void SetShading(const RaycastShading& shading) { m_Shading = shading; }
+
+	// Drawables with textures that haven't been set here are drawn as if they were flat white.
+	void SetTexture(const sf::Texture* texture, const SoftwareTexture& pixels);
+	void RemoveTexture(const sf::Texture* texture);
+	void ClearTextures();
+
+	// Draws one column's drawables, in back-to-front order. Drawing different columns from
+	// different threads at the same time is safe.
+	void RasterizeColumn(
+		SoftwareFramebuffer& target,
+		const RaycastDrawable* begin,
+		const RaycastDrawable* end) const;
+
+private:
+	RaycastShading m_Shading;
+
+	std::unordered_map<const sf::Texture*, SoftwareTexture> m_Textures;
+};
+
+}
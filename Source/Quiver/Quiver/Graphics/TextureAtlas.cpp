@@ -0,0 +1,218 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+// ImGui compiles its copy of the implementation as static too, so the two don't clash.
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <ImGui/imstb_rectpack.h>
+
+namespace qvr {
+
+namespace {
+
+// Texels around each texture that repeat its edges, so that sampling right on the edge of
+// a texture doesn't pick up its neighbour on the page.
+const unsigned Padding = 1;
+
+// Sized to leave the blank patch a texel in the middle that isn't on its edge.
+const unsigned BlankSize = 2;
+
+void CopyWithBorder(const sf::Image& source, sf::Image& page, const unsigned x, const unsigned y)
+{
+	page.copy(source, x, y);
+
+	const int width = (int)source.getSize().x;
+	const int height = (int)source.getSize().y;
+
+	for (int sy = -(int)Padding; sy < height + (int)Padding; sy++)
+	{
+		for (int sx = -(int)Padding; sx < width + (int)Padding; sx++)
+		{
+			if (sx >= 0 && sx < width && sy >= 0 && sy < height) continue;
+
+			page.setPixel(
+				unsigned((int)x + sx),
+				unsigned((int)y + sy),
+				source.getPixel(
+					(unsigned)std::max(0, std::min(sx, width - 1)),
+					(unsigned)std::max(0, std::min(sy, height - 1))));
+		}
+	}
+}
+
+}
+
+std::vector<TextureAtlas::Placement> TextureAtlas::Pack(
+	const std::vector<sf::Vector2u>& sizes,
+	const unsigned pageSize,
+	int& pageCount)
+{
+	std::vector<Placement> placements(sizes.size());
+
+	pageCount = 0;
+
+	if (sizes.empty() || pageSize == 0) return placements;
+
+	std::vector<stbrp_node> nodes(pageSize);
+
+	std::vector<stbrp_rect> rects;
+
+	for (int index = 0; index < (int)sizes.size(); index++)
+	{
+		if (sizes[index].x > pageSize || sizes[index].y > pageSize) continue;
+
+		stbrp_rect rect{};
+		rect.id = index;
+		rect.w = (stbrp_coord)sizes[index].x;
+		rect.h = (stbrp_coord)sizes[index].y;
+		rects.push_back(rect);
+	}
+
+	// Fill one page at a time with whatever's left over from the last.
+	while (!rects.empty())
+	{
+		stbrp_context context;
+		stbrp_init_target(&context, (int)pageSize, (int)pageSize, nodes.data(), (int)nodes.size());
+		stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+
+		const auto firstLeftOver = std::partition(
+			rects.begin(),
+			rects.end(),
+			[](const stbrp_rect& rect) { return rect.was_packed != 0; });
+
+		// Everything left is no bigger than a page, so an empty page always takes some.
+		if (firstLeftOver == rects.begin()) break;
+
+		for (auto it = rects.begin(); it != firstLeftOver; ++it)
+		{
+			placements[it->id] = Placement{ pageCount, (unsigned)it->x, (unsigned)it->y };
+		}
+
+		rects.erase(rects.begin(), firstLeftOver);
+
+		for (stbrp_rect& rect : rects)
+		{
+			rect.was_packed = 0;
+		}
+
+		pageCount++;
+	}
+
+	return placements;
+}
+
+void TextureAtlas::Build(const std::vector<std::shared_ptr<sf::Texture>>& textures, const unsigned pageSize)
+{
+	Clear();
+
+	std::vector<sf::Vector2u> sizes;
+	sizes.reserve(textures.size() + 1);
+
+	for (const auto& texture : textures)
+	{
+		sizes.push_back(texture->getSize() + sf::Vector2u(Padding * 2, Padding * 2));
+	}
+
+	// The blank patch goes last.
+	sizes.push_back(sf::Vector2u(BlankSize + Padding * 2, BlankSize + Padding * 2));
+
+	int pageCount = 0;
+	const std::vector<Placement> placements = Pack(sizes, pageSize, pageCount);
+
+	if (pageCount == 0) return;
+
+	// Trim each page down to what's actually on it.
+	std::vector<sf::Vector2u> pageSizes(pageCount);
+
+	for (int index = 0; index < (int)placements.size(); index++)
+	{
+		const Placement& placement = placements[index];
+
+		if (placement.m_Page < 0) continue;
+
+		sf::Vector2u& pageSize = pageSizes[placement.m_Page];
+		pageSize.x = std::max(pageSize.x, placement.m_X + sizes[index].x);
+		pageSize.y = std::max(pageSize.y, placement.m_Y + sizes[index].y);
+	}
+
+	std::vector<sf::Image> images(pageCount);
+
+	for (int page = 0; page < pageCount; page++)
+	{
+		images[page].create(pageSizes[page].x, pageSizes[page].y, sf::Color::Transparent);
+	}
+
+	struct Packed {
+		const sf::Texture* m_Texture;
+		int m_Page;
+		sf::Vector2f m_Origin;
+	};
+
+	std::vector<Packed> packed;
+
+	for (int index = 0; index < (int)placements.size(); index++)
+	{
+		const Placement& placement = placements[index];
+
+		if (placement.m_Page < 0) continue;
+
+		const bool isBlank = index == (int)textures.size();
+
+		sf::Image source;
+
+		if (isBlank)
+		{
+			source.create(BlankSize, BlankSize, sf::Color::White);
+		}
+		else
+		{
+			source = textures[index]->copyToImage();
+			mTextures.push_back(textures[index]);
+		}
+
+		const unsigned x = placement.m_X + Padding;
+		const unsigned y = placement.m_Y + Padding;
+
+		CopyWithBorder(source, images[placement.m_Page], x, y);
+
+		packed.push_back(Packed{
+			isBlank ? nullptr : textures[index].get(),
+			placement.m_Page,
+			isBlank ?
+				sf::Vector2f(x + BlankSize / 2.0f, y + BlankSize / 2.0f) :
+				sf::Vector2f((float)x, (float)y) });
+	}
+
+	for (const sf::Image& image : images)
+	{
+		mPages.push_back(std::make_unique<sf::Texture>());
+		mPages.back()->loadFromImage(image);
+	}
+
+	for (const Packed& p : packed)
+	{
+		Location& location = mLocations[p.m_Texture];
+		location.m_Page = mPages[p.m_Page].get();
+		location.m_Origin = p.m_Origin;
+	}
+}
+
+void TextureAtlas::Clear()
+{
+	mLocations.clear();
+	mTextures.clear();
+	mPages.clear();
+}
+
+const TextureAtlas::Location* TextureAtlas::Find(const sf::Texture* texture) const
+{
+	const auto it = mLocations.find(texture);
+
+	return it != mLocations.end() ? &it->second : nullptr;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+namespace sf {
+class Texture;
+}
+
+namespace qvr {
+
+// Copies of textures packed together onto a few big pages, so that things with different
+// textures can be drawn without binding a different texture in between.
+// The pages are only copies, so nothing drawn with the original textures is affected, but
+// anything that changes a texture after the atlas is built won't show up on its page.
+class TextureAtlas {
+public:
+	struct Location {
+		const sf::Texture* m_Page = nullptr;
+		// Where the texture's top-left texel ended up on the page.
+		sf::Vector2f m_Origin;
+	};
+
+	struct Placement {
+		// -1 if it didn't fit on a page at all.
+		int m_Page = -1;
+		unsigned m_X = 0;
+		unsigned m_Y = 0;
+	};
+
+	// Puts rectangles of the given sizes on as few pageSize by pageSize pages as it can,
+	// without any overlapping. pageCount is set to the number of pages used.
+	static std::vector<Placement> Pack(
+		const std::vector<sf::Vector2u>& sizes,
+		const unsigned pageSize,
+		int& pageCount);
+
+	// Textures that are bigger than a page are left out. Needs an OpenGL context.
+	void Build(const std::vector<std::shared_ptr<sf::Texture>>& textures, const unsigned pageSize);
+
+	void Clear();
+
+	bool IsEmpty() const { return mPages.empty(); }
+
+	int GetPageCount() const { return (int)mPages.size(); }
+
+	int GetTextureCount() const { return (int)mTextures.size(); }
+
+	// Returns null if texture isn't in the atlas. There's a patch of flat white for things
+	// with no texture, which is found by passing null.
+	const Location* Find(const sf::Texture* texture) const;
+
+private:
+	std::vector<std::unique_ptr<sf::Texture>> mPages;
+
+	// Kept alive so that a texture loaded later can't be given one of their addresses.
+	std::vector<std::shared_ptr<sf::Texture>> mTextures;
+
+	std::unordered_map<const sf::Texture*, Location> mLocations;
+};
+
+}
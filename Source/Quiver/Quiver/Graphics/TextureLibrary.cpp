@@ -1,9 +1,11 @@
 #include "TextureLibrary.h"
 
 #include <algorithm>
+#include <vector>
 
 #include <ImGui/imgui.h>
 #include <ImGui/imgui-SFML.h>
+#include <SFML/Graphics/Image.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <spdlog/spdlog.h>
 
@@ -11,6 +13,24 @@
 
 namespace qvr {
 
+namespace {
+
+std::string ToLower(std::string s)
+{
+	std::transform(
+		s.begin(),
+		s.end(),
+		s.begin(),
+		[](const char c) -> char
+	{
+		return static_cast<char>(std::tolower(static_cast<int>(c)));
+	});
+
+	return s;
+}
+
+}
+
 std::shared_ptr<sf::Texture> TextureLibrary::LoadTexture(std::string filename)
 {
 	const char* logCtx = "TextureLibrary::LoadTexture";
@@ -18,14 +38,7 @@ std::shared_ptr<sf::Texture> TextureLibrary::LoadTexture(std::string filename)
 	assert(log);
 
 	// Need to cast filename to all-lower case.
-	std::transform(
-		filename.begin(),
-		filename.end(),
-		filename.begin(),
-		[](const char c) -> char
-	{
-		return static_cast<char>(std::tolower(static_cast<int>(c)));
-	});
+	filename = ToLower(filename);
 
 	// Check if there's already a copy of it in memory.
 	if (mLoadedTextures.find(filename) != mLoadedTextures.end())
@@ -51,9 +64,14 @@ std::shared_ptr<sf::Texture> TextureLibrary::LoadTexture(std::string filename)
 	}
 
 	// Need to try loading.
-	auto texture = std::make_shared<sf::Texture>();
+	const auto image = LoadImage(filename);
+
+	// The texture keeps its image alive.
+	std::shared_ptr<sf::Texture> texture(
+		new sf::Texture(),
+		[image](sf::Texture* texture) { delete texture; });
 
-	if (texture->loadFromFile(filename)) {
+	if (image && texture->loadFromImage(*image)) {
 		log->debug(
 			"{}: {} was loaded successfully.",
 			logCtx,
@@ -68,9 +86,110 @@ std::shared_ptr<sf::Texture> TextureLibrary::LoadTexture(std::string filename)
 	return nullptr;
 }
 
+std::shared_ptr<const sf::Image> TextureLibrary::LoadImage(std::string filename)
+{
+	filename = ToLower(filename);
+
+	const auto it = mLoadedImages.find(filename);
+
+	if (it != mLoadedImages.end()) {
+		if (auto image = it->second.lock()) {
+			return image;
+		}
+	}
+
+	auto image = std::make_shared<sf::Image>();
+
+	if (!image->loadFromFile(filename)) return nullptr;
+
+	mLoadedImages[filename] = image;
+
+	return image;
+}
+
+std::shared_ptr<const TextureLods> TextureLibrary::LoadTextureLods(std::string filename)
+{
+	filename = ToLower(filename);
+
+	const auto it = mLoadedTextureLods.find(filename);
+
+	if (it != mLoadedTextureLods.end()) {
+		if (auto lods = it->second.lock()) {
+			return lods;
+		}
+	}
+
+	const auto texture = LoadTexture(filename);
+
+	if (!texture) return nullptr;
+
+	auto lods = std::make_shared<const TextureLods>(*texture, LoadImage(filename));
+
+	mLoadedTextureLods[filename] = lods;
+
+	return lods;
+}
+
+void TextureLibrary::BuildAtlas(const unsigned pageSize)
+{
+	auto log = spdlog::get("console");
+	assert(log);
+
+	std::vector<std::shared_ptr<sf::Texture>> textures;
+
+	for (const auto& kvp : mLoadedTextures) {
+		if (auto texture = kvp.second.lock()) {
+			textures.push_back(std::move(texture));
+		}
+	}
+
+	for (const auto& kvp : mLoadedTextureLods) {
+		if (const auto lods = kvp.second.lock()) {
+			textures.insert(textures.end(), lods->GetLevels().begin(), lods->GetLevels().end());
+		}
+	}
+
+	if (textures.empty()) {
+		mAtlas.Clear();
+		return;
+	}
+
+	mAtlas.Build(textures, std::min(pageSize, sf::Texture::getMaximumSize()));
+
+	log->debug(
+		"TextureLibrary::BuildAtlas: Packed {} of {} textures onto {} pages.",
+		mAtlas.GetTextureCount(),
+		textures.size(),
+		mAtlas.GetPageCount());
+}
+
 void TextureLibraryGui::ProcessGui() {
 	using namespace std;
 
+	{
+		const TextureAtlas& atlas = mTextureLibrary.GetAtlas();
+
+		if (atlas.IsEmpty()) {
+			ImGui::Text("Atlas: None");
+		}
+		else {
+			ImGui::Text(
+				"Atlas: %d textures on %d pages", 
+				atlas.GetTextureCount(), 
+				atlas.GetPageCount());
+		}
+
+		if (ImGui::Button("Build Atlas")) {
+			mTextureLibrary.BuildAtlas();
+		}
+
+		ImGui::SameLine();
+
+		if (ImGui::Button("Clear Atlas")) {
+			mTextureLibrary.ClearAtlas();
+		}
+	}
+
 	if (mTextureLibrary.mLoadedTextures.empty()) {
 		ImGui::Text("No Textures");
 		
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 
+#include "Quiver/Graphics/TextureAtlas.h"
+#include "Quiver/Graphics/TextureLods.h"
+
 namespace sf {
+	class Image;
 	class Texture;
 }
 
@@ -13,8 +18,30 @@ class TextureLibrary
 {
 public:
 	std::shared_ptr<sf::Texture> LoadTexture(std::string filename);
+
+	// The pixels textures are made from. Loading a texture loads its image too, and the
+	// image is kept for as long as the texture is, so that it can be drawn without reading
+	// it back from OpenGL.
+	std::shared_ptr<const sf::Image> LoadImage(std::string filename);
+
+	// The smaller copies of the texture loaded from filename, and the pixels of it and them.
+	// Loads the texture too, if it isn't already. Needs an OpenGL context.
+	std::shared_ptr<const TextureLods> LoadTextureLods(std::string filename);
+
+	// Packs every texture that's loaded at the moment, and its smaller copies, into the atlas. Textures loaded after 
+	// that aren't in it until it's built again. Needs an OpenGL context.
+	void BuildAtlas(const unsigned pageSize = 2048);
+
+	void ClearAtlas() { mAtlas.Clear(); }
+
+	const TextureAtlas& GetAtlas() const { return mAtlas; }
+
 private:
+	std::unordered_map<std::string, std::weak_ptr<const sf::Image>> mLoadedImages;
 	std::unordered_map<std::string, std::weak_ptr<sf::Texture>> mLoadedTextures;
+	std::unordered_map<std::string, std::weak_ptr<const TextureLods>> mLoadedTextureLods;
+
+	TextureAtlas mAtlas;
 
 	friend class TextureLibraryGui;
 };
@@ -0,0 +1,85 @@
+#include "TextureLods.h"
+
+#include <algorithm>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+namespace qvr {
+
+TextureLods::TextureLods(const sf::Texture& texture, std::shared_ptr<const sf::Image> image)
+	: mImage(std::move(image))
+{
+	const sf::Vector2u size = mImage->getSize();
+
+	const sf::Image* previous = mImage.get();
+
+	while (previous->getSize().x > 1 || previous->getSize().y > 1)
+	{
+		mLevelImages.push_back(Downsample(*previous));
+
+		const sf::Image& level = mLevelImages.back();
+
+		previous = &level;
+
+		mLevels.push_back(std::make_shared<sf::Texture>());
+		mLevels.back()->loadFromImage(level);
+		mLevels.back()->setSmooth(texture.isSmooth());
+
+		mScales.push_back(sf::Vector2f(
+			(float)level.getSize().x / size.x,
+			(float)level.getSize().y / size.y));
+	}
+}
+
+sf::Image TextureLods::Downsample(const sf::Image& image)
+{
+	const unsigned width = image.getSize().x;
+	const unsigned height = image.getSize().y;
+
+	const unsigned halfWidth = std::max(1u, width / 2);
+	const unsigned halfHeight = std::max(1u, height / 2);
+
+	sf::Image result;
+	result.create(halfWidth, halfHeight);
+
+	for (unsigned y = 0; y < halfHeight; y++)
+	{
+		for (unsigned x = 0; x < halfWidth; x++)
+		{
+			unsigned r = 0, g = 0, b = 0, a = 0;
+
+			for (unsigned sy = y * 2; sy < std::min(height, y * 2 + 2); sy++)
+			{
+				for (unsigned sx = x * 2; sx < std::min(width, x * 2 + 2); sx++)
+				{
+					const sf::Color c = image.getPixel(sx, sy);
+					r += c.r * c.a;
+					g += c.g * c.a;
+					b += c.b * c.a;
+					a += c.a;
+				}
+			}
+
+			const unsigned sampleCount =
+				(std::min(height, y * 2 + 2) - y * 2) *
+				(std::min(width, x * 2 + 2) - x * 2);
+
+			if (a == 0)
+			{
+				result.setPixel(x, y, sf::Color::Transparent);
+				continue;
+			}
+
+			result.setPixel(x, y, sf::Color(
+				(sf::Uint8)(r / a),
+				(sf::Uint8)(g / a),
+				(sf::Uint8)(b / a),
+				(sf::Uint8)(a / sampleCount)));
+		}
+	}
+
+	return result;
+}
+
+}
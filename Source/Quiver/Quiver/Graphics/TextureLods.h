@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Vector2.hpp>
+
+namespace sf {
+class Texture;
+}
+
+namespace qvr {
+
+// Copies of a texture at half the size, a quarter and so on, down to a texel across, each
+// box-filtered from the one before. Drawing something far away from a smaller copy reads
+// less memory and doesn't shimmer as it moves.
+// The pixels are kept too, for drawing without OpenGL.
+class TextureLods {
+public:
+	// image is what texture was loaded from. Needs an OpenGL context.
+	TextureLods(const sf::Texture& texture, std::shared_ptr<const sf::Image> image);
+
+	// Not counting the texture itself.
+	int GetLevelCount() const { return (int)mLevels.size(); }
+
+	// Level 1 is the half-size copy.
+	const sf::Texture& GetLevel(const int lod) const { return *mLevels[lod - 1]; }
+
+	// The pixels of the texture (level 0) or one of its smaller copies.
+	const sf::Image& GetImage(const int lod) const { 
+		return lod > 0 ? mLevelImages[lod - 1] : *mImage; 
+	}
+
+	// How much smaller the level is than the texture in each direction, which is what texel
+	// coordinates have to be multiplied by to sample the same place on it.
+	sf::Vector2f GetScale(const int lod) const { return mScales[lod - 1]; }
+
+	const std::vector<std::shared_ptr<sf::Texture>>& GetLevels() const { return mLevels; }
+
+	// Halves image in each direction (rounding down, but never below 1), averaging each 2x2
+	// block of pixels. Colours are weighted by alpha, so see-through pixels don't darken
+	// the edges of what's next to them.
+	static sf::Image Downsample(const sf::Image& image);
+
+private:
+	std::vector<std::shared_ptr<sf::Texture>> mLevels;
+	std::vector<sf::Vector2f> mScales;
+
+	std::shared_ptr<const sf::Image> mImage;
+	std::vector<sf::Image> mLevelImages;
+};
+
+}
@@ -12,6 +12,9 @@ struct ViewBuffer {
 	int viewCount = 0;
 	std::array<Animation::Rect, 8> views;
 
+	// Incremented every time the views are set, so anything that caches them can tell.
+	unsigned revision = 0;
+
 	// TODO: Consider making initial value of viewCount == 1.
 	// TODO: Consider making viewCount < 1 illegal.
 };
@@ -25,6 +28,7 @@ inline void SetView(
 {
 	vb.viewCount = 1;
 	vb.views[0] = singleView;
+	vb.revision++;
 }
 
 inline void SetViews(
@@ -40,6 +44,8 @@ inline void SetViews(
 		std::begin(newViews),
 		std::begin(newViews) + target.viewCount,
 		std::begin(target.views));
+
+	target.revision++;
 }
 
 inline auto GetViews(const ViewBuffer& vb) -> gsl::span<const Animation::Rect> {
@@ -1,24 +1,53 @@
 #include "WorldRaycastRenderer.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QVR_RAYCAST_RENDERER_SSE
+#include <emmintrin.h>
+#endif
+
 #include <SFML/OpenGL.hpp>
 #include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Image.hpp>
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/Shader.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Vector2.hpp>
 
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
-#include <Box2D/Dynamics/b2WorldCallbacks.h>
 
 #include <spdlog/spdlog.h>
 
+#include "Quiver/Graphics/BillboardStore.h"
 #include "Quiver/Graphics/Camera3D.h"
+#include "Quiver/Graphics/ColumnDepthBuffer.h"
 #include "Quiver/Graphics/FixtureRenderData.h"
+#include "Quiver/Graphics/PotentiallyVisibleSets.h"
+#include "Quiver/Graphics/RaycastDrawable.h"
+#include "Quiver/Graphics/RaycastSceneSnapshot.h"
 #include "Quiver/Graphics/RenderSettings.h"
+#include "Quiver/Graphics/SoftwareRasterizer.h"
+#include "Quiver/Graphics/TextureAtlas.h"
+#include "Quiver/Graphics/TextureLibrary.h"
+#include "Quiver/Misc/WorkerPool.h"
+#include "Quiver/Physics/RayCastEntryExit.h"
+#include "Quiver/Physics/StaticGeometryGrid.h"
 #include "Quiver/World/World.h"
 
 namespace {
@@ -134,650 +163,2674 @@ inline sf::Vector3f B2VecToSFVec(const b2Vec3& b2vec) {
 
 namespace qvr {
 
-class WorldRaycastRendererImpl {
+// Where a fixture's front face starts and ends on screen, at some distance from the camera.
+struct VerticalExtent
+{
+	float m_Top;
+	float m_Bottom;
+};
+
+// What the renderer needs to know about each FixtureRenderData, by render ID, worked out 
+// once per view instead of for every drawable. Stored as a structure of arrays.
+struct RenderAttributeTable
+{
+	// At a distance d ahead of the camera, a fixture's front face starts on screen at 
+	// m_Base + (m_TopCoefficients[id] / d) and ends at m_Base + (m_BottomCoefficients[id] / d).
+	float m_Base = 0.0f;
+	std::vector<float> m_TopCoefficients;
+	std::vector<float> m_BottomCoefficients;
+
+	// The smallest top and largest bottom coefficients, counting the horizon as well.
+	float m_MinTopCoefficient = 0.0f;
+	float m_MaxBottomCoefficient = 0.0f;
 
-	struct RayIntersection
+	// The view of the fixture's texture that faces the camera.
+	std::vector<Animation::Rect> m_TextureRects;
+
+	std::vector<const FixtureRenderData*> m_RenderData;
+
+	// renderData can have nulls in it.
+	void Build(
+		const Camera3D& camera, 
+		const float targetHeight, 
+		const std::vector<const FixtureRenderData*>& renderData);
+
+	VerticalExtent GetVerticalExtent(const unsigned renderId, const float distance) const
 	{
-		b2Fixture* m_fixture;
-		b2Vec2 m_point;
-		b2Vec2 m_normal;
-		std::array<b2Vec2, 5> m_backPoints;
-		int m_numBackPoints = 0;
-		float32 m_fraction;
-		int m_screenX;
-		enum class Facing
-		{
-			Towards,
-			Away
-		};
-		Facing m_facing;
-	};
+		const float inverseDistance = 1.0f / std::abs(distance);
 
-	struct IntersectionCollection
+		return VerticalExtent{
+			m_Base + m_TopCoefficients[renderId] * inverseDistance,
+			m_Base + m_BottomCoefficients[renderId] * inverseDistance };
+	}
+
+	// Everything at least distance ahead of the camera is drawn inside this. Front faces 
+	// only get closer to the horizon the further away they are.
+	VerticalExtent GetExtentBeyond(const float distance) const
 	{
-		static const unsigned sm_MaxNumIntersections = 32;
+		const float inverseDistance = 1.0f / std::abs(distance);
 
-		std::array<RayIntersection, sm_MaxNumIntersections> m_Intersections;
+		return VerticalExtent{
+			m_Base + m_MinTopCoefficient * inverseDistance,
+			m_Base + m_MaxBottomCoefficient * inverseDistance };
+	}
+};
 
-		int m_IntersectionCount = 0;
-		int m_Index = 0;
-	};
+void RenderAttributeTable::Build(
+	const Camera3D& camera, 
+	const float targetHeight, 
+	const std::vector<const FixtureRenderData*>& renderData)
+{
+	unsigned size = 0;
 
-	class ForwardRaycastCallback : public b2RayCastCallback
+	for (const FixtureRenderData* data : renderData)
 	{
-	public:
-		IntersectionCollection* m_Collection;
+		if (data) size = std::max(size, data->GetRenderId() + 1);
+	}
 
-		float32 ReportFixture(
-			b2Fixture* fixture,
-			const b2Vec2& point,
-			const b2Vec2& normal,
-			float32 fraction)
-			override;
-	};
+	m_TopCoefficients.resize(size);
+	m_BottomCoefficients.resize(size);
+	m_TextureRects.resize(size);
+	m_RenderData.assign(size, nullptr);
+
+	m_Base = (targetHeight / 2.0f) + (float)GetPitchOffsetInPixels(camera, (int)targetHeight);
+
+	const float cameraHeightOffset = camera.GetHeightOffset();
+
+	m_MinTopCoefficient = 0.0f;
+	m_MaxBottomCoefficient = 0.0f;
 
-	class BackwardRaycastCallback : public b2RayCastCallback
+	for (const FixtureRenderData* data : renderData)
 	{
-	public:
-		IntersectionCollection* m_Collection;
+		if (!data) continue;
 
-		float32 ReportFixture(
-			b2Fixture* fixture,
-			const b2Vec2& point,
-			const b2Vec2& normal,
-			float32 fraction)
-			override;
-	};
+		const unsigned renderId = data->GetRenderId();
 
-	std::vector<IntersectionCollection> m_IntersectionsPerColumn;
+		m_RenderData[renderId] = data;
 
-	std::vector<ForwardRaycastCallback> m_ForwardRaycastCallbacks;
-	std::vector<BackwardRaycastCallback> m_BackwardRaycastCallbacks;
+		// At a distance of 1 metre, a vertical metre is enough pixels in height to fill 
+		// the screen.
+		const float groundOffset = data->GetGroundOffset() * 2.0f;
+		const float height = data->GetHeight();
+		const float heightOffset = height - 1.0f;
 
-	std::vector<RayIntersection> m_AllIntersections;
+		const float lineOffset = -groundOffset - heightOffset - cameraHeightOffset;
 
-	struct Drawable {
-		float m_Top;
-		float m_Bottom;
-		float m_X;
-		float m_DistanceFar;
-		float m_DistanceNear;
-		float m_U;
-		float m_VTop;
-		float m_VBottom;
-		float m_FarY;
-		sf::Color m_BlendColor;
-		sf::Vector3f m_Normal;
-		const sf::Texture* m_Texture;
-		/*enum class Type
-		{
-			Front,
-			Top,
-			Bottom
-		};*/
-		bool m_DrawFront;
-		bool m_DrawTop;
-		bool m_DrawBottom;
-	};
+		m_TopCoefficients[renderId] = targetHeight * (lineOffset - height) / 2.0f;
+		m_BottomCoefficients[renderId] = targetHeight * (lineOffset + height) / 2.0f;
 
-	std::vector<Drawable> m_Drawables;
+		m_MinTopCoefficient = std::min(m_MinTopCoefficient, m_TopCoefficients[renderId]);
+		m_MaxBottomCoefficient = std::max(m_MaxBottomCoefficient, m_BottomCoefficients[renderId]);
 
-	sf::Shader mShader;
+		const ViewBuffer& views = data->GetViews();
 
-	void LoadShader();
+		if (views.viewCount <= 1)
+		{
+			m_TextureRects[renderId] = views.views[0];
+			continue;
+		}
 
-public:
-	WorldRaycastRendererImpl()
-	{
-		LoadShader();
+		const b2Vec2 disp = data->GetSpritePosition() - camera.GetPosition();
+
+		m_TextureRects[renderId] = CalculateView(
+			views,
+			data->GetObjectAngle(),
+			b2Atan2(disp.y, disp.x) + b2_pi);
 	}
+}
 
-	void Render(
-		const World& world, 
-		const Camera3D& camera, 
-		const RenderSettings& settings, 
-		sf::RenderTarget& target);
+// One drawable's worth of an intersection, between two points along a column's ray, waiting
+// to be turned into a drawable. Every column's are kept together as a structure of arrays,
+// so that where they go on screen can be worked out four at a time.
+struct PreparedSpans
+{
+	std::vector<float> m_NearX;
+	std::vector<float> m_NearY;
+	std::vector<float> m_FarX;
+	std::vector<float> m_FarY;
+	std::vector<float> m_TopCoefficients;
+	std::vector<float> m_BottomCoefficients;
+	std::vector<int> m_Intersections;
+	std::vector<bool> m_FrontFaces;
+	std::vector<bool> m_FarField;
+
+	// Filled in by CalculateExtents.
+	std::vector<float> m_DistancesNear;
+	std::vector<float> m_DistancesFar;
+	std::vector<float> m_TopsNear;
+	std::vector<float> m_BottomsNear;
+	std::vector<float> m_TopsFar;
+	std::vector<float> m_BottomsFar;
+
+	int GetCount() const { return (int)m_Intersections.size(); }
+
+	void Clear();
+
+	void Add(
+		const b2Vec2& nearPoint,
+		const b2Vec2& farPoint,
+		const int intersection,
+		const unsigned renderId,
+		const RenderAttributeTable& attributes,
+		const bool frontFace,
+		const bool farField);
+
+	// Works out how far ahead of the camera each span's ends are, and where they start and
+	// end on screen.
+	void CalculateExtents(const b2Vec2& cameraPosition, const b2Vec2& cameraForwards, const float base);
 };
 
-void WorldRaycastRendererImpl::Render(
-	const World & world, 
-	const Camera3D & camera, 
-	const RenderSettings& settings, 
-	sf::RenderTarget & target)
+void PreparedSpans::Clear()
+{
+	m_NearX.clear();
+	m_NearY.clear();
+	m_FarX.clear();
+	m_FarY.clear();
+	m_TopCoefficients.clear();
+	m_BottomCoefficients.clear();
+	m_Intersections.clear();
+	m_FrontFaces.clear();
+	m_FarField.clear();
+}
+
+void PreparedSpans::Add(
+	const b2Vec2& nearPoint,
+	const b2Vec2& farPoint,
+	const int intersection,
+	const unsigned renderId,
+	const RenderAttributeTable& attributes,
+	const bool frontFace,
+	const bool farField)
 {
-	assert(world.GetPhysicsWorld());
+	m_NearX.push_back(nearPoint.x);
+	m_NearY.push_back(nearPoint.y);
+	m_FarX.push_back(farPoint.x);
+	m_FarY.push_back(farPoint.y);
+	m_TopCoefficients.push_back(attributes.m_TopCoefficients[renderId]);
+	m_BottomCoefficients.push_back(attributes.m_BottomCoefficients[renderId]);
+	m_Intersections.push_back(intersection);
+	m_FrontFaces.push_back(frontFace);
+	m_FarField.push_back(farField);
+}
 
-	const auto targetWidth = target.getSize().x;
+void PreparedSpans::CalculateExtents(
+	const b2Vec2& cameraPosition, 
+	const b2Vec2& cameraForwards, 
+	const float base)
+{
+	const int count = GetCount();
+
+	m_DistancesNear.resize(count);
+	m_DistancesFar.resize(count);
+	m_TopsNear.resize(count);
+	m_BottomsNear.resize(count);
+	m_TopsFar.resize(count);
+	m_BottomsFar.resize(count);
+
+	int span = 0;
+
+#ifdef QVR_RAYCAST_RENDERER_SSE
+	const __m128 cameraX = _mm_set1_ps(cameraPosition.x);
+	const __m128 cameraY = _mm_set1_ps(cameraPosition.y);
+	const __m128 forwardsX = _mm_set1_ps(cameraForwards.x);
+	const __m128 forwardsY = _mm_set1_ps(cameraForwards.y);
+	const __m128 base4 = _mm_set1_ps(base);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	auto Distance = [&](const float* x, const float* y)
+	{
+		return _mm_add_ps(
+			_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x), cameraX), forwardsX),
+			_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y), cameraY), forwardsY));
+	};
 
-	if (m_ForwardRaycastCallbacks.size() != targetWidth)
+	for (; span + 4 <= count; span += 4)
 	{
-		m_IntersectionsPerColumn.resize(targetWidth);
+		const __m128 distanceNear = Distance(&m_NearX[span], &m_NearY[span]);
+		const __m128 distanceFar = Distance(&m_FarX[span], &m_FarY[span]);
 
-		m_ForwardRaycastCallbacks.resize(targetWidth);
-		m_BackwardRaycastCallbacks.resize(targetWidth);
+		const __m128 inverseNear = _mm_div_ps(one, _mm_andnot_ps(signBit, distanceNear));
+		const __m128 inverseFar = _mm_div_ps(one, _mm_andnot_ps(signBit, distanceFar));
 
-		m_AllIntersections.reserve(targetWidth * IntersectionCollection::sm_MaxNumIntersections);
+		const __m128 top = _mm_loadu_ps(&m_TopCoefficients[span]);
+		const __m128 bottom = _mm_loadu_ps(&m_BottomCoefficients[span]);
 
-		m_Drawables.reserve(m_AllIntersections.size());
+		_mm_storeu_ps(&m_DistancesNear[span], distanceNear);
+		_mm_storeu_ps(&m_DistancesFar[span], distanceFar);
+		_mm_storeu_ps(&m_TopsNear[span], _mm_add_ps(base4, _mm_mul_ps(top, inverseNear)));
+		_mm_storeu_ps(&m_BottomsNear[span], _mm_add_ps(base4, _mm_mul_ps(bottom, inverseNear)));
+		_mm_storeu_ps(&m_TopsFar[span], _mm_add_ps(base4, _mm_mul_ps(top, inverseFar)));
+		_mm_storeu_ps(&m_BottomsFar[span], _mm_add_ps(base4, _mm_mul_ps(bottom, inverseFar)));
 	}
+#endif
 
-	m_AllIntersections.resize(0);
-	m_Drawables.resize(0);
-
-	for (unsigned i = 0; i < targetWidth; ++i)
+	for (; span < count; span++)
 	{
-		m_IntersectionsPerColumn[i].m_Index = i;
-		m_IntersectionsPerColumn[i].m_IntersectionCount = 0;
+		const float distanceNear =
+			(m_NearX[span] - cameraPosition.x) * cameraForwards.x +
+			(m_NearY[span] - cameraPosition.y) * cameraForwards.y;
+		const float distanceFar =
+			(m_FarX[span] - cameraPosition.x) * cameraForwards.x +
+			(m_FarY[span] - cameraPosition.y) * cameraForwards.y;
+
+		const float inverseNear = 1.0f / std::abs(distanceNear);
+		const float inverseFar = 1.0f / std::abs(distanceFar);
+
+		m_DistancesNear[span] = distanceNear;
+		m_DistancesFar[span] = distanceFar;
+		m_TopsNear[span] = base + m_TopCoefficients[span] * inverseNear;
+		m_BottomsNear[span] = base + m_BottomCoefficients[span] * inverseNear;
+		m_TopsFar[span] = base + m_TopCoefficients[span] * inverseFar;
+		m_BottomsFar[span] = base + m_BottomCoefficients[span] * inverseFar;
 	}
+}
 
-	for (unsigned i = 0; i < targetWidth; ++i)
+// A triangle with the camera at one corner that contains every ray the camera casts.
+class ViewTriangle
+{
+public:
+	ViewTriangle(
+		const b2Vec2& cameraPosition,
+		const b2Vec2& cameraForwards,
+		const b2Vec2& viewPlane,
+		const float rayLength)
 	{
-		m_ForwardRaycastCallbacks[i].m_Collection = &m_IntersectionsPerColumn[i];
-		m_BackwardRaycastCallbacks[i].m_Collection = &m_IntersectionsPerColumn[i];
+		const b2Vec2 leftDirection = [&]() {
+			b2Vec2 direction = cameraForwards - viewPlane; direction.Normalize(); return direction; }();
+		const b2Vec2 rightDirection = [&]() {
+			b2Vec2 direction = cameraForwards + viewPlane; direction.Normalize(); return direction; }();
+
+		// The rays all end on an arc. Push the far corners out so that the far edge touches 
+		// the arc instead of cutting across it.
+		const float farCornerDistance = rayLength / b2Dot(leftDirection, cameraForwards);
+
+		m_Points[0] = cameraPosition;
+		m_Points[1] = cameraPosition + farCornerDistance * leftDirection;
+		m_Points[2] = cameraPosition + farCornerDistance * rightDirection;
 	}
 
-	auto DoRaycastForwards = [&](ForwardRaycastCallback& cb)
+	b2AABB GetAABB() const
 	{
-		const b2World& physicsWorld = *world.GetPhysicsWorld();
+		b2AABB aabb;
+		aabb.lowerBound = b2Min(m_Points[0], b2Min(m_Points[1], m_Points[2]));
+		aabb.upperBound = b2Max(m_Points[0], b2Max(m_Points[1], m_Points[2]));
+		return aabb;
+	}
 
-		const auto cameraPosition = camera.GetPosition();
-		const auto cameraForwards = camera.GetForwards();
-		const float screenXDelta = 2.0f / (float)targetWidth;
+	// Assumes the AABB already overlaps GetAABB, so only the triangle's edges are checked.
+	bool Overlaps(const b2AABB& aabb) const
+	{
+		const b2Vec2 corners[] = {
+			aabb.lowerBound,
+			b2Vec2(aabb.upperBound.x, aabb.lowerBound.y),
+			aabb.upperBound,
+			b2Vec2(aabb.lowerBound.x, aabb.upperBound.y) };
 
-		const float viewPlaneWidthModifier = camera.GetViewPlaneWidthModifier();
-		// The 'view plane' vector is the camera's right-vector, stretched/squashed a bit:
-		const b2Vec2 viewPlane(
-			cameraForwards.y * viewPlaneWidthModifier * (-1),
-			cameraForwards.x * viewPlaneWidthModifier);
+		// Works whichever way round the triangle is wound.
+		const float winding = b2Cross(m_Points[1] - m_Points[0], m_Points[2] - m_Points[0]);
 
-		// Cheeky wee lambda to calculate the end point of the ray.
-		const auto rayEnd = [&]()
+		for (int edge = 0; edge < 3; edge++)
 		{
-			const auto screenX = -1.0f + screenXDelta * cb.m_Collection->m_Index;
-			auto rayDir = (cameraForwards + (screenX * viewPlane));
-			rayDir.Normalize();
-			return cameraPosition + (settings.m_RayLength * rayDir);
-		}();
+			const b2Vec2& a = m_Points[edge];
+			const b2Vec2& b = m_Points[(edge + 1) % 3];
 
-		physicsWorld.RayCast(&cb, cameraPosition, rayEnd);
-	};
+			const bool allOutside = std::all_of(
+				std::begin(corners),
+				std::end(corners),
+				[&](const b2Vec2& corner) { return b2Cross(b - a, corner - a) * winding < 0.0f; });
 
-	std::for_each(
-		m_ForwardRaycastCallbacks.begin(),
-		m_ForwardRaycastCallbacks.end(),
-		DoRaycastForwards);
+			if (allOutside) return false;
+		}
 
-	auto DoRaycastBackwards = [&](BackwardRaycastCallback& cb)
-	{
-		const b2World& physicsWorld = *world.GetPhysicsWorld();
+		return true;
+	}
 
-		const auto cameraPosition = camera.GetPosition();
-		const auto cameraForwards = camera.GetForwards();
-		const float screenXDelta = 2.0f / (float)targetWidth;
+private:
+	b2Vec2 m_Points[3];
+};
 
-		const float viewPlaneWidthModifier = camera.GetViewPlaneWidthModifier();
-		// The 'view plane' vector is the camera's right-vector, stretched/squashed a bit:
-		const b2Vec2 viewPlane(
-			cameraForwards.y * viewPlaneWidthModifier * (-1),
-			cameraForwards.x * viewPlaneWidthModifier);
+class WorldRaycastRendererImpl {
 
-		// Cheeky wee lambda to calculate the end point of the ray.
-		const auto rayEnd = [&]()
-		{
-			const auto screenX = -1.0f + screenXDelta * cb.m_Collection->m_Index;
-			auto rayDir = (cameraForwards + (screenX * viewPlane));
-			rayDir.Normalize();
-			return cameraPosition + (settings.m_RayLength * rayDir);
-		}();
+	using Drawable = RaycastDrawable;
+	using FrontQuad = RaycastFrontQuad;
 
-		physicsWorld.RayCast(&cb, rayEnd, cameraPosition);
+	// Somewhere along a column's ray where it goes into or comes out of a fixture.
+	struct SplitPoint
+	{
+		b2Vec2 m_point;
+		float32 m_fraction;
 	};
 
-	std::for_each(
-		m_BackwardRaycastCallbacks.begin(),
-		m_BackwardRaycastCallbacks.end(),
-		DoRaycastBackwards);
-
-	std::for_each(
-		m_IntersectionsPerColumn.begin(),
-		m_IntersectionsPerColumn.end(),
-		[](IntersectionCollection& collection)
-		{
-			// sort by distance such that further away intersections come first
-			std::sort(
-				collection.m_Intersections.begin(),
-				collection.m_Intersections.begin() + collection.m_IntersectionCount,
-				[](const RayIntersection& a, const RayIntersection& b)
-				{
-					return (a.m_fraction > b.m_fraction);
-				});
+	// The front face of an opaque fixture, which hides everything behind it between its top 
+	// and bottom.
+	struct Occluder
+	{
+		float32 m_Fraction;
+		float m_Distance;
+		float m_Top;
+		float m_Bottom;
+	};
 
-			for (int index = 0; index < collection.m_IntersectionCount - 1; index++)
-			{
-				auto& thisIntersection = collection.m_Intersections[index];
+	// The fixtures and billboards a column's ray passes through, kept only until they've been turned into
+	// drawables. Each worker thread has its own, one for each ray in a packet, and reuses 
+	// them from column to column and frame to frame, so they only ever allocate when a 
+	// column has more intersections than any before it.
+	// Stored as a structure of arrays, so that sorting and searching by fraction only touch
+	// the fractions.
+	struct IntersectionCollection
+	{
+		// Indices into the RenderAttributeTable.
+		std::vector<unsigned> m_RenderIds;
+		std::vector<b2Vec2> m_EntryPoints;
+		std::vector<b2Vec2> m_EntryNormals;
+		std::vector<float32> m_EntryFractions;
+		std::vector<b2Vec2> m_ExitPoints;
+		std::vector<float32> m_ExitFractions;
+
+		// Indices of the intersections, back to front.
+		std::vector<int> m_BackToFront;
+
+		// The part of the column covered by the occluders found so far, merged into one. Its
+		// fraction and distance are those of the furthest of them.
+		Occluder m_Covered;
+		bool m_HasCovered = false;
+
+		// Once the occluders cover everything that could be drawn behind them, nothing 
+		// further along the ray than this can be seen.
+		float32 m_MaxFraction = 1.0f;
+
+		// The entry and exit points of every intersection, sorted by fraction. The top and 
+		// bottom faces of a fixture are split up wherever another fixture's entry or exit 
+		// lands inside it, so that they get drawn in the right order.
+		std::vector<SplitPoint> m_SplitPoints;
+
+		// What the intersections get split up into on the way to becoming drawables.
+		PreparedSpans m_Spans;
 
-				// If it's a back face
-				if (thisIntersection.m_facing == RayIntersection::Facing::Away)
-				{
-					b2Vec2 point = thisIntersection.m_point;
+		int m_Index = 0;
 
-					std::array<b2Vec2, 10> points;
-					int numPoints = 0;
+		int GetCount() const { return (int)m_RenderIds.size(); }
 
-					points[numPoints] = point;
-					numPoints++;
+		void Add(const unsigned renderId, const Physics::RayCastHit& hit);
 
-					// Get the corresponding front face.
-					for (int followingIndex = index + 1; followingIndex < collection.m_IntersectionCount; followingIndex++)
-					{
-						auto& thatIntersection = collection.m_Intersections[followingIndex];
+		// Removes any intersections with an entry fraction greater than maxFraction.
+		void Clip(const float32 maxFraction);
 
-						if (thatIntersection.m_fixture == thisIntersection.m_fixture)
-						{
-							std::copy(std::begin(points), std::begin(points) + numPoints, std::begin(thatIntersection.m_backPoints));
-							thatIntersection.m_numBackPoints = numPoints;
-							break;
-						}
-						else 
-						{
-							point = thatIntersection.m_point;
+		void Clear(const int index);
+	};
 
-							points[numPoints] = point;
-							numPoints++;
-						}
-					}
-				}
-			}
+	// What's left of a column once its intersections have been processed.
+	struct Column
+	{
+		// Back to front.
+		std::vector<Drawable> m_Drawables;
 
-			// Remove back faces
-			auto it = std::remove_if(
-				collection.m_Intersections.begin(),
-				collection.m_Intersections.begin() + collection.m_IntersectionCount,
-				[](RayIntersection& intersection)
-				{
-					return intersection.m_facing == RayIntersection::Facing::Away;
-				});
-				
-			collection.m_IntersectionCount = it - collection.m_Intersections.begin();
-		});
+		// Where its ray stopped: at the end, or where the occluders covered the whole column.
+		b2Vec2 m_RayEnd;
+	};
 
-	// shove all intersections into one big array
-	for (const auto& collection : m_IntersectionsPerColumn)
+	class RaycastCallback
 	{
-		const auto begin = std::begin(collection.m_Intersections);
-		const auto end = begin + collection.m_IntersectionCount;
+	public:
+		IntersectionCollection* m_Collection;
 
-		m_AllIntersections.insert(
-			std::end(m_AllIntersections),
-			begin,
-			end);
-	}
+		// Needed to work out how much of the column opaque fixtures cover.
+		const Camera3D* m_Camera;
+		const RenderAttributeTable* m_Attributes;
+		float m_TargetHeight;
 
-	// sort by distance such that further away intersections come first
-	std::sort(
-		m_AllIntersections.begin(),
-		m_AllIntersections.end(),
-		[](const RayIntersection& a, const RayIntersection& b)
-	{
-		return (a.m_fraction > b.m_fraction);
-	});
+		// Returns the fraction to clip the ray to.
+		float32 operator()(const Physics::RayCastHit& hit);
 
-	const auto targetSize = target.getSize();
-	auto& drawables = m_Drawables;
+		// For billboards, which don't have a fixture.
+		float32 AddHit(const FixtureRenderData& renderData, const Physics::RayCastHit& hit);
 
-	auto Prepare = [targetSize, &camera, &drawables](const RayIntersection& intersection)
-	{
-		const auto screenX = intersection.m_screenX;
-		const auto& normal = intersection.m_normal;
-		const auto& renderData =
-			*(qvr::FixtureRenderData*)(intersection.m_fixture->GetUserData());
-		
-		auto CreateDrawable = [normal, screenX, targetSize, &camera, &drawables, &renderData](b2Vec2 const& nearPoint, b2Vec2 const& farPoint, bool frontFace)
-		{
-			const b2Vec2 displacementNear = nearPoint - camera.GetPosition();
-			const float  distanceNear = b2Dot(displacementNear, camera.GetForwards());
+	private:
+		void AddOccluder(const Occluder& occluder);
+	};
 
-			const b2Vec2 displacementFar = farPoint - camera.GetPosition();
-			const float  distanceFar = b2Dot(displacementFar, camera.GetForwards());
+	// One each per ray in a packet, per worker thread. The callbacks are pointed at the 
+	// IntersectionCollections with the same index.
+	std::vector<IntersectionCollection> m_IntersectionCollections;
+	std::vector<RaycastCallback> m_RaycastCallbacks;
+
+	std::unique_ptr<WorkerPool> m_WorkerPool;
+
+	// Rebuilt for each view before its columns get cast.
+	RenderAttributeTable m_RenderAttributes;
+
+	// With RenderSettings::m_CullToView, everything in view that isn't in the World's 
+	// static geometry grid, plus the potentially visible static fixtures in view. Rebuilt 
+	// every frame, since what's in view changes whenever the camera turns.
+	b2DynamicTree m_DynamicTree;
+	std::vector<int32> m_DynamicTreeProxies;
+	std::vector<Physics::FixtureChild> m_DynamicTreeFixtures;
+
+	// Leaves out everything in grid, if there is one, everything that's drawn somewhere 
+	// else, and everything outside all of views, if there are any. Then adds staticFixtures,
+	// if there are any.
+	void BuildDynamicTree(
+		const b2World& physicsWorld, 
+		const Physics::StaticGeometryGrid* grid,
+		const std::vector<DrawnTransform>* drawnTransforms,
+		const std::vector<ViewTriangle>& views,
+		const std::vector<Physics::FixtureChild>* staticFixtures);
+
+	// The fixtures of the bodies in RaycastScene::m_DrawnTransforms, where they're drawn.
+	// Rebuilt every frame there are any, which is only while the World is between steps.
+	// The rays are cast against them here, and skip them everywhere else.
+	Physics::TransformedFixtureTree m_DrawnTree;
+	std::vector<int32> m_DrawnTreeProxies;
+	std::vector<Physics::TransformedFixtureChild> m_DrawnTreeFixtures;
+
+	void BuildDrawnTree(const std::vector<DrawnTransform>& drawnTransforms);
+
+	// Without m_CullToView, just the potentially visible static fixtures. Only rebuilt when 
+	// the set changes, or the World's bodies have been created, destroyed or moved outside
+	// of a step (see BodyChanges::m_Revision).
+	b2DynamicTree m_PotentiallyVisibleTree;
+	std::vector<int32> m_PotentiallyVisibleProxies;
+	std::vector<Physics::FixtureChild> m_PotentiallyVisibleFixtures;
+	unsigned m_PotentiallyVisibleRevision = 0;
+
+	void BuildPotentiallyVisibleTree(
+		const std::vector<Physics::FixtureChild>& fixtures, 
+		const BodyChanges* changes);
+
+	// The cameras of every view being rendered this frame.
+	std::vector<const Camera3D*> m_FrameCameras;
+
+	// Whether PrepareCasting has been done for this frame yet. It's put off until a view has
+	// a column to cast, because if none do it isn't needed.
+	bool m_CastingPrepared = false;
+	bool m_CastAgainstGrid = false;
+	bool m_CastAgainstDynamicTree = false;
+	bool m_CastAgainstPotentiallyVisibleTree = false;
+	bool m_CastAgainstDrawnTree = false;
+	// When not casting against m_DynamicTree, the rays are cast against the World's 
+	// broadphase instead, skipping the bodies in this grid (if there is one), and the ones
+	// in m_DrawnTree.
+	const Physics::StaticGeometryGrid* m_SkippedGrid = nullptr;
+
+	std::vector<ViewTriangle> m_ViewTriangles;
+
+	// With more than one view, the potentially visible sets of all their cells.
+	std::vector<Physics::FixtureChild> m_PotentiallyVisibleUnion;
+
+	// Does what doesn't depend on which view is being rendered, once per frame. Every view
+	// has to be rendered after it.
+	void BeginFrame(
+		const RaycastScene& scene, 
+		const std::vector<const Camera3D*>& cameras, 
+		const RenderSettings& settings);
+
+	// Decides what the rays get cast against, for every view, and builds m_DynamicTree.
+	void PrepareCasting(const RaycastScene& scene, const RenderSettings& settings);
+
+	// Every column's Nth-from-the-front drawable, in column order. Drawing the layers from
+	// the back one to the front one keeps every column in back-to-front order.
+	struct Layer
+	{
+		std::vector<Drawable> m_Drawables;
+		std::vector<FrontQuad> m_FrontQuads;
+	};
 
-			const bool drawTopOrBottom = /*distanceFar != distanceNear*/ /*frontFace*/ true;
+	std::vector<Layer> m_Layers;
+	int m_LayerCount = 0;
 
-			// At a distance of 1 metre, a vertical metre is enough pixels in height to fill the screen.
-			const float oneMetreInPixelsNear = abs(targetSize.y / distanceNear);
-			const float oneMetreInPixelsFar = abs(targetSize.y / distanceFar);
+	// With an atlas, the drawables' textures are swapped for the pages they're packed onto.
+	void BuildLayers(const bool mergeFrontFaces, const float farFieldDistance, const TextureAtlas* atlas);
 
-			auto CalculateLineOffset = [&renderData, &camera](float const oneMetreInPixels)
-			{
-				const float groundOffset = renderData.GetGroundOffset() * 2.0f;
-				const float heightOffset = renderData.GetHeight() - 1.0f;
-				const float cameraHeightOffset = camera.GetHeightOffset();
+	struct Vertex {
+		sf::Vector3f position;
+		sf::Vector3f normal;
+		sf::Vector2f texCoords;
+		sf::Color color;
+	};
 
-				return (-groundOffset - heightOffset - cameraHeightOffset) * oneMetreInPixels;
-			};
+	// A run of m_Vertices that can be drawn with one call.
+	struct Batch
+	{
+		sf::Shader* m_Shader;
+		const sf::Texture* m_Texture;
+		GLenum m_Primitive;
+		// Written to the depth buffer, with see-through texels thrown away, instead of 
+		// blended.
+		bool m_Opaque;
+		GLint m_First;
+		GLsizei m_Count;
+	};
 
-			const float lineOffsetNear = CalculateLineOffset(oneMetreInPixelsNear);
+	// The whole frame's vertices, in the order they're drawn.
+	std::vector<Vertex> m_Vertices;
+	std::vector<Batch> m_Batches;
 
-			const float cameraPitchOffset = (float)GetPitchOffsetInPixels(camera, targetSize.y);
+	RaycastRenderStats m_Stats;
 
-			const float lineHeightNear = renderData.GetHeight() * oneMetreInPixelsNear;
-			const float lineStartYNear = ((targetSize.y - lineHeightNear + lineOffsetNear) / 2) + cameraPitchOffset;
-			const float lineEndYNear = ((targetSize.y + lineHeightNear + lineOffsetNear) / 2) + cameraPitchOffset;
+	// Fills m_Vertices and m_Batches from the layers. With depthBuffer, the opaque 
+	// drawables come first, grouped by texture and front to back within each group, and 
+	// only the translucent ones are left in layer order.
+	void BuildBatches(const bool depthBuffer);
 
-			const float lineOffsetFar = CalculateLineOffset(oneMetreInPixelsFar);
+	// For RenderSettings::m_UseDepthBuffer.
+	std::vector<const Drawable*> m_OpaqueDrawables;
+	std::vector<const FrontQuad*> m_OpaqueQuads;
 
-			const float lineHeightFar = renderData.GetHeight() * oneMetreInPixelsFar;
-			const float lineStartYFar = ((targetSize.y - lineHeightFar + lineOffsetFar) / 2) + cameraPitchOffset;
-			const float lineEndYFar = ((targetSize.y + lineHeightFar + lineOffsetFar) / 2) + cameraPitchOffset;
+	// Starts a new Batch, unless the last one can just be made longer.
+	void BeginBatch(
+		sf::Shader& shader, 
+		const sf::Texture* texture, 
+		const GLenum primitive, 
+		const bool opaque);
 
-			const Animation::Rect textureRect =
-				renderData.GetViews().viewCount <= 1 ?
-				renderData.GetViews().views[0] :
-				CalculateView(
-					renderData.GetViews(),
-					renderData.GetObjectAngle(),
-					[&camera, &renderData]() {
-						const b2Vec2 disp = renderData.GetSpritePosition() - camera.GetPosition();
-						return b2Atan2(disp.y, disp.x) + b2_pi;
-					}());
+	void AddLines(const Drawable& drawable, const bool opaque);
+	void AddQuad(const FrontQuad& quad, const bool opaque);
 
-			auto CalculateU = [&camera](
-				const b2Vec2& hitPoint,
-				const b2Vec2& flatSpritePos,
-				const float flatSpriteRadius,
-				const Animation::Rect& textureRect)
-			{
-				const b2Vec2 perp(-camera.GetForwards().y, camera.GetForwards().x);
+	// For RenderSettings::m_UseSoftwareRasterizer.
+	SoftwareRasterizer m_SoftwareRasterizer;
+	SoftwareFramebuffer m_SoftwareFramebuffer;
+	sf::Texture m_SoftwareFramebufferTexture;
 
-				const b2Vec2 left = flatSpritePos - (flatSpriteRadius * perp);
+	// The image the pixels of every texture the SoftwareRasterizer has been given came from.
+	std::unordered_map<const sf::Texture*, const sf::Image*> m_SoftwareTextureCache;
 
-				float u = (hitPoint - left).Length() / (flatSpriteRadius * 2);
+	// Copies the pixels of any texture the columns' drawables use that isn't cached yet. 
+	// Uses OpenGL, so it can't be done on the worker threads.
+	void CacheSoftwareTextures();
 
-				// Convert to texels.
-				u *= textureRect.right - textureRect.left;
-				u += textureRect.left;
+	// Draws every column's drawables into the framebuffer with the SoftwareRasterizer.
+	void Rasterize(const RaycastScene& scene, SoftwareFramebuffer& target);
 
-				return u;
-			};
+	sf::Shader mShader;
+	sf::Shader mQuadShader;
 
-			const float u = CalculateU(
-				nearPoint,
-				renderData.GetSpritePosition(),
-				renderData.GetSpriteRadius(),
-				textureRect);
-
-			Drawable output;
-			output.m_BlendColor = renderData.GetColor();
-			output.m_Texture = renderData.GetTexture();
-			output.m_X = (float)screenX;
-			output.m_Top = lineStartYNear;
-			output.m_Bottom = lineEndYNear;
-			output.m_DistanceNear = distanceNear;
-			output.m_DistanceFar = distanceFar;
-			output.m_U = u;
-			output.m_VTop = (float)textureRect.top;
-			output.m_VBottom = (float)textureRect.bottom;
-			output.m_Normal = sf::Vector3f(normal.x, normal.y, 0.0f);
-			output.m_DrawFront = frontFace;
-			output.m_DrawTop = drawTopOrBottom && lineStartYFar < lineStartYNear;
-			output.m_DrawBottom = drawTopOrBottom && lineEndYFar > lineEndYNear;
-
-			output.m_FarY = output.m_DrawTop ? lineStartYFar : output.m_DrawBottom ? lineEndYFar : output.m_Top;
-
-			drawables.push_back(output);
-		};
+	void LoadShader();
 
-		for (int pointIndex = 0; pointIndex < intersection.m_numBackPoints - 1; pointIndex++)
-		{
-			CreateDrawable(intersection.m_backPoints[pointIndex + 1], intersection.m_backPoints[pointIndex], false);
-		}
+	// Sorts the collection's intersections back to front and fills in its sorted list of 
+	// split points.
+	static void ProcessIntersections(IntersectionCollection& collection);
 
-		if (intersection.m_numBackPoints > 0)
+	// Everything besides the World's fixtures that decides where the columns' rays go and 
+	// what they turn into.
+	struct CastState
+	{
+		b2Vec2 m_CameraPosition;
+		b2Vec2 m_CameraForwards;
+		float m_ViewPlaneWidthModifier;
+		float m_CameraHeightOffset;
+		int m_PitchOffset;
+		sf::Vector2u m_TargetSize;
+		float m_RayLength;
+		float m_FogDistance;
+		float m_FarFieldDistance;
+		bool m_UseStaticGeometryGrid;
+		int m_ColumnStride;
+		bool m_UseTextureLods;
+
+		bool operator==(const CastState& other) const
 		{
-			CreateDrawable(intersection.m_point, intersection.m_backPoints[intersection.m_numBackPoints - 1], true);
+			return
+				m_CameraPosition == other.m_CameraPosition &&
+				m_CameraForwards == other.m_CameraForwards &&
+				m_ViewPlaneWidthModifier == other.m_ViewPlaneWidthModifier &&
+				m_CameraHeightOffset == other.m_CameraHeightOffset &&
+				m_PitchOffset == other.m_PitchOffset &&
+				m_TargetSize == other.m_TargetSize &&
+				m_RayLength == other.m_RayLength &&
+				m_FogDistance == other.m_FogDistance &&
+				m_FarFieldDistance == other.m_FarFieldDistance &&
+				m_UseStaticGeometryGrid == other.m_UseStaticGeometryGrid &&
+				m_ColumnStride == other.m_ColumnStride &&
+				m_UseTextureLods == other.m_UseTextureLods;
 		}
 	};
 
-	std::for_each(
-		m_AllIntersections.begin(),
-		m_AllIntersections.end(),
-		Prepare);
+	// Everything kept from one frame to the next for each view.
+	struct ViewState
+	{
+		std::vector<Column> m_Columns;
 
-	// sort by distance such that further away intersections come first
-	std::sort(
-		m_Drawables.begin(),
-		m_Drawables.end(),
-		[](const Drawable& a, const Drawable& b)
-		{
-			if (a.m_DistanceFar != b.m_DistanceFar)
-			{
-				return (a.m_DistanceFar > b.m_DistanceFar);
-			}
-			
-			return (a.m_FarY > b.m_FarY);
-		});
+		CastState m_LastCastState;
+		bool m_HasCastState = false;
 
-	class Drawer {
-	public:
-		Drawer(sf::RenderTarget& target, sf::Shader& shader, const World& world)
-			: m_Target(target)
-			, m_Shader(shader)
-		{
-			m_DefaultTexture.create(1, 1);
-			// Make it white.
-			{
-				auto c = sf::Color::White;
-				m_DefaultTexture.update(&c.r);
-			}
+		ColumnDepthBuffer m_ColumnDepthBuffer;
+	};
 
-			sf::Shader::bind(&m_Shader);
-			shader.setUniform("ambientLightColor", sf::Glsl::Vec4(world.GetAmbientLight().mColor));
+	std::vector<ViewState> m_Views;
 
-			shader.setUniform("directionalLightDirection", B2VecToSFVec(world.GetDirectionalLight().GetDirection()));
-			shader.setUniform("directionalLightColor", sf::Glsl::Vec4(world.GetDirectionalLight().GetColor()));
+	// The one being rendered.
+	ViewState* m_View = nullptr;
 
-			shader.setUniform("fogColor", sf::Glsl::Vec4(world.GetFog().GetColor()));
-			shader.setUniform("fogMaxIntensity", world.GetFog().GetMaxIntensity());
-			shader.setUniform("fogMaxDistance", world.GetFog().GetMaxDistance());
-			shader.setUniform("fogMinDistance", world.GetFog().GetMinDistance());
+	// For RenderSettings::m_ReuseColumns.
+	RaycastSceneSnapshot m_SceneSnapshot;
 
-			sf::Texture::bind(&m_DefaultTexture, sf::Texture::CoordinateType::Pixels);
-			shader.setUniform("texture", sf::Shader::CurrentTexture);
+	std::vector<int> m_ColumnsToCast;
+	std::vector<int> m_ColumnsToInterpolate;
+	std::vector<bool> m_ColumnNeedsCasting;
 
-			glCheck(glEnableClientState(GL_VERTEX_ARRAY));
-			glCheck(glEnableClientState(GL_COLOR_ARRAY));
-			glCheck(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
-			glCheck(glEnableClientState(GL_NORMAL_ARRAY));
+	// Whether the columns between left and right can be filled in from them: they have to hit
+	// the same faces of the same fixtures, and nothing else can be in between their rays.
+	bool CanInterpolateBetween(
+		const RaycastScene& scene, 
+		const b2Vec2& cameraPosition, 
+		const int left, 
+		const int right);
 
-			glCheck(glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &m_Line[0].position));
-			glCheck(glNormalPointer(GL_FLOAT, sizeof(Vertex), &m_Line[0].normal));
-			glCheck(glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &m_Line[0].color));
-			glCheck(glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &m_Line[0].texCoords));
-		}
+	// Fills in a column's drawables from the columns either side of it, once 
+	// CanInterpolateBetween has said it can be.
+	void InterpolateColumn(const int column, const int left, const int right);
 
-		void operator()(const Drawable& drawable) {
-			if (drawable.m_Texture != m_LastTexture) {
-				m_LastTexture = drawable.m_Texture;
+	// Reused by CanInterpolateBetween.
+	std::vector<const FixtureRenderData*> m_GapRenderData;
 
-				const sf::Texture* textureToBind;
+	// Casts the ray of every column that needs it and fills in its drawables. The rest keep
+	// what they had last time.
+	void CastColumns(
+		const RaycastScene& scene, 
+		const Camera3D& camera, 
+		const RenderSettings& settings, 
+		const sf::Vector2u targetSize);
 
-				if (drawable.m_Texture)
-				{
-					textureToBind = drawable.m_Texture;
-				}
-				else
-				{
-					textureToBind = &m_DefaultTexture;
-				}
+public:
+	WorldRaycastRendererImpl()
+	{
+		LoadShader();
 
-				sf::Texture::bind(textureToBind, sf::Texture::CoordinateType::Pixels);
-				m_Shader.setUniform("texture", sf::Shader::CurrentTexture);
-			}
+		// So there's a ColumnDepthBuffer to get before anything's been rendered.
+		m_Views.resize(1);
+	}
 
-			m_Line[0].position.x = drawable.m_X;
-			m_Line[1].position.x = drawable.m_X;
+	void Render(
+		const RaycastScene& scene, 
+		const Camera3D& camera, 
+		const RenderSettings& settings, 
+		sf::RenderTarget& target);
 
-			m_Line[0].color = drawable.m_BlendColor;
-			m_Line[1].color = drawable.m_BlendColor;
+	void Render(
+		const RaycastScene& scene, 
+		const gsl::span<const RaycastView> views,
+		const RenderSettings& settings);
 
-			DrawTop(drawable);
-			DrawBottom(drawable);
-			DrawFront(drawable);
-		}
+	void Render(
+		const RaycastScene& scene, 
+		const Camera3D& camera, 
+		const RenderSettings& settings, 
+		SoftwareFramebuffer& target);
 
-		~Drawer()
-		{
-			glCheck(glDisableClientState(GL_VERTEX_ARRAY));
-			glCheck(glDisableClientState(GL_COLOR_ARRAY));
-			glCheck(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
-			glCheck(glDisableClientState(GL_NORMAL_ARRAY));
+	const RaycastRenderStats& GetStats() const { return m_Stats; }
 
-			m_Target.resetGLStates();
-		}
+	const ColumnDepthBuffer& GetColumnDepthBuffer(const int view) const
+	{
+		return m_Views[view].m_ColumnDepthBuffer;
+	}
 
-	private:
-		void DrawLine()
-		{
-			glCheck(glDrawArrays(GL_LINES, 0, 2));
-		}
+private:
+	// Renders m_View.
+	void RenderView(
+		const RaycastScene& scene, 
+		const Camera3D& camera, 
+		const RenderSettings& settings, 
+		sf::RenderTarget& target);
 
-		void DrawFront(const Drawable& drawable)
-		{
-			if (!drawable.m_DrawFront)
-			{
-				return;
-			}
+	// Fills in m_ColumnDepthBuffer from the columns' drawables.
+	void BuildColumnDepthBuffer(const Camera3D& camera, const float targetHeight);
+};
 
-			m_Line[0].position.y = drawable.m_Top;
-			m_Line[1].position.y = drawable.m_Bottom;
-			m_Line[0].position.z = drawable.m_DistanceNear;
-			m_Line[1].position.z = drawable.m_DistanceNear;
+void WorldRaycastRendererImpl::BeginFrame(
+	const RaycastScene& scene, 
+	const std::vector<const Camera3D*>& cameras, 
+	const RenderSettings& settings)
+{
+	assert(scene.m_PhysicsWorld);
 
-			m_Line[0].normal = drawable.m_Normal;
-			m_Line[1].normal = drawable.m_Normal;
+	m_Stats = RaycastRenderStats();
 
-			m_Line[0].texCoords.x = drawable.m_U;
-			m_Line[0].texCoords.y = drawable.m_VTop;
-			m_Line[1].texCoords.x = drawable.m_U;
-			m_Line[1].texCoords.y = drawable.m_VBottom;
+	const unsigned threadCount = (unsigned)std::max(1, settings.m_ThreadCount);
 
-			DrawLine();
-		}
+	if (!m_WorkerPool || m_WorkerPool->GetThreadCount() != threadCount)
+	{
+		m_WorkerPool = std::make_unique<WorkerPool>(threadCount);
+
+		m_IntersectionCollections.resize(threadCount * b2_maxRayPacketSize);
+		m_RaycastCallbacks.resize(threadCount * b2_maxRayPacketSize);
 
-		void DrawTop(const Drawable& drawable)
+		for (unsigned index = 0; index < m_RaycastCallbacks.size(); index++)
 		{
-			if (!drawable.m_DrawTop)
-			{
-				return;
-			}
+			m_RaycastCallbacks[index].m_Collection = &m_IntersectionCollections[index];
+		}
+	}
 
-			m_Line[0].position.y = drawable.m_FarY;
-			m_Line[1].position.y = drawable.m_Top;
-			m_Line[0].position.z = drawable.m_DistanceFar;
-			m_Line[1].position.z = drawable.m_DistanceNear;
+	// The changes since the last frame are the same for every view, as long as every view 
+	// is rendered every frame.
+	if (settings.m_ReuseColumns)
+	{
+		m_SceneSnapshot.Update(
+			*scene.m_PhysicsWorld, scene.m_Billboards, scene.m_BodyChanges, scene.m_DrawnTransforms);
+	}
+	else
+	{
+		m_SceneSnapshot.Clear();
+	}
 
-			m_Line[0].normal = sf::Vector3f(0.0f, 0.0f, 1.0f);
-			m_Line[1].normal = sf::Vector3f(0.0f, 0.0f, 1.0f);
+	m_FrameCameras = cameras;
 
-			DrawLine();
-		}
+	if (m_Views.size() != cameras.size())
+	{
+		m_Views.resize(cameras.size());
+	}
 
-		void DrawBottom(const Drawable& drawable)
-		{
-			if (!drawable.m_DrawBottom)
-			{
-				return;
-			}
+	m_View = nullptr;
 
-			m_Line[0].position.y = drawable.m_Bottom;
-			m_Line[1].position.y = drawable.m_FarY;
-			m_Line[0].position.z = drawable.m_DistanceNear;
-			m_Line[1].position.z = drawable.m_DistanceFar;
+	m_CastingPrepared = false;
+}
 
-			m_Line[0].normal = sf::Vector3f(0.0f, 0.0f, -1.0f);
-			m_Line[1].normal = sf::Vector3f(0.0f, 0.0f, -1.0f);
+void WorldRaycastRendererImpl::PrepareCasting(const RaycastScene& scene, const RenderSettings& settings)
+{
+	m_CastingPrepared = true;
 
-			DrawLine();
-		}
+	const bool useStaticGeometry = settings.m_UseStaticGeometryGrid && scene.m_StaticGeometry;
+	const bool cullToView = settings.m_CullToView;
 
-		sf::RenderTarget& m_Target;
-		sf::Shader& m_Shader;
+	// Only the static geometry that can be seen from the cameras' cells. If any of them 
+	// isn't in a cell, or the rays reach further than the sets were worked out for, they 
+	// all have to use the grid.
+	const std::vector<Physics::FixtureChild>* potentiallyVisible = nullptr;
 
-		const sf::Texture* m_LastTexture = nullptr;
+	if (settings.m_UsePotentiallyVisibleSets && scene.m_PotentiallyVisibleSets)
+	{
+		m_PotentiallyVisibleUnion.clear();
 
-		// Flat white, like a coffee.
-		sf::Texture m_DefaultTexture;
+		for (const Camera3D* camera : m_FrameCameras)
+		{
+			potentiallyVisible = 
+				scene.m_PotentiallyVisibleSets->GetVisibleFixtures(
+					camera->GetPosition(),
+					settings.m_RayLength);
 
-		struct Vertex {
-			sf::Vector3f position;
-			sf::Vector3f normal;
-			sf::Vector2f texCoords;
-			sf::Color color;
-		};
+			if (!potentiallyVisible) break;
 
-		Vertex m_Line[2];
-	};
+			if (m_FrameCameras.size() > 1)
+			{
+				m_PotentiallyVisibleUnion.insert(
+					m_PotentiallyVisibleUnion.end(), 
+					potentiallyVisible->begin(), 
+					potentiallyVisible->end());
+			}
+		}
 
-	std::for_each(
-		m_Drawables.begin(),
-		m_Drawables.end(),
-		Drawer(target, mShader, world));
-}
+		if (potentiallyVisible && m_FrameCameras.size() > 1)
+		{
+			auto Key = [](const Physics::FixtureChild& child) {
+				return std::make_pair(child.fixture, child.childIndex); };
 
-float32 WorldRaycastRendererImpl::ForwardRaycastCallback::ReportFixture(
-	b2Fixture* fixture, 
-	b2Vec2 const& point, 
-	b2Vec2 const& normal, 
-	float32 fraction)
-{
-	if (fixture->GetUserData() == nullptr)
+			std::sort(
+				m_PotentiallyVisibleUnion.begin(),
+				m_PotentiallyVisibleUnion.end(),
+				[Key](const auto& a, const auto& b) { return Key(a) < Key(b); });
+
+			m_PotentiallyVisibleUnion.erase(
+				std::unique(
+					m_PotentiallyVisibleUnion.begin(),
+					m_PotentiallyVisibleUnion.end(),
+					[Key](const auto& a, const auto& b) { return Key(a) == Key(b); }),
+				m_PotentiallyVisibleUnion.end());
+
+			potentiallyVisible = &m_PotentiallyVisibleUnion;
+		}
+	}
+
+	m_CastAgainstGrid = useStaticGeometry && !potentiallyVisible;
+	m_CastAgainstDynamicTree = cullToView;
+	m_CastAgainstPotentiallyVisibleTree = potentiallyVisible && !cullToView;
+	m_SkippedGrid = (useStaticGeometry || potentiallyVisible) ? scene.m_StaticGeometry : nullptr;
+	m_CastAgainstDrawnTree = scene.m_DrawnTransforms && !scene.m_DrawnTransforms->empty();
+
+	if (m_CastAgainstDrawnTree)
 	{
-		return 1;
+		BuildDrawnTree(*scene.m_DrawnTransforms);
 	}
 
-	if (m_Collection->m_IntersectionCount >= (int)m_Collection->m_Intersections.size())
+	if (m_CastAgainstPotentiallyVisibleTree)
 	{
-		return 0;
+		BuildPotentiallyVisibleTree(*potentiallyVisible, scene.m_BodyChanges);
 	}
 
-	RayIntersection& newIntersection = m_Collection->m_Intersections[m_Collection->m_IntersectionCount++];
+	if (m_CastAgainstDynamicTree)
+	{
+		m_ViewTriangles.clear();
 
-	newIntersection.m_fixture = fixture;
-	newIntersection.m_point = point;
-	newIntersection.m_normal = normal;
-	newIntersection.m_fraction = fraction;
-	newIntersection.m_screenX = (int)m_Collection->m_Index;
-	newIntersection.m_facing = RayIntersection::Facing::Towards;
+		if (cullToView)
+		{
+			for (const Camera3D* camera : m_FrameCameras)
+			{
+				const b2Vec2 cameraForwards = camera->GetForwards();
+				const float viewPlaneWidthModifier = camera->GetViewPlaneWidthModifier();
+				const b2Vec2 viewPlane(
+					cameraForwards.y * viewPlaneWidthModifier * (-1),
+					cameraForwards.x * viewPlaneWidthModifier);
+
+				m_ViewTriangles.emplace_back(
+					camera->GetPosition(), cameraForwards, viewPlane, settings.m_RayLength);
+			}
+		}
 
-	return 1;
-}
+		BuildDynamicTree(
+			*scene.m_PhysicsWorld, 
+			m_SkippedGrid, 
+			m_CastAgainstDrawnTree ? scene.m_DrawnTransforms : nullptr,
+			m_ViewTriangles, 
+			potentiallyVisible);
+	}
 
-float32 WorldRaycastRendererImpl::BackwardRaycastCallback::ReportFixture(
-	b2Fixture* fixture,
-	b2Vec2 const& point,
-	b2Vec2 const& normal,
-	float32 fraction)
-{
-	if (fixture->GetUserData() == nullptr)
+	if (potentiallyVisible)
 	{
-		return 1;
+		m_Stats.m_PotentiallyVisibleFixtures = (int)potentiallyVisible->size();
 	}
+}
+
+void WorldRaycastRendererImpl::CastColumns(
+	const RaycastScene& scene, 
+	const Camera3D & camera, 
+	const RenderSettings& settings, 
+	const sf::Vector2u targetSize)
+{
+	const auto targetWidth = targetSize.x;
 
-	if (m_Collection->m_IntersectionCount >= (int)m_Collection->m_Intersections.size())
+	if (m_View->m_Columns.size() != targetWidth)
 	{
-		return 0;
+		m_View->m_Columns.resize(targetWidth);
 	}
 
-	RayIntersection& newIntersection = m_Collection->m_Intersections[m_Collection->m_IntersectionCount++];
+	const b2World& physicsWorld = *scene.m_PhysicsWorld;
 
-	newIntersection.m_fixture = fixture;
-	newIntersection.m_point = point;
-	newIntersection.m_normal = -normal; // flip the normal
-	newIntersection.m_fraction = 1.0f - fraction; // flip the fraction
-	newIntersection.m_screenX = m_Collection->m_Index;
-	newIntersection.m_facing = RayIntersection::Facing::Away;
+	// Only used if m_CastAgainstGrid, which means there is one.
+	const Physics::StaticGeometryGrid* staticGeometry = scene.m_StaticGeometry;
 
-	return 1;
-}
+	const BillboardStore& billboards = *scene.m_Billboards;
+
+	const int stride = std::max(1, settings.m_ColumnStride);
+
+	const float farFieldDistance = 
+		settings.m_FarFieldDistance > 0.0f ? 
+		settings.m_FarFieldDistance : 
+		std::numeric_limits<float>::max();
+
+	const auto cameraPosition = camera.GetPosition();
+	const auto cameraForwards = camera.GetForwards();
+	const float screenXDelta = 2.0f / (float)targetWidth;
+
+	const float viewPlaneWidthModifier = camera.GetViewPlaneWidthModifier();
+	// The 'view plane' vector is the camera's right-vector, stretched/squashed a bit:
+	const b2Vec2 viewPlane(
+		cameraForwards.y * viewPlaneWidthModifier * (-1),
+		cameraForwards.x * viewPlaneWidthModifier);
+
+	// Nothing further away than where the fog reaches full intensity is worth casting for.
+	const float fogDistance =
+		(settings.m_ClampRayLengthToFog && scene.m_Fog->GetMaxIntensity() >= 1.0f) ?
+		scene.m_Fog->GetMaxDistance() :
+		std::numeric_limits<float>::max();
+
+	auto CalculateRayEnd = [&](const int column)
+	{
+		const auto screenX = -1.0f + screenXDelta * column;
+		auto rayDir = (cameraForwards + (screenX * viewPlane));
+		rayDir.Normalize();
+		// The fog goes by the distance straight ahead of the camera, not along the ray.
+		const float rayLength = std::min(settings.m_RayLength, fogDistance / b2Dot(rayDir, cameraForwards));
+		return cameraPosition + (rayLength * rayDir);
+	};
+
+	// Work out which columns actually need casting. If nothing that affects the rays has
+	// changed, a column only needs casting again if its ray passes through a fixture that 
+	// has changed.
+	{
+		const CastState castState{
+			cameraPosition,
+			cameraForwards,
+			viewPlaneWidthModifier,
+			camera.GetHeightOffset(),
+			GetPitchOffsetInPixels(camera, targetSize.y),
+			targetSize,
+			settings.m_RayLength,
+			fogDistance,
+			farFieldDistance,
+			settings.m_UseStaticGeometryGrid,
+			stride,
+			settings.m_UseTextureLods };
+
+		const bool castEverything = 
+			!settings.m_ReuseColumns ||
+			!m_View->m_HasCastState || 
+			!(castState == m_View->m_LastCastState);
+
+		m_View->m_LastCastState = castState;
+		m_View->m_HasCastState = settings.m_ReuseColumns;
+
+		m_ColumnsToCast.clear();
+
+		if (castEverything)
+		{
+			for (int column = 0; column < (int)targetWidth; column++)
+			{
+				m_ColumnsToCast.push_back(column);
+			}
+		}
+		else
+		{
+			m_ColumnNeedsCasting.assign(targetWidth, false);
+
+			const float rayLengthSquared = settings.m_RayLength * settings.m_RayLength;
+			const float viewPlaneLengthSquared = viewPlane.LengthSquared();
+
+			for (const b2AABB& region : m_SceneSnapshot.GetChangedRegions())
+			{
+				// Out of reach of every ray?
+				const b2Vec2 closestPoint = b2Clamp(cameraPosition, region.lowerBound, region.upperBound);
+
+				if (b2DistanceSquared(closestPoint, cameraPosition) > rayLengthSquared) continue;
+
+				const b2Vec2 corners[] = {
+					region.lowerBound,
+					b2Vec2(region.upperBound.x, region.lowerBound.y),
+					region.upperBound,
+					b2Vec2(region.lowerBound.x, region.upperBound.y) };
+
+				float firstColumn = std::numeric_limits<float>::max();
+				float lastColumn = -std::numeric_limits<float>::max();
+				int cornersBehind = 0;
+
+				for (const b2Vec2& corner : corners)
+				{
+					const b2Vec2 displacement = corner - cameraPosition;
+					const float depth = b2Dot(displacement, cameraForwards);
+
+					if (depth <= b2_epsilon)
+					{
+						cornersBehind++;
+						continue;
+					}
+
+					// Invert CalculateRayEnd.
+					const float screenX = b2Dot(displacement, viewPlane) / (depth * viewPlaneLengthSquared);
+					const float column = (screenX + 1.0f) / screenXDelta;
+
+					firstColumn = std::min(firstColumn, column);
+					lastColumn = std::max(lastColumn, column);
+				}
+
+				// Every ray goes forwards, so nothing behind the camera can be hit.
+				if (cornersBehind == 4) continue;
+
+				if (cornersBehind > 0)
+				{
+					// The region is beside the camera, so it could be anywhere on screen.
+					firstColumn = 0.0f;
+					lastColumn = (float)targetWidth;
+				}
+
+				const int begin = std::max((int)std::floor(firstColumn) - 1, 0);
+				const int end = std::min((int)std::ceil(lastColumn) + 2, (int)targetWidth);
+
+				for (int column = begin; column < end; column++)
+				{
+					m_ColumnNeedsCasting[column] = true;
+				}
+			}
+
+			for (int column = 0; column < (int)targetWidth; column++)
+			{
+				if (m_ColumnNeedsCasting[column])
+				{
+					m_ColumnsToCast.push_back(column);
+				}
+			}
+		}
+
+		// Only cast every stride-th column (and the last one) to begin with. The rest get 
+		// filled in from those later, or cast if that can't be done.
+		m_ColumnsToInterpolate.clear();
+
+		if (stride > 1)
+		{
+			const auto IsCastFirst = [stride, targetWidth](const int column)
+			{
+				return (column % stride == 0) || (column == (int)targetWidth - 1);
+			};
+
+			const auto firstInterpolated = std::stable_partition(
+				m_ColumnsToCast.begin(), 
+				m_ColumnsToCast.end(), 
+				IsCastFirst);
+
+			m_ColumnsToInterpolate.assign(firstInterpolated, m_ColumnsToCast.end());
+			m_ColumnsToCast.erase(firstInterpolated, m_ColumnsToCast.end());
+		}
+
+		if (m_ColumnsToCast.empty() && m_ColumnsToInterpolate.empty()) return;
+	}
+
+	if (!m_CastingPrepared)
+	{
+		PrepareCasting(scene, settings);
+	}
+
+	const bool castAgainstGrid = m_CastAgainstGrid;
+	const bool castAgainstDynamicTree = m_CastAgainstDynamicTree;
+	const bool castAgainstPotentiallyVisibleTree = m_CastAgainstPotentiallyVisibleTree;
+	const bool castAgainstDrawnTree = m_CastAgainstDrawnTree;
+	const Physics::StaticGeometryGrid* skippedGrid = m_SkippedGrid;
+	const std::vector<DrawnTransform>* drawnTransforms = scene.m_DrawnTransforms;
+
+	const bool useTextureLods = settings.m_UseTextureLods;
+
+	m_RenderAttributes.Build(camera, (float)targetSize.y, *scene.m_RenderData);
+
+	const RenderAttributeTable& attributes = m_RenderAttributes;
+
+	// Splits an intersection up into one span for each stretch between its split points.
+	auto AddSpans = [farFieldDistance, &camera, &attributes](
+		IntersectionCollection& collection, 
+		const int intersection)
+	{
+		PreparedSpans& spans = collection.m_Spans;
+		const unsigned renderId = collection.m_RenderIds[intersection];
+
+		// Far enough away, tops, bottoms and whatever's behind the front face are too small
+		// to be worth drawing, and without them the front faces merge into quads more easily.
+		const b2Vec2& entryPoint = collection.m_EntryPoints[intersection];
+
+		if (b2Dot(entryPoint - camera.GetPosition(), camera.GetForwards()) >= farFieldDistance)
+		{
+			spans.Add(entryPoint, collection.m_ExitPoints[intersection], intersection, renderId, attributes, true, true);
+			return;
+		}
+
+		// Find the split points that lie between where the ray goes in and comes out.
+		const auto splitPointsBegin = collection.m_SplitPoints.begin();
+		const auto splitPointsEnd = collection.m_SplitPoints.end();
+
+		const auto firstInside = std::upper_bound(
+			splitPointsBegin,
+			splitPointsEnd,
+			collection.m_EntryFractions[intersection],
+			[](const float32 fraction, const SplitPoint& splitPoint)
+			{
+				return fraction < splitPoint.m_fraction;
+			});
+
+		const auto lastInside = std::lower_bound(
+			firstInside,
+			splitPointsEnd,
+			collection.m_ExitFractions[intersection],
+			[](const SplitPoint& splitPoint, const float32 fraction)
+			{
+				return splitPoint.m_fraction < fraction;
+			});
+
+		// Work from the back to the front.
+		b2Vec2 farPoint = collection.m_ExitPoints[intersection];
+
+		for (auto it = lastInside; it != firstInside; --it)
+		{
+			const b2Vec2 nearPoint = (it - 1)->m_point;
+			spans.Add(nearPoint, farPoint, intersection, renderId, attributes, false, false);
+			farPoint = nearPoint;
+		}
+
+		spans.Add(entryPoint, farPoint, intersection, renderId, attributes, true, false);
+	};
+
+	// Turns a span, once CalculateExtents has been done, into a drawable.
+	const b2Vec2 cameraPerp(-cameraForwards.y, cameraForwards.x);
+
+	auto CreateDrawable = [useTextureLods, cameraPerp, &attributes](
+		const IntersectionCollection& collection,
+		const int span)
+	{
+		const PreparedSpans& spans = collection.m_Spans;
+		const int intersection = spans.m_Intersections[span];
+		const unsigned renderId = collection.m_RenderIds[intersection];
+
+		const FixtureRenderData& renderData = *attributes.m_RenderData[renderId];
+		const Animation::Rect& textureRect = attributes.m_TextureRects[renderId];
+		const b2Vec2& normal = collection.m_EntryNormals[intersection];
+
+		const float lineStartYNear = spans.m_TopsNear[span];
+		const float lineEndYNear = spans.m_BottomsNear[span];
+
+		const float lineStartYFar = spans.m_TopsFar[span];
+		const float lineEndYFar = spans.m_BottomsFar[span];
+
+		const bool drawTopOrBottom = !spans.m_FarField[span];
+
+		const float u = [&]()
+		{
+			const b2Vec2 nearPoint(spans.m_NearX[span], spans.m_NearY[span]);
+			const float flatSpriteRadius = renderData.GetSpriteRadius();
+
+			const b2Vec2 left = renderData.GetSpritePosition() - (flatSpriteRadius * cameraPerp);
+
+			float u = (nearPoint - left).Length() / (flatSpriteRadius * 2);
+
+			// Convert to texels.
+			u *= textureRect.right - textureRect.left;
+			u += textureRect.left;
+
+			return u;
+		}();
+
+		// Pick the smallest copy of the texture whose texels are no further apart than the
+		// pixels they're drawn to. The lines are a column wide, so it's how far the texture 
+		// gets squashed vertically that counts.
+		int lod = 0;
+
+		if (useTextureLods && renderData.GetTextureLodCount() > 0)
+		{
+			const float texelsPerPixel =
+				std::abs((float)(textureRect.bottom - textureRect.top)) /
+				std::max(1.0f, lineEndYNear - lineStartYNear);
+
+			if (texelsPerPixel >= 2.0f)
+			{
+				lod = std::min((int)std::log2(texelsPerPixel), renderData.GetTextureLodCount());
+			}
+		}
+
+		const sf::Vector2f lodScale = renderData.GetTextureLodScale(lod);
+
+		Drawable output;
+		output.m_BlendColor = renderData.GetColor();
+		output.m_Texture = renderData.GetTexture(lod);
+		output.m_RenderData = &renderData;
+		output.m_X = (float)collection.m_Index;
+		output.m_Top = lineStartYNear;
+		output.m_Bottom = lineEndYNear;
+		output.m_DistanceNear = spans.m_DistancesNear[span];
+		output.m_DistanceFar = spans.m_DistancesFar[span];
+		output.m_U = u * lodScale.x;
+		output.m_VTop = textureRect.top * lodScale.y;
+		output.m_VBottom = textureRect.bottom * lodScale.y;
+		output.m_UOrigin = 0.0f;
+		output.m_VOrigin = 0.0f;
+		output.m_Normal = sf::Vector3f(normal.x, normal.y, 0.0f);
+		output.m_DrawFront = spans.m_FrontFaces[span];
+		output.m_DrawTop = drawTopOrBottom && lineStartYFar < lineStartYNear;
+		output.m_DrawBottom = drawTopOrBottom && lineEndYFar > lineEndYNear;
+
+		output.m_FarY = output.m_DrawTop ? lineStartYFar : output.m_DrawBottom ? lineEndYFar : output.m_Top;
+
+		return output;
+	};
+
+	// Columns don't depend on each other, so the workers can take them in any order.
+	// Ray casts only read from the broadphase, so it's safe to do them concurrently.
+	// Neighbouring columns' rays pass through mostly the same broadphase nodes, so they
+	// get cast together in packets.
+	const int packetSize = b2Clamp(settings.m_RayPacketSize, 1, b2_maxRayPacketSize);
+
+	auto ProcessColumns = [&](const int begin, const int end, const int workerIndex)
+	{
+		RaycastCallback* callbacks = &m_RaycastCallbacks[workerIndex * b2_maxRayPacketSize];
+		IntersectionCollection* collections = &m_IntersectionCollections[workerIndex * b2_maxRayPacketSize];
+
+		std::array<b2Vec2, b2_maxRayPacketSize> rayStarts;
+		std::array<b2Vec2, b2_maxRayPacketSize> rayEnds;
+
+		rayStarts.fill(cameraPosition);
+
+		for (int packetBegin = begin; packetBegin < end; packetBegin += packetSize)
+		{
+			const int packetEnd = std::min(packetBegin + packetSize, end);
+			const int rayCount = packetEnd - packetBegin;
+
+			for (int ray = 0; ray < rayCount; ++ray)
+			{
+				const int column = m_ColumnsToCast[packetBegin + ray];
+
+				collections[ray].Clear(column);
+
+				rayEnds[ray] = CalculateRayEnd(column);
+			}
+
+			auto CastPacket = [&](const auto& tree, const auto& filter)
+			{
+				// Don't look any further than what the static geometry has hidden already.
+				std::array<float32, b2_maxRayPacketSize> maxFractions;
+
+				for (int ray = 0; ray < rayCount; ++ray)
+				{
+					maxFractions[ray] = collections[ray].m_MaxFraction;
+				}
+
+				if (rayCount == 1)
+				{
+					Physics::RayCastEntryExit(
+						tree, callbacks[0], cameraPosition, rayEnds[0], maxFractions[0], filter);
+				}
+				else
+				{
+					Physics::RayCastEntryExitPacket(
+						tree,
+						callbacks,
+						rayStarts.data(),
+						rayEnds.data(),
+						rayCount,
+						maxFractions.data(),
+						filter);
+				}
+			};
+
+			const auto AcceptAll = [](const Physics::FixtureChild&) { return true; };
+
+			if (castAgainstGrid)
+			{
+				for (int ray = 0; ray < rayCount; ++ray)
+				{
+					staticGeometry->RayCast(callbacks[ray], cameraPosition, rayEnds[ray]);
+				}
+			}
+
+			if (castAgainstPotentiallyVisibleTree)
+			{
+				CastPacket(m_PotentiallyVisibleTree, AcceptAll);
+			}
+
+			if (castAgainstDynamicTree)
+			{
+				CastPacket(m_DynamicTree, AcceptAll);
+			}
+			else if (skippedGrid || castAgainstDrawnTree)
+			{
+				CastPacket(
+					physicsWorld,
+					[skippedGrid, castAgainstDrawnTree, drawnTransforms](const Physics::FixtureChild& child) {
+						const b2Body& body = *child.fixture->GetBody();
+
+						// Only static bodies go in the grid, and only ones that move get drawn 
+						// somewhere else, so neither needs looking up for the others.
+						if (body.GetType() == b2_staticBody)
+						{
+							return !skippedGrid || !skippedGrid->Contains(body);
+						}
+
+						return !castAgainstDrawnTree || 
+							&GetDrawnTransform(body, drawnTransforms) == &body.GetTransform(); });
+			}
+			else
+			{
+				CastPacket(physicsWorld, AcceptAll);
+			}
+
+			if (castAgainstDrawnTree)
+			{
+				CastPacket(m_DrawnTree, AcceptAll);
+			}
+
+			// Last, so that whatever's in front of them has clipped the rays already.
+			for (int ray = 0; ray < rayCount; ++ray)
+			{
+				auto BillboardHit = [&](const int index, const float32 fraction)
+				{
+					const b2Vec2 point = cameraPosition + fraction * (rayEnds[ray] - cameraPosition);
+
+					// Like an edge, there's no inside, so the ray comes out where it went in.
+					const Physics::RayCastHit hit{
+						nullptr, 0, point, -cameraForwards, fraction, point, fraction };
+
+					return callbacks[ray].AddHit(billboards.GetRenderData(index), hit);
+				};
+
+				billboards.RayCast(
+					BillboardHit, 
+					cameraPosition, 
+					rayEnds[ray], 
+					cameraForwards, 
+					collections[ray].m_MaxFraction);
+			}
+
+			for (int ray = 0; ray < rayCount; ++ray)
+			{
+				IntersectionCollection& collection = collections[ray];
+
+				ProcessIntersections(collection);
+
+				m_View->m_Columns[collection.m_Index].m_RayEnd = 
+					cameraPosition + collection.m_MaxFraction * (rayEnds[ray] - cameraPosition);
+
+				auto& drawables = m_View->m_Columns[collection.m_Index].m_Drawables;
+
+				drawables.clear();
+
+				collection.m_Spans.Clear();
+
+				for (const int intersection : collection.m_BackToFront)
+				{
+					AddSpans(collection, intersection);
+				}
+
+				collection.m_Spans.CalculateExtents(cameraPosition, cameraForwards, attributes.m_Base);
+
+				for (int span = 0; span < collection.m_Spans.GetCount(); span++)
+				{
+					drawables.push_back(CreateDrawable(collection, span));
+				}
+
+				SortBackToFront(drawables.data(), drawables.data() + drawables.size());
+			}
+		}
+	};
+
+	for (RaycastCallback& callback : m_RaycastCallbacks)
+	{
+		callback.m_Camera = &camera;
+		callback.m_Attributes = &m_RenderAttributes;
+		callback.m_TargetHeight = (float)targetSize.y;
+	}
+
+	const int columnsPerChunk = 16;
+
+	m_WorkerPool->ParallelFor((int)m_ColumnsToCast.size(), columnsPerChunk, ProcessColumns);
+
+	m_Stats.m_ColumnsCast += (int)m_ColumnsToCast.size();
+
+	if (m_ColumnsToInterpolate.empty()) return;
+
+	// Anything that can't be filled in gets cast after all.
+	m_ColumnsToCast.clear();
+
+	// The columns to interpolate are in order, so each gap only gets checked once.
+	int gapLeft = -1;
+	bool gapInterpolated = false;
+
+	for (const int column : m_ColumnsToInterpolate)
+	{
+		const int left = column - (column % stride);
+		const int right = std::min(left + stride, (int)targetWidth - 1);
+
+		if (left != gapLeft)
+		{
+			gapLeft = left;
+			gapInterpolated = CanInterpolateBetween(scene, cameraPosition, left, right);
+		}
+
+		if (gapInterpolated)
+		{
+			InterpolateColumn(column, left, right);
+		}
+		else
+		{
+			m_ColumnsToCast.push_back(column);
+		}
+	}
+
+	m_Stats.m_ColumnsInterpolated += (int)(m_ColumnsToInterpolate.size() - m_ColumnsToCast.size());
+
+	m_WorkerPool->ParallelFor((int)m_ColumnsToCast.size(), columnsPerChunk, ProcessColumns);
+
+	m_Stats.m_ColumnsCast += (int)m_ColumnsToCast.size();
+}
+
+namespace {
+
+bool IsSameFace(const RaycastDrawable& a, const RaycastDrawable& b)
+{
+	return
+		a.m_RenderData == b.m_RenderData &&
+		a.m_Texture == b.m_Texture &&
+		a.m_Normal == b.m_Normal &&
+		a.m_BlendColor == b.m_BlendColor &&
+		a.m_VTop == b.m_VTop &&
+		a.m_VBottom == b.m_VBottom &&
+		a.m_DrawFront == b.m_DrawFront &&
+		a.m_DrawTop == b.m_DrawTop &&
+		a.m_DrawBottom == b.m_DrawBottom &&
+		a.m_DistanceNear > 0.0f && b.m_DistanceNear > 0.0f &&
+		a.m_DistanceFar > 0.0f && b.m_DistanceFar > 0.0f;
+}
+
+}
+
+bool WorldRaycastRendererImpl::CanInterpolateBetween(
+	const RaycastScene& scene,
+	const b2Vec2& cameraPosition,
+	const int left,
+	const int right)
+{
+	const Column& leftColumn = m_View->m_Columns[left];
+	const Column& rightColumn = m_View->m_Columns[right];
+
+	const auto& leftDrawables = leftColumn.m_Drawables;
+	const auto& rightDrawables = rightColumn.m_Drawables;
+
+	if (leftDrawables.size() != rightDrawables.size()) return false;
+
+	for (unsigned index = 0; index < leftDrawables.size(); index++)
+	{
+		if (!IsSameFace(leftDrawables[index], rightDrawables[index])) return false;
+	}
+
+	// Fixtures are convex, so the rays in between hit the same faces as the rays either side.
+	// Anything else in the wedge between those rays, like a pillar thinner than the gap, 
+	// would be missed, so then they have to be cast.
+	const b2Vec2 leftRay = leftColumn.m_RayEnd - cameraPosition;
+	const b2Vec2 rightRay = rightColumn.m_RayEnd - cameraPosition;
+
+	const float32 leftLength = leftRay.Length();
+	const float32 rightLength = rightRay.Length();
+	const float32 cross = b2Abs(b2Cross(leftRay, rightRay));
+
+	// Too thin to make a triangle of.
+	if (cross <= b2_linearSlop * leftLength || cross <= b2_linearSlop * rightLength) return false;
+
+	// The rays in between stop somewhere along the line between where these two stopped,
+	// or, if they weren't cut short, on the arc between them. Pushing the far corners out 
+	// by 1 / cos(half the angle between the rays) covers both.
+	const float32 cosine = b2Dot(leftRay, rightRay) / (leftLength * rightLength);
+
+	if (cosine <= 0.0f) return false;
+
+	const float32 scale = 1.0f / std::sqrt(0.5f * (1.0f + cosine));
+
+	const b2Vec2 vertices[3] = {
+		cameraPosition,
+		cameraPosition + scale * leftRay,
+		cameraPosition + scale * rightRay };
+
+	b2PolygonShape wedge;
+	wedge.Set(vertices, 3);
+
+	b2AABB wedgeAABB;
+	wedge.ComputeAABB(&wedgeAABB, b2Transform(b2Vec2_zero, b2Rot(0.0f)), 0);
+
+	// What the rays either side hit is allowed to be there.
+	m_GapRenderData.clear();
+
+	for (const Drawable& drawable : leftDrawables)
+	{
+		m_GapRenderData.push_back(drawable.m_RenderData);
+	}
+
+	std::sort(m_GapRenderData.begin(), m_GapRenderData.end());
+
+	auto IsAllowed = [this](const FixtureRenderData* renderData)
+	{
+		return std::binary_search(m_GapRenderData.begin(), m_GapRenderData.end(), renderData);
+	};
+
+	struct WedgeQueryCallback : public b2QueryCallback
+	{
+		bool ReportFixture(b2Fixture* fixture) override
+		{
+			const auto renderData = (const FixtureRenderData*)fixture->GetUserData();
+
+			// Invisible, or one of the allowed ones.
+			if (renderData == nullptr || (*isAllowed)(renderData)) return true;
+
+			for (int32 childIndex = 0; childIndex < fixture->GetShape()->GetChildCount(); childIndex++)
+			{
+				if (b2TestOverlap(
+					fixture->GetShape(), 
+					childIndex, 
+					wedge, 
+					0, 
+					GetDrawnTransform(*fixture->GetBody(), drawnTransforms), 
+					b2Transform(b2Vec2_zero, b2Rot(0.0f))))
+				{
+					found = true;
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		const b2PolygonShape* wedge;
+		const decltype(IsAllowed)* isAllowed;
+		const std::vector<DrawnTransform>* drawnTransforms;
+		bool found = false;
+	};
+
+	WedgeQueryCallback fixtureCallback;
+	fixtureCallback.wedge = &wedge;
+	fixtureCallback.isAllowed = &IsAllowed;
+	fixtureCallback.drawnTransforms = scene.m_DrawnTransforms;
+
+	scene.m_PhysicsWorld->QueryAABB(&fixtureCallback, wedgeAABB);
+
+	if (fixtureCallback.found) return false;
+
+	// Billboards turn to face the camera, so the circle they turn in stands in for them.
+	const BillboardStore& billboards = *scene.m_Billboards;
+
+	bool billboardFound = false;
+
+	auto BillboardCallback = [&](const int index)
+	{
+		if (IsAllowed(&billboards.GetRenderData(index))) return true;
+
+		b2CircleShape circle;
+		circle.m_radius = billboards.GetRadius(index);
+
+		billboardFound = b2TestOverlap(
+			&circle, 
+			0, 
+			&wedge, 
+			0, 
+			b2Transform(billboards.GetPosition(index), b2Rot(0.0f)), 
+			b2Transform(b2Vec2_zero, b2Rot(0.0f)));
+
+		return !billboardFound;
+	};
+
+	billboards.Query(BillboardCallback, wedgeAABB);
+
+	return !billboardFound;
+}
+
+void WorldRaycastRendererImpl::InterpolateColumn(const int column, const int left, const int right)
+{
+	const auto& leftDrawables = m_View->m_Columns[left].m_Drawables;
+	const auto& rightDrawables = m_View->m_Columns[right].m_Drawables;
+
+	auto& drawables = m_View->m_Columns[column].m_Drawables;
+
+	drawables = leftDrawables;
+
+	const float t = (float)(column - left) / (float)(right - left);
+
+	auto Lerp = [t](const float a, const float b) { return a + (b - a) * t; };
+
+	for (unsigned index = 0; index < leftDrawables.size(); index++)
+	{
+		const Drawable& l = leftDrawables[index];
+		const Drawable& r = rightDrawables[index];
+
+		Drawable& drawable = drawables[index];
+
+		// Screen-space positions change linearly across a flat face, but distances and 
+		// texture coordinates need perspective correction.
+		const float inverseDistanceNear = Lerp(1.0f / l.m_DistanceNear, 1.0f / r.m_DistanceNear);
+
+		drawable.m_X = (float)column;
+		drawable.m_Top = Lerp(l.m_Top, r.m_Top);
+		drawable.m_Bottom = Lerp(l.m_Bottom, r.m_Bottom);
+		drawable.m_FarY = Lerp(l.m_FarY, r.m_FarY);
+		drawable.m_DistanceNear = 1.0f / inverseDistanceNear;
+		drawable.m_DistanceFar = 1.0f / Lerp(1.0f / l.m_DistanceFar, 1.0f / r.m_DistanceFar);
+		drawable.m_U = 
+			Lerp(l.m_U / l.m_DistanceNear, r.m_U / r.m_DistanceNear) / inverseDistanceNear;
+	}
+}
+
+void WorldRaycastRendererImpl::Render(
+	const RaycastScene& scene, 
+	const Camera3D & camera, 
+	const RenderSettings& settings, 
+	sf::RenderTarget & target)
+{
+	BeginFrame(scene, { &camera }, settings);
+
+	m_View = &m_Views[0];
+
+	RenderView(scene, camera, settings, target);
+}
+
+void WorldRaycastRendererImpl::Render(
+	const RaycastScene& scene, 
+	const gsl::span<const RaycastView> views,
+	const RenderSettings& settings)
+{
+	if (views.empty()) return;
+
+	std::vector<const Camera3D*> cameras;
+
+	for (const RaycastView& view : views)
+	{
+		cameras.push_back(view.m_Camera);
+	}
+
+	BeginFrame(scene, cameras, settings);
+
+	for (int index = 0; index < (int)views.size(); index++)
+	{
+		const RaycastView& view = views[index];
+
+		m_View = &m_Views[index];
+
+		RenderView(scene, *view.m_Camera, settings, *view.m_Target);
+	}
+}
+
+void WorldRaycastRendererImpl::RenderView(
+	const RaycastScene& scene, 
+	const Camera3D & camera, 
+	const RenderSettings& settings, 
+	sf::RenderTarget & target)
+{
+	CastColumns(scene, camera, settings, target.getSize());
+
+	BuildColumnDepthBuffer(camera, (float)target.getSize().y);
+
+	if (settings.m_UseSoftwareRasterizer)
+	{
+		const sf::Vector2u targetSize = target.getSize();
+
+		if (m_SoftwareFramebuffer.GetWidth() != (int)targetSize.x ||
+			m_SoftwareFramebuffer.GetHeight() != (int)targetSize.y)
+		{
+			m_SoftwareFramebuffer.Resize(targetSize.x, targetSize.y);
+			m_SoftwareFramebufferTexture.create(targetSize.x, targetSize.y);
+		}
+		else
+		{
+			m_SoftwareFramebuffer.Clear();
+		}
+
+		Rasterize(scene, m_SoftwareFramebuffer);
+
+		m_SoftwareFramebufferTexture.update(m_SoftwareFramebuffer.GetPixels());
+
+		// The framebuffer is premultiplied.
+		target.draw(
+			sf::Sprite(m_SoftwareFramebufferTexture),
+			sf::RenderStates(sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha)));
+
+		m_Stats.m_DrawCalls += 1;
+		m_Stats.m_TextureChanges += 1;
+
+		return;
+	}
+
+	// Without a depth buffer to draw into, it has to be the painter's algorithm.
+	const bool depthBuffer = settings.m_UseDepthBuffer && []()
+	{
+		GLint depthBits = 0;
+		glCheck(glGetIntegerv(GL_DEPTH_BITS, &depthBits));
+		return depthBits > 0;
+	}();
+
+	const TextureAtlas* atlas = scene.m_Atlas;
+
+	BuildLayers(
+		settings.m_MergeFrontFaces, 
+		settings.m_FarFieldDistance > 0.0f ? settings.m_FarFieldDistance : std::numeric_limits<float>::max(),
+		(settings.m_UseTextureAtlas && atlas && !atlas->IsEmpty()) ? atlas : nullptr);
+
+	BuildBatches(depthBuffer);
+
+	class Drawer {
+	public:
+		Drawer(
+			sf::RenderTarget& target, 
+			sf::Shader& shader, 
+			sf::Shader& quadShader, 
+			const RaycastScene& scene, 
+			const std::vector<Vertex>& vertices,
+			const bool depthBuffer,
+			RaycastRenderStats& stats)
+			: m_Target(target)
+			, m_Shaders{ &shader, &quadShader }
+			, m_DepthBuffer(depthBuffer)
+			, m_Stats(stats)
+		{
+			m_DefaultTexture.create(1, 1);
+			// Make it white.
+			{
+				auto c = sf::Color::White;
+				m_DefaultTexture.update(&c.r);
+			}
+
+			for (sf::Shader* s : { &shader, &quadShader })
+			{
+				sf::Shader::bind(s);
+				s->setUniform("ambientLightColor", sf::Glsl::Vec4(scene.m_AmbientLight->mColor));
+
+				s->setUniform("directionalLightDirection", B2VecToSFVec(scene.m_DirectionalLight->GetDirection()));
+				s->setUniform("directionalLightColor", sf::Glsl::Vec4(scene.m_DirectionalLight->GetColor()));
+
+				s->setUniform("fogColor", sf::Glsl::Vec4(scene.m_Fog->GetColor()));
+				s->setUniform("fogMaxIntensity", scene.m_Fog->GetMaxIntensity());
+				s->setUniform("fogMaxDistance", scene.m_Fog->GetMaxDistance());
+				s->setUniform("fogMinDistance", scene.m_Fog->GetMinDistance());
+
+				s->setUniform("texture", sf::Shader::CurrentTexture);
+
+				s->setUniform("alphaThreshold", 0.0f);
+			}
+
+			if (m_DepthBuffer)
+			{
+				glCheck(glDepthMask(GL_TRUE));
+				glCheck(glClear(GL_DEPTH_BUFFER_BIT));
+				glCheck(glEnable(GL_DEPTH_TEST));
+				glCheck(glDepthFunc(GL_LEQUAL));
+				glCheck(glDepthMask(GL_FALSE));
+			}
+
+			glCheck(glEnableClientState(GL_VERTEX_ARRAY));
+			glCheck(glEnableClientState(GL_COLOR_ARRAY));
+			glCheck(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+			glCheck(glEnableClientState(GL_NORMAL_ARRAY));
+
+			// Every batch's vertices live in the one array, so it only needs pointing at once.
+			if (!vertices.empty())
+			{
+				glCheck(glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &vertices[0].position));
+				glCheck(glNormalPointer(GL_FLOAT, sizeof(Vertex), &vertices[0].normal));
+				glCheck(glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &vertices[0].color));
+				glCheck(glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &vertices[0].texCoords));
+			}
+		}
+
+		void operator()(const Batch& batch) {
+			if (batch.m_Opaque != m_LastOpaque)
+			{
+				m_LastOpaque = batch.m_Opaque;
+
+				// Texels that would have been mostly see-through can't go in the depth buffer.
+				for (sf::Shader* s : m_Shaders)
+				{
+					s->setUniform("alphaThreshold", batch.m_Opaque ? 0.5f : 0.0f);
+				}
+
+				glCheck(glDepthMask(batch.m_Opaque ? GL_TRUE : GL_FALSE));
+			}
+
+			if (batch.m_Shader != m_LastShader)
+			{
+				m_LastShader = batch.m_Shader;
+
+				sf::Shader::bind(batch.m_Shader);
+
+				m_Stats.m_ShaderChanges++;
+			}
+
+			if (batch.m_Texture != m_LastTexture || !m_TextureBound)
+			{
+				m_LastTexture = batch.m_Texture;
+				m_TextureBound = true;
+
+				sf::Texture::bind(
+					batch.m_Texture ? batch.m_Texture : &m_DefaultTexture,
+					sf::Texture::CoordinateType::Pixels);
+
+				m_Stats.m_TextureChanges++;
+			}
+
+			glCheck(glDrawArrays(batch.m_Primitive, batch.m_First, batch.m_Count));
+
+			m_Stats.m_DrawCalls++;
+		}
+
+		~Drawer()
+		{
+			glCheck(glDisableClientState(GL_VERTEX_ARRAY));
+			glCheck(glDisableClientState(GL_COLOR_ARRAY));
+			glCheck(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+			glCheck(glDisableClientState(GL_NORMAL_ARRAY));
+
+			if (m_DepthBuffer)
+			{
+				glCheck(glDepthMask(GL_TRUE));
+				glCheck(glDisable(GL_DEPTH_TEST));
+			}
+
+			m_Target.resetGLStates();
+		}
+
+	private:
+		sf::RenderTarget& m_Target;
+
+		std::array<sf::Shader*, 2> m_Shaders;
+
+		const bool m_DepthBuffer;
+
+		RaycastRenderStats& m_Stats;
+
+		bool m_LastOpaque = false;
+
+		const sf::Shader* m_LastShader = nullptr;
+		const sf::Texture* m_LastTexture = nullptr;
+		bool m_TextureBound = false;
+
+		// Flat white, like a coffee.
+		sf::Texture m_DefaultTexture;
+	};
+
+	Drawer drawer(target, mShader, mQuadShader, scene, m_Vertices, depthBuffer, m_Stats);
+
+	std::for_each(m_Batches.begin(), m_Batches.end(), std::ref(drawer));
+}
+
+void WorldRaycastRendererImpl::Render(
+	const RaycastScene& scene, 
+	const Camera3D & camera, 
+	const RenderSettings& settings, 
+	SoftwareFramebuffer& target)
+{
+	BeginFrame(scene, { &camera }, settings);
+
+	m_View = &m_Views[0];
+
+	CastColumns(scene, camera, settings, sf::Vector2u(target.GetWidth(), target.GetHeight()));
+
+	BuildColumnDepthBuffer(camera, (float)target.GetHeight());
+
+	Rasterize(scene, target);
+}
+
+void WorldRaycastRendererImpl::BuildColumnDepthBuffer(
+	const Camera3D& camera, 
+	const float targetHeight)
+{
+	ColumnDepthBuffer& depthBuffer = m_View->m_ColumnDepthBuffer;
+
+	if (depthBuffer.GetWidth() != (int)m_View->m_Columns.size())
+	{
+		depthBuffer.Resize((int)m_View->m_Columns.size());
+	}
+
+	depthBuffer.SetHorizon(
+		(targetHeight / 2.0f) + (float)GetPitchOffsetInPixels(camera, (int)targetHeight));
+
+	for (int column = 0; column < (int)m_View->m_Columns.size(); column++)
+	{
+		const auto& drawables = m_View->m_Columns[column].m_Drawables;
+
+		// They're back to front, so the last opaque one is the nearest.
+		const auto nearest = std::find_if(
+			drawables.rbegin(), 
+			drawables.rend(), 
+			[](const Drawable& drawable) {
+				return drawable.m_RenderData->IsOpaque() && drawable.m_DistanceNear > 0.0f; });
+
+		if (nearest == drawables.rend())
+		{
+			depthBuffer.SetDepth(column, std::numeric_limits<float>::max(), 0.0f, 0.0f);
+		}
+		else
+		{
+			depthBuffer.SetDepth(column, nearest->m_DistanceNear, nearest->m_Top, nearest->m_Bottom);
+		}
+	}
+}
+
+void WorldRaycastRendererImpl::CacheSoftwareTextures()
+{
+	for (const auto& collection : m_View->m_Columns)
+	{
+		for (const Drawable& drawable : collection.m_Drawables)
+		{
+			const sf::Texture* texture = drawable.m_Texture;
+
+			if (!texture) continue;
+
+			// The TextureLibrary keeps the pixels of what it loads, so there's no need to 
+			// read them back from OpenGL.
+			const FixtureRenderData& renderData = *drawable.m_RenderData;
+
+			const sf::Image* image = nullptr;
+
+			for (int lod = 0; lod <= renderData.GetTextureLodCount(); lod++)
+			{
+				if (renderData.GetTexture(lod) == texture)
+				{
+					image = renderData.GetImage(lod);
+					break;
+				}
+			}
+
+			auto it = m_SoftwareTextureCache.find(texture);
+
+			// A different texture might have been created where an old one was.
+			if (it != m_SoftwareTextureCache.end() && it->second == image) continue;
+
+			// Without an image, it's drawn flat white.
+			if (!image)
+			{
+				m_SoftwareTextureCache.erase(texture);
+				m_SoftwareRasterizer.RemoveTexture(texture);
+				continue;
+			}
+
+			m_SoftwareTextureCache[texture] = image;
+
+			m_SoftwareRasterizer.SetTexture(
+				texture,
+				SoftwareTexture{
+					image->getPixelsPtr(),
+					(int)image->getSize().x,
+					(int)image->getSize().y });
+		}
+	}
+}
+
+void WorldRaycastRendererImpl::Rasterize(const RaycastScene& scene, SoftwareFramebuffer& target)
+{
+	RaycastShading shading;
+	shading.m_AmbientLightColor = scene.m_AmbientLight->mColor;
+	shading.m_DirectionalLightDirection = B2VecToSFVec(scene.m_DirectionalLight->GetDirection());
+	shading.m_DirectionalLightColor = scene.m_DirectionalLight->GetColor();
+	shading.m_FogColor = scene.m_Fog->GetColor();
+	shading.m_FogMaxIntensity = scene.m_Fog->GetMaxIntensity();
+	shading.m_FogMaxDistance = scene.m_Fog->GetMaxDistance();
+	shading.m_FogMinDistance = scene.m_Fog->GetMinDistance();
+
+	m_SoftwareRasterizer.SetShading(shading);
+
+	CacheSoftwareTextures();
+
+	const int columnCount = std::min(target.GetWidth(), (int)m_View->m_Columns.size());
+
+	// Each worker gets a strip of neighbouring columns at a time.
+	const int columnsPerStrip = 32;
+
+	m_WorkerPool->ParallelFor(
+		columnCount,
+		columnsPerStrip,
+		[this, &target](const int begin, const int end, const int)
+		{
+			for (int column = begin; column < end; column++)
+			{
+				const auto& drawables = m_View->m_Columns[column].m_Drawables;
+
+				m_SoftwareRasterizer.RasterizeColumn(
+					target,
+					drawables.data(),
+					drawables.data() + drawables.size());
+			}
+		});
+
+	for (const auto& collection : m_View->m_Columns)
+	{
+		for (const Drawable& drawable : collection.m_Drawables)
+		{
+			m_Stats.m_PrimitiveCount += 
+				(int)drawable.m_DrawFront + (int)drawable.m_DrawTop + (int)drawable.m_DrawBottom;
+		}
+	}
+}
+
+void WorldRaycastRendererImpl::BuildDynamicTree(
+	const b2World& physicsWorld, 
+	const Physics::StaticGeometryGrid* grid,
+	const std::vector<DrawnTransform>* drawnTransforms,
+	const std::vector<ViewTriangle>& views,
+	const std::vector<Physics::FixtureChild>* staticFixtures)
+{
+	for (const int32 proxyId : m_DynamicTreeProxies)
+	{
+		m_DynamicTree.DestroyProxy(proxyId);
+	}
+
+	m_DynamicTreeProxies.clear();
+	m_DynamicTreeFixtures.clear();
+
+	auto InAnyView = [&views](const b2AABB& aabb)
+	{
+		return std::any_of(views.begin(), views.end(), [&aabb](const ViewTriangle& view) {
+			return b2TestOverlap(aabb, view.GetAABB()) && view.Overlaps(aabb); });
+	};
+
+	// Those are in m_DrawnTree.
+	auto IsDrawnElsewhere = [drawnTransforms](const b2Body& body)
+	{
+		return &GetDrawnTransform(body, drawnTransforms) != &body.GetTransform();
+	};
+
+	if (!views.empty())
+	{
+		const b2BroadPhase& broadPhase = physicsWorld.GetContactManager().m_broadPhase;
+
+		struct ViewQueryCallback
+		{
+			bool QueryCallback(const int32 proxyId)
+			{
+				if (!(*inAnyView)(broadPhase->GetFatAABB(proxyId))) return true;
+
+				const auto proxy = (const b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+
+				(*inViewCount)++;
+
+				if (proxy->fixture->GetUserData() == nullptr) return true;
+
+				if (grid && grid->Contains(*proxy->fixture->GetBody())) return true;
+
+				if ((*isDrawnElsewhere)(*proxy->fixture->GetBody())) return true;
+
+				fixtures->push_back(Physics::FixtureChild{ proxy->fixture, proxy->childIndex });
+
+				return true;
+			}
+
+			const b2BroadPhase* broadPhase;
+			const decltype(InAnyView)* inAnyView;
+			const decltype(IsDrawnElsewhere)* isDrawnElsewhere;
+			const Physics::StaticGeometryGrid* grid;
+			std::vector<Physics::FixtureChild>* fixtures;
+			int* inViewCount;
+		};
+
+		int inViewCount = 0;
+
+		ViewQueryCallback callback{ 
+			&broadPhase, &InAnyView, &IsDrawnElsewhere, grid, &m_DynamicTreeFixtures, &inViewCount };
+
+		b2AABB queryAABB = views.front().GetAABB();
+
+		for (const ViewTriangle& view : views)
+		{
+			queryAABB.Combine(view.GetAABB());
+		}
+
+		broadPhase.Query(&callback, queryAABB);
+
+		m_Stats.m_FixturesInView = inViewCount;
+		m_Stats.m_FixturesCulled = broadPhase.GetProxyCount() - inViewCount;
+	}
+	else
+	{
+		for (const b2Body* body = physicsWorld.GetBodyList(); body; body = body->GetNext())
+		{
+			if (grid && grid->Contains(*body)) continue;
+
+			if (IsDrawnElsewhere(*body)) continue;
+
+			for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+			{
+				if (fixture->GetUserData() == nullptr) continue;
+
+				for (int32 childIndex = 0; childIndex < fixture->GetShape()->GetChildCount(); childIndex++)
+				{
+					m_DynamicTreeFixtures.push_back(Physics::FixtureChild{ fixture, childIndex });
+				}
+			}
+		}
+	}
+
+	if (staticFixtures)
+	{
+		for (const Physics::FixtureChild& child : *staticFixtures)
+		{
+			if (child.fixture->GetUserData() == nullptr) continue;
+
+			if (!views.empty())
+			{
+				b2AABB aabb;
+				child.fixture->GetShape()->ComputeAABB(
+					&aabb, 
+					child.fixture->GetBody()->GetTransform(), 
+					child.childIndex);
+
+				if (!InAnyView(aabb)) continue;
+			}
+
+			m_DynamicTreeFixtures.push_back(child);
+		}
+	}
+
+	// The proxies point into m_DynamicTreeFixtures, so wait until it's done growing.
+	for (Physics::FixtureChild& child : m_DynamicTreeFixtures)
+	{
+		b2AABB aabb;
+		child.fixture->GetShape()->ComputeAABB(&aabb, child.fixture->GetBody()->GetTransform(), child.childIndex);
+
+		m_DynamicTreeProxies.push_back(m_DynamicTree.CreateProxy(aabb, &child));
+	}
+}
+
+void WorldRaycastRendererImpl::BuildDrawnTree(const std::vector<DrawnTransform>& drawnTransforms)
+{
+	for (const int32 proxyId : m_DrawnTreeProxies)
+	{
+		m_DrawnTree.tree.DestroyProxy(proxyId);
+	}
+
+	m_DrawnTreeProxies.clear();
+	m_DrawnTreeFixtures.clear();
+
+	for (const DrawnTransform& drawn : drawnTransforms)
+	{
+		for (const b2Fixture* fixture = drawn.m_Body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+		{
+			if (fixture->GetUserData() == nullptr) continue;
+
+			for (int32 childIndex = 0; childIndex < fixture->GetShape()->GetChildCount(); childIndex++)
+			{
+				m_DrawnTreeFixtures.push_back(
+					Physics::TransformedFixtureChild{ { fixture, childIndex }, drawn.m_Transform });
+			}
+		}
+	}
+
+	// The proxies point into m_DrawnTreeFixtures, so wait until it's done growing.
+	for (Physics::TransformedFixtureChild& drawn : m_DrawnTreeFixtures)
+	{
+		b2AABB aabb;
+		drawn.child.fixture->GetShape()->ComputeAABB(&aabb, drawn.transform, drawn.child.childIndex);
+
+		m_DrawnTreeProxies.push_back(m_DrawnTree.tree.CreateProxy(aabb, &drawn));
+	}
+}
+
+void WorldRaycastRendererImpl::BuildPotentiallyVisibleTree(
+	const std::vector<Physics::FixtureChild>& fixtures, 
+	const BodyChanges* changes)
+{
+	auto SameChild = [](const Physics::FixtureChild& a, const Physics::FixtureChild& b) {
+		return a.fixture == b.fixture && a.childIndex == b.childIndex; };
+
+	// Without BodyChanges there's no telling whether anything has moved.
+	const bool unchanged =
+		changes &&
+		changes->m_Revision == m_PotentiallyVisibleRevision &&
+		!m_PotentiallyVisibleProxies.empty() &&
+		std::equal(
+			fixtures.begin(), fixtures.end(), 
+			m_PotentiallyVisibleFixtures.begin(), m_PotentiallyVisibleFixtures.end(), 
+			SameChild);
+
+	if (unchanged) return;
+
+	for (const int32 proxyId : m_PotentiallyVisibleProxies)
+	{
+		m_PotentiallyVisibleTree.DestroyProxy(proxyId);
+	}
+
+	m_PotentiallyVisibleProxies.clear();
+
+	m_PotentiallyVisibleFixtures = fixtures;
+	m_PotentiallyVisibleRevision = changes ? changes->m_Revision : 0;
+
+	// The proxies point into m_PotentiallyVisibleFixtures, which is done growing.
+	for (Physics::FixtureChild& child : m_PotentiallyVisibleFixtures)
+	{
+		if (child.fixture->GetUserData() == nullptr) continue;
+
+		b2AABB aabb;
+		child.fixture->GetShape()->ComputeAABB(&aabb, child.fixture->GetBody()->GetTransform(), child.childIndex);
+
+		m_PotentiallyVisibleProxies.push_back(m_PotentiallyVisibleTree.CreateProxy(aabb, &child));
+	}
+}
+
+void WorldRaycastRendererImpl::BuildLayers(
+	const bool mergeFrontFaces, 
+	const float farFieldDistance, 
+	const TextureAtlas* atlas)
+{
+	for (Layer& layer : m_Layers)
+	{
+		layer.m_Drawables.clear();
+		layer.m_FrontQuads.clear();
+	}
+
+	m_LayerCount = 0;
+
+	for (const auto& collection : m_View->m_Columns)
+	{
+		const int drawableCount = (int)collection.m_Drawables.size();
+
+		if (drawableCount > (int)m_Layers.size())
+		{
+			m_Layers.resize(drawableCount);
+		}
+
+		m_LayerCount = std::max(m_LayerCount, drawableCount);
+
+		for (int index = 0; index < drawableCount; index++)
+		{
+			m_Layers[drawableCount - 1 - index].m_Drawables.push_back(collection.m_Drawables[index]);
+
+			if (!atlas) continue;
+
+			Drawable& drawable = m_Layers[drawableCount - 1 - index].m_Drawables.back();
+
+			const TextureAtlas::Location* location = atlas->Find(drawable.m_Texture);
+
+			if (!location)
+			{
+				m_Stats.m_DrawablesOutsideAtlas++;
+				continue;
+			}
+
+			drawable.m_Texture = location->m_Page;
+			drawable.m_UOrigin = location->m_Origin.x;
+			drawable.m_VOrigin = location->m_Origin.y;
+			drawable.m_U += location->m_Origin.x;
+			drawable.m_VTop += location->m_Origin.y;
+			drawable.m_VBottom += location->m_Origin.y;
+		}
+	}
+
+	if (!mergeFrontFaces) return;
+
+	for (int layerIndex = 0; layerIndex < m_LayerCount; layerIndex++)
+	{
+		MergeFrontFaces(m_Layers[layerIndex].m_Drawables, m_Layers[layerIndex].m_FrontQuads, farFieldDistance);
+	}
+}
+
+void WorldRaycastRendererImpl::BuildBatches(const bool depthBuffer)
+{
+	m_Vertices.clear();
+	m_Batches.clear();
+
+	auto CompareTextures = [](const sf::Texture* a, const sf::Texture* b)
+	{
+		return std::less<const sf::Texture*>()(a, b);
+	};
+
+	// See-through texels get thrown away rather than blended in the opaque pass, so only the
+	// blend colour decides which pass something goes in.
+	auto IsOpaque = [depthBuffer](const sf::Color& blendColor)
+	{
+		return depthBuffer && blendColor.a == 255;
+	};
+
+	if (depthBuffer)
+	{
+		m_OpaqueDrawables.clear();
+		m_OpaqueQuads.clear();
+
+		for (int layerIndex = 0; layerIndex < m_LayerCount; layerIndex++)
+		{
+			for (const Drawable& drawable : m_Layers[layerIndex].m_Drawables)
+			{
+				if (IsOpaque(drawable.m_BlendColor)) m_OpaqueDrawables.push_back(&drawable);
+			}
+
+			for (const FrontQuad& quad : m_Layers[layerIndex].m_FrontQuads)
+			{
+				if (IsOpaque(quad.m_BlendColor)) m_OpaqueQuads.push_back(&quad);
+			}
+		}
+
+		// The depth test takes care of the order, so they only need to be front to back 
+		// within each texture to keep overdraw down.
+		std::sort(
+			m_OpaqueDrawables.begin(),
+			m_OpaqueDrawables.end(),
+			[&CompareTextures](const Drawable* a, const Drawable* b)
+			{
+				if (a->m_Texture != b->m_Texture) return CompareTextures(a->m_Texture, b->m_Texture);
+				return a->m_DistanceNear < b->m_DistanceNear;
+			});
+
+		std::sort(
+			m_OpaqueQuads.begin(),
+			m_OpaqueQuads.end(),
+			[&CompareTextures](const FrontQuad* a, const FrontQuad* b)
+			{
+				if (a->m_Texture != b->m_Texture) return CompareTextures(a->m_Texture, b->m_Texture);
+				return std::min(a->m_DistanceLeft, a->m_DistanceRight) < std::min(b->m_DistanceLeft, b->m_DistanceRight);
+			});
+
+		for (const Drawable* drawable : m_OpaqueDrawables)
+		{
+			AddLines(*drawable, true);
+		}
+
+		for (const FrontQuad* quad : m_OpaqueQuads)
+		{
+			AddQuad(*quad, true);
+		}
+	}
+
+	// Back layer first.
+	for (int layerIndex = m_LayerCount - 1; layerIndex >= 0; layerIndex--)
+	{
+		Layer& layer = m_Layers[layerIndex];
+
+		// No two drawables in a layer are in the same column, so they can be drawn in any 
+		// order. Grouping them by texture keeps the number of batches down.
+		std::sort(
+			layer.m_Drawables.begin(),
+			layer.m_Drawables.end(),
+			[&CompareTextures](const Drawable& a, const Drawable& b)
+			{
+				return CompareTextures(a.m_Texture, b.m_Texture);
+			});
+
+		std::sort(
+			layer.m_FrontQuads.begin(),
+			layer.m_FrontQuads.end(),
+			[&CompareTextures](const FrontQuad& a, const FrontQuad& b)
+			{
+				return CompareTextures(a.m_Texture, b.m_Texture);
+			});
+
+		for (const Drawable& drawable : layer.m_Drawables)
+		{
+			if (!IsOpaque(drawable.m_BlendColor)) AddLines(drawable, false);
+		}
+
+		for (const FrontQuad& quad : layer.m_FrontQuads)
+		{
+			if (!IsOpaque(quad.m_BlendColor)) AddQuad(quad, false);
+		}
+	}
+
+	m_Stats.m_VertexCount += (int)m_Vertices.size();
+	m_Stats.m_BatchCount += (int)m_Batches.size();
+}
+
+void WorldRaycastRendererImpl::BeginBatch(
+	sf::Shader& shader, 
+	const sf::Texture* texture, 
+	const GLenum primitive,
+	const bool opaque)
+{
+	if (!m_Batches.empty())
+	{
+		const Batch& last = m_Batches.back();
+
+		if (last.m_Shader == &shader && 
+			last.m_Texture == texture && 
+			last.m_Primitive == primitive &&
+			last.m_Opaque == opaque)
+		{
+			return;
+		}
+	}
+
+	m_Batches.push_back(Batch{ &shader, texture, primitive, opaque, (GLint)m_Vertices.size(), 0 });
+}
+
+void WorldRaycastRendererImpl::AddLines(const Drawable& drawable, const bool opaque)
+{
+	if (!drawable.m_DrawFront && !drawable.m_DrawTop && !drawable.m_DrawBottom)
+	{
+		return;
+	}
+
+	BeginBatch(mShader, drawable.m_Texture, GL_LINES, opaque);
+
+	Batch& batch = m_Batches.back();
+
+	// Put the lines through the middle of the pixel column so that they cover the same 
+	// pixels a FrontQuad would.
+	const float x = drawable.m_X + 0.5f;
+
+	auto AddLine = [&](
+		const float y0, const float z0,
+		const float y1, const float z1,
+		const sf::Vector3f& normal,
+		const sf::Vector2f& texCoords0,
+		const sf::Vector2f& texCoords1)
+	{
+		m_Vertices.push_back(Vertex{ { x, y0, z0 }, normal, texCoords0, drawable.m_BlendColor });
+		m_Vertices.push_back(Vertex{ { x, y1, z1 }, normal, texCoords1, drawable.m_BlendColor });
+
+		batch.m_Count += 2;
+
+		m_Stats.m_PrimitiveCount++;
+	};
+
+	if (drawable.m_DrawTop)
+	{
+		AddLine(
+			drawable.m_FarY, drawable.m_DistanceFar,
+			drawable.m_Top, drawable.m_DistanceNear,
+			sf::Vector3f(0.0f, 0.0f, 1.0f),
+			sf::Vector2f(drawable.m_UOrigin, drawable.m_VOrigin),
+			sf::Vector2f(drawable.m_UOrigin, drawable.m_VOrigin));
+	}
+
+	if (drawable.m_DrawBottom)
+	{
+		AddLine(
+			drawable.m_Bottom, drawable.m_DistanceNear,
+			drawable.m_FarY, drawable.m_DistanceFar,
+			sf::Vector3f(0.0f, 0.0f, -1.0f),
+			sf::Vector2f(drawable.m_UOrigin, drawable.m_VOrigin),
+			sf::Vector2f(drawable.m_UOrigin, drawable.m_VOrigin));
+	}
+
+	if (drawable.m_DrawFront)
+	{
+		AddLine(
+			drawable.m_Top, drawable.m_DistanceNear,
+			drawable.m_Bottom, drawable.m_DistanceNear,
+			drawable.m_Normal,
+			sf::Vector2f(drawable.m_U, drawable.m_VTop),
+			sf::Vector2f(drawable.m_U, drawable.m_VBottom));
+	}
+}
+
+void WorldRaycastRendererImpl::AddQuad(const FrontQuad& quad, const bool opaque)
+{
+	BeginBatch(mQuadShader, quad.m_Texture, GL_TRIANGLES, opaque);
+
+	const Vertex topLeft{ 
+		{ quad.m_Left, quad.m_TopLeft, quad.m_DistanceLeft }, 
+		quad.m_Normal, 
+		{ quad.m_ULeft, quad.m_VTop }, 
+		quad.m_BlendColor };
+	const Vertex bottomLeft{ 
+		{ quad.m_Left, quad.m_BottomLeft, quad.m_DistanceLeft }, 
+		quad.m_Normal, 
+		{ quad.m_ULeft, quad.m_VBottom }, 
+		quad.m_BlendColor };
+	const Vertex topRight{ 
+		{ quad.m_Right, quad.m_TopRight, quad.m_DistanceRight }, 
+		quad.m_Normal, 
+		{ quad.m_URight, quad.m_VTop }, 
+		quad.m_BlendColor };
+	const Vertex bottomRight{ 
+		{ quad.m_Right, quad.m_BottomRight, quad.m_DistanceRight }, 
+		quad.m_Normal, 
+		{ quad.m_URight, quad.m_VBottom }, 
+		quad.m_BlendColor };
+
+	// Two triangles, so that quads from the same batch don't get joined up like a strip's would.
+	for (const Vertex& vertex : { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight })
+	{
+		m_Vertices.push_back(vertex);
+	}
+
+	m_Batches.back().m_Count += 6;
+
+	m_Stats.m_PrimitiveCount++;
+}
+
+void WorldRaycastRendererImpl::ProcessIntersections(IntersectionCollection& collection)
+{
+	// Some intersections may have been found before the ray got clipped, behind the 
+	// occluders.
+	if (collection.m_MaxFraction < 1.0f)
+	{
+		collection.Clip(collection.m_MaxFraction);
+	}
+
+	const int count = collection.GetCount();
+
+	// sort by distance such that further away intersections come first
+	collection.m_BackToFront.resize(count);
+
+	for (int index = 0; index < count; index++)
+	{
+		collection.m_BackToFront[index] = index;
+	}
+
+	std::sort(
+		collection.m_BackToFront.begin(),
+		collection.m_BackToFront.end(),
+		[&fractions = collection.m_EntryFractions](const int a, const int b)
+		{
+			return (fractions[a] > fractions[b]);
+		});
+
+	collection.m_SplitPoints.resize(count * 2);
+
+	for (int index = 0; index < count; index++)
+	{
+		collection.m_SplitPoints[index * 2] = 
+			SplitPoint{ collection.m_EntryPoints[index], collection.m_EntryFractions[index] };
+		collection.m_SplitPoints[index * 2 + 1] = 
+			SplitPoint{ collection.m_ExitPoints[index], collection.m_ExitFractions[index] };
+	}
+
+	std::sort(
+		collection.m_SplitPoints.begin(),
+		collection.m_SplitPoints.end(),
+		[](const SplitPoint& a, const SplitPoint& b)
+		{
+			return (a.m_fraction < b.m_fraction);
+		});
+}
+
+void WorldRaycastRendererImpl::IntersectionCollection::Add(
+	const unsigned renderId, 
+	const Physics::RayCastHit& hit)
+{
+	m_RenderIds.push_back(renderId);
+	m_EntryPoints.push_back(hit.entryPoint);
+	m_EntryNormals.push_back(hit.entryNormal);
+	m_EntryFractions.push_back(hit.entryFraction);
+	m_ExitPoints.push_back(hit.exitPoint);
+	m_ExitFractions.push_back(hit.exitFraction);
+}
+
+void WorldRaycastRendererImpl::IntersectionCollection::Clip(const float32 maxFraction)
+{
+	int kept = 0;
+
+	for (int index = 0; index < GetCount(); index++)
+	{
+		if (m_EntryFractions[index] > maxFraction) continue;
+
+		m_RenderIds[kept] = m_RenderIds[index];
+		m_EntryPoints[kept] = m_EntryPoints[index];
+		m_EntryNormals[kept] = m_EntryNormals[index];
+		m_EntryFractions[kept] = m_EntryFractions[index];
+		m_ExitPoints[kept] = m_ExitPoints[index];
+		m_ExitFractions[kept] = m_ExitFractions[index];
+
+		kept++;
+	}
+
+	m_RenderIds.resize(kept);
+	m_EntryPoints.resize(kept);
+	m_EntryNormals.resize(kept);
+	m_EntryFractions.resize(kept);
+	m_ExitPoints.resize(kept);
+	m_ExitFractions.resize(kept);
+}
+
+void WorldRaycastRendererImpl::IntersectionCollection::Clear(const int index)
+{
+	m_RenderIds.clear();
+	m_EntryPoints.clear();
+	m_EntryNormals.clear();
+	m_EntryFractions.clear();
+	m_ExitPoints.clear();
+	m_ExitFractions.clear();
+
+	m_HasCovered = false;
+	m_MaxFraction = 1.0f;
+	m_Index = index;
+}
+
+float32 WorldRaycastRendererImpl::RaycastCallback::operator()(const Physics::RayCastHit& hit)
+{
+	if (hit.fixture->GetUserData() == nullptr)
+	{
+		return m_Collection->m_MaxFraction;
+	}
+
+	return AddHit(*(const FixtureRenderData*)hit.fixture->GetUserData(), hit);
+}
+
+float32 WorldRaycastRendererImpl::RaycastCallback::AddHit(
+	const FixtureRenderData& renderData, 
+	const Physics::RayCastHit& hit)
+{
+	// Found before the ray got clipped.
+	if (hit.entryFraction > m_Collection->m_MaxFraction)
+	{
+		return m_Collection->m_MaxFraction;
+	}
+
+	m_Collection->Add(renderData.GetRenderId(), hit);
+
+	if (renderData.IsOpaque())
+	{
+		const float distance = b2Dot(hit.entryPoint - m_Camera->GetPosition(), m_Camera->GetForwards());
+
+		if (distance > b2_epsilon)
+		{
+			const VerticalExtent extent = 
+				m_Attributes->GetVerticalExtent(renderData.GetRenderId(), distance);
+
+			AddOccluder(Occluder{ hit.entryFraction, distance, extent.m_Top, extent.m_Bottom });
+		}
+	}
+
+	return m_Collection->m_MaxFraction;
+}
+
+void WorldRaycastRendererImpl::RaycastCallback::AddOccluder(const Occluder& occluder)
+{
+	// Whether everything that could be drawn behind occluder is inside its top and bottom
+	// (or off the screen).
+	auto HidesEverythingBehind = [this](const Occluder& occluder)
+	{
+		const VerticalExtent beyond = m_Attributes->GetExtentBeyond(occluder.m_Distance);
+
+		return
+			occluder.m_Top <= std::max(beyond.m_Top, 0.0f) &&
+			occluder.m_Bottom >= std::min(beyond.m_Bottom, m_TargetHeight);
+	};
+
+	if (HidesEverythingBehind(occluder))
+	{
+		m_Collection->m_MaxFraction = std::min(m_Collection->m_MaxFraction, occluder.m_Fraction);
+	}
+
+	// The hits don't come in order, so the merged one only ever gets further away. It can 
+	// only hide anything if it covers the horizon, so one that doesn't gets swapped for 
+	// one that does.
+	Occluder& covered = m_Collection->m_Covered;
+
+	const bool overlaps = 
+		m_Collection->m_HasCovered &&
+		occluder.m_Top <= covered.m_Bottom && 
+		occluder.m_Bottom >= covered.m_Top;
+
+	const auto CoversHorizon = [this](const Occluder& occluder)
+	{
+		return occluder.m_Top <= m_Attributes->m_Base && occluder.m_Bottom >= m_Attributes->m_Base;
+	};
+
+	if (overlaps)
+	{
+		if (occluder.m_Fraction > covered.m_Fraction)
+		{
+			covered.m_Fraction = occluder.m_Fraction;
+			covered.m_Distance = occluder.m_Distance;
+		}
+
+		covered.m_Top = std::min(covered.m_Top, occluder.m_Top);
+		covered.m_Bottom = std::max(covered.m_Bottom, occluder.m_Bottom);
+	}
+	else if (!m_Collection->m_HasCovered || (CoversHorizon(occluder) && !CoversHorizon(covered)))
+	{
+		covered = occluder;
+		m_Collection->m_HasCovered = true;
+	}
+	else
+	{
+		return;
+	}
+
+	if (HidesEverythingBehind(covered))
+	{
+		m_Collection->m_MaxFraction = std::min(m_Collection->m_MaxFraction, covered.m_Fraction);
+	}
+}
 
 void WorldRaycastRendererImpl::LoadShader() {
 	static const char* vertexShaderRawText = R"(
@@ -797,6 +2850,10 @@ void WorldRaycastRendererImpl::LoadShader() {
 	out vec4 appliedFogColor;
 	out vec4 appliedDirectionalLightColor;
 
+	// Depth goes with 1 / distance, like a perspective projection's, so that it can be 
+	// interpolated in screen space along a top or bottom face and across a quad.
+	const float nearDistance = 0.05f;
+
 	void main() {
 		float fogIntensity = 
 			min(
@@ -815,7 +2872,7 @@ void WorldRaycastRendererImpl::LoadShader() {
 			clamp(dot(gl_Normal, -directionalLightDirection), 0.0f, 1.0f);
 
 		gl_Position = ftransform();
-		gl_Position.z = 0.0f;
+		gl_Position.z = 1.0f - 2.0f * nearDistance / max(gl_Vertex.z, nearDistance);
 		
 		gl_FrontColor = ambientLightColor * gl_Color;
 		
@@ -829,6 +2886,8 @@ void WorldRaycastRendererImpl::LoadShader() {
 	#version 130	
 
 	uniform sampler2D texture;
+
+	uniform float alphaThreshold;
 	
 	in vec4 appliedFogColor;
 	in vec4 appliedDirectionalLightColor;
@@ -837,6 +2896,8 @@ void WorldRaycastRendererImpl::LoadShader() {
 		vec4 blendColor = gl_Color;
 	
 		vec4 textureColor = texture2D(texture, gl_TexCoord[0].xy);
+
+		if (blendColor.a * textureColor.a < alphaThreshold) discard;
 	
 		gl_FragColor = (blendColor * textureColor) + appliedFogColor + appliedDirectionalLightColor;
 	}
@@ -845,6 +2906,83 @@ void WorldRaycastRendererImpl::LoadShader() {
 
 	bool result = mShader.loadFromMemory(vertexShaderRawText, fragmentShaderRawText);
 	assert(result);
+
+	// Quads span many columns, so their texture coordinates and fog have to be interpolated
+	// with perspective in mind. Scaling the position by the distance makes the distance 
+	// the w that the interpolation divides by.
+	static const char* quadVertexShaderRawText = R"(
+	
+	#version 130
+
+	uniform vec4 ambientLightColor;
+
+	uniform vec4 directionalLightColor;
+	uniform vec3 directionalLightDirection;
+	
+	out float distance;
+	out vec4 appliedDirectionalLightColor;
+
+	const float nearDistance = 0.05f;
+
+	void main() {
+		distance = gl_Vertex.z;
+
+		appliedDirectionalLightColor = 
+			directionalLightColor * 
+			clamp(dot(gl_Normal, -directionalLightDirection), 0.0f, 1.0f);
+
+		gl_Position = ftransform();
+		gl_Position.z = 1.0f - 2.0f * nearDistance / max(gl_Vertex.z, nearDistance);
+		gl_Position *= gl_Vertex.z;
+		
+		gl_FrontColor = ambientLightColor * gl_Color;
+		
+		gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+	}
+
+	)";
+
+	static const char* quadFragmentShaderRawText = R"(
+	
+	#version 130	
+
+	uniform sampler2D texture;
+
+	uniform vec4 fogColor;
+	uniform float fogMaxIntensity;
+	uniform float fogMaxDistance;
+	uniform float fogMinDistance;
+
+	uniform float alphaThreshold;
+	
+	in float distance;
+	in vec4 appliedDirectionalLightColor;
+
+	void main() {
+		float fogIntensity = 
+			min(
+				((min(
+					max(
+						distance, 
+						fogMinDistance), 
+					fogMaxDistance) 
+				- fogMinDistance) 
+				/ (fogMaxDistance - fogMinDistance)),
+				fogMaxIntensity);
+
+		vec4 blendColor = gl_Color;
+	
+		vec4 textureColor = texture2D(texture, gl_TexCoord[0].xy);
+
+		if (blendColor.a * textureColor.a < alphaThreshold) discard;
+	
+		gl_FragColor = (blendColor * textureColor) + (fogColor * fogIntensity) + appliedDirectionalLightColor;
+	}
+	
+	)";
+
+	result = mQuadShader.loadFromMemory(quadVertexShaderRawText, quadFragmentShaderRawText);
+	assert(result);
 }
 
 WorldRaycastRenderer::WorldRaycastRenderer()
@@ -853,13 +2991,74 @@ WorldRaycastRenderer::WorldRaycastRenderer()
 
 WorldRaycastRenderer::~WorldRaycastRenderer() = default;
 
+RaycastScene MakeRaycastScene(const World& world)
+{
+	RaycastScene scene;
+	scene.m_PhysicsWorld = world.GetPhysicsWorld();
+	scene.m_StaticGeometry = &world.GetStaticGeometry();
+	scene.m_PotentiallyVisibleSets = &world.GetPotentiallyVisibleSets();
+	scene.m_Billboards = &world.GetBillboards();
+	scene.m_Atlas = &world.GetTextureLibrary().GetAtlas();
+	scene.m_AmbientLight = &world.GetAmbientLight();
+	scene.m_DirectionalLight = &world.GetDirectionalLight();
+	scene.m_Fog = &world.GetFog();
+	scene.m_RenderData = &FixtureRenderData::GetAllByRenderId();
+	scene.m_BodyChanges = &world.GetBodyChanges();
+	scene.m_DrawnTransforms = &world.GetDrawnTransforms();
+	return scene;
+}
+
 void WorldRaycastRenderer::Render(
 	const World & world,
 	const Camera3D & camera,
 	const RenderSettings& settings,
 	sf::RenderTarget & target)
 {
-	m_Impl->Render(world, camera, settings, target);
+	m_Impl->Render(MakeRaycastScene(world), camera, settings, target);
+}
+
+void WorldRaycastRenderer::Render(
+	const World & world,
+	const Camera3D & camera,
+	const RenderSettings& settings,
+	SoftwareFramebuffer & target)
+{
+	m_Impl->Render(MakeRaycastScene(world), camera, settings, target);
+}
+
+void WorldRaycastRenderer::Render(
+	const RaycastScene& scene,
+	const Camera3D& camera,
+	const RenderSettings& settings,
+	SoftwareFramebuffer& target)
+{
+	m_Impl->Render(scene, camera, settings, target);
+}
+
+void WorldRaycastRenderer::Render(
+	const World & world,
+	const gsl::span<const RaycastView> views,
+	const RenderSettings& settings)
+{
+	m_Impl->Render(MakeRaycastScene(world), views, settings);
+}
+
+void WorldRaycastRenderer::Render(
+	const RaycastScene& scene,
+	const gsl::span<const RaycastView> views,
+	const RenderSettings& settings)
+{
+	m_Impl->Render(scene, views, settings);
+}
+
+const RaycastRenderStats& WorldRaycastRenderer::GetStats() const
+{
+	return m_Impl->GetStats();
+}
+
+const ColumnDepthBuffer& WorldRaycastRenderer::GetColumnDepthBuffer(const int view) const
+{
+	return m_Impl->GetColumnDepthBuffer(view);
 }
 
 }
\ No newline at end of file
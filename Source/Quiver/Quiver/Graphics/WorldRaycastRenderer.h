@@ -1,6 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+
+#include <gsl/span>
 
 class b2World;
 
@@ -11,11 +14,80 @@ class RenderTarget;
 
 namespace qvr {
 
+namespace Physics {
+class StaticGeometryGrid;
+}
+
+struct AmbientLight;
+class BillboardStore;
+struct BodyChanges;
+struct DrawnTransform;
 class Camera3D;
+class ColumnDepthBuffer;
+class DirectionalLight;
+class FixtureRenderData;
+class Fog;
+class PotentiallyVisibleSets;
+class SoftwareFramebuffer;
+class TextureAtlas;
 class World;
 class WorldRaycastRendererImpl;
 struct RenderSettings;
 
+// What the last call to WorldRaycastRenderer::Render cost in OpenGL calls.
+struct RaycastRenderStats
+{
+	// Lines and quads drawn. Drawing them one at a time would take this many draw calls.
+	int m_PrimitiveCount = 0;
+	// Columns whose rays were cast. The rest were reused from the frame before.
+	int m_ColumnsCast = 0;
+	// Columns filled in from their neighbours instead (see RenderSettings::m_ColumnStride).
+	int m_ColumnsInterpolated = 0;
+	// Fixtures (or chain children) left in and thrown out by RenderSettings::m_CullToView.
+	int m_FixturesInView = 0;
+	int m_FixturesCulled = 0;
+	// Static fixtures in the potentially visible set of the camera's cell.
+	int m_PotentiallyVisibleFixtures = 0;
+	int m_VertexCount = 0;
+	int m_BatchCount = 0;
+	int m_DrawCalls = 0;
+	int m_ShaderChanges = 0;
+	// How many times a texture was bound.
+	int m_TextureChanges = 0;
+	// Drawn with their own texture because it isn't in the TextureLibrary's atlas.
+	int m_DrawablesOutsideAtlas = 0;
+};
+
+// One camera's view of the World, and where to draw it.
+struct RaycastView
+{
+	const Camera3D* m_Camera;
+	sf::RenderTarget* m_Target;
+};
+
+// Everything the WorldRaycastRenderer looks at: a World's, or a RenderSnapshot of one.
+struct RaycastScene
+{
+	const b2World* m_PhysicsWorld = nullptr;
+	// Without these, RenderSettings::m_UseStaticGeometryGrid and m_UsePotentiallyVisibleSets
+	// are ignored.
+	const Physics::StaticGeometryGrid* m_StaticGeometry = nullptr;
+	const PotentiallyVisibleSets* m_PotentiallyVisibleSets = nullptr;
+	const BillboardStore* m_Billboards = nullptr;
+	// Without it, every texture is drawn on its own.
+	const TextureAtlas* m_Atlas = nullptr;
+	const AmbientLight* m_AmbientLight = nullptr;
+	const DirectionalLight* m_DirectionalLight = nullptr;
+	const Fog* m_Fog = nullptr;
+	// The FixtureRenderData of every fixture and billboard. Can have nulls in it.
+	const std::vector<const FixtureRenderData*>* m_RenderData = nullptr;
+	// Without it, every body gets looked at to find what's moved since the last frame.
+	const BodyChanges* m_BodyChanges = nullptr;
+	// Bodies to draw somewhere other than where they are, sorted by body. They have to be 
+	// inside their fixtures' broadphase proxies there, as they are part way through a step.
+	const std::vector<DrawnTransform>* m_DrawnTransforms = nullptr;
+};
+
 // Takes over the raycasting stage of 3D World rendering from World::Render3D.
 class WorldRaycastRenderer
 {
@@ -23,6 +95,29 @@ public:
 	WorldRaycastRenderer();
 	~WorldRaycastRenderer();
 	void Render(const World& world, const Camera3D& camera, const RenderSettings& settings, sf::RenderTarget& target);
+	// Renders several views in one go, for split-screen and in-world monitors. What doesn't
+	// depend on the camera is only done once: finding what's changed since the last frame, 
+	// and gathering the fixtures in sight of any of the cameras to cast the rays against. 
+	// Stats are totalled over the views.
+	void Render(
+		const World& world, 
+		const gsl::span<const RaycastView> views, 
+		const RenderSettings& settings);
+	// Doesn't touch anything that isn't in the scene, so as long as nothing in it changes 
+	// meanwhile, this can be done on another thread while the World gets on with stepping.
+	void Render(
+		const RaycastScene& scene,
+		const gsl::span<const RaycastView> views,
+		const RenderSettings& settings);
+	// Renders with the SoftwareRasterizer instead of OpenGL, over what's already in the 
+	// framebuffer and at the framebuffer's size. Textures are sampled from the images the 
+	// TextureLibrary loaded them from. Ones that didn't come from it are drawn flat white.
+	void Render(const World& world, const Camera3D& camera, const RenderSettings& settings, SoftwareFramebuffer& target);
+	void Render(const RaycastScene& scene, const Camera3D& camera, const RenderSettings& settings, SoftwareFramebuffer& target);
+	const RaycastRenderStats& GetStats() const;
+	// How far away things can be seen in each column of the last frame rendered, in the 
+	// view-th view.
+	const ColumnDepthBuffer& GetColumnDepthBuffer(const int view = 0) const;
 private:
 	std::unique_ptr<WorldRaycastRendererImpl> m_Impl;
 };
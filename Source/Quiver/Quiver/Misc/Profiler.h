@@ -22,6 +22,10 @@ public:
 		return samples[index];
 	}
 
+	SampleUnit GetLatestSample() const {
+		return samples[(mFront + samples.size() - 1) % samples.size()];
+	}
+
 	int GetFrontIndex() const {
 		return mFront;
 	}
@@ -0,0 +1,85 @@
+#include "TaskThread.h"
+
+#include <cassert>
+
+namespace qvr
+{
+
+TaskThread::~TaskThread()
+{
+	if (!mThread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+
+	mTaskAvailable.notify_one();
+
+	mThread.join();
+}
+
+void TaskThread::Start(Task task)
+{
+	assert(task);
+
+	Wait();
+
+	if (!mThread.joinable())
+	{
+		mThread = std::thread(&TaskThread::ThreadMain, this);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTask = std::move(task);
+		mBusy = true;
+	}
+
+	mTaskAvailable.notify_one();
+}
+
+void TaskThread::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	mTaskFinished.wait(lock, [this]() { return !mBusy; });
+}
+
+bool TaskThread::IsBusy() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	return mBusy;
+}
+
+void TaskThread::ThreadMain()
+{
+	while (true)
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+
+			// Anything started before quitting still gets done.
+			mTaskAvailable.wait(lock, [this]() { return mQuit || mTask; });
+
+			if (!mTask) return;
+
+			task = std::move(mTask);
+			mTask = nullptr;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBusy = false;
+		}
+
+		mTaskFinished.notify_all();
+	}
+}
+
+}
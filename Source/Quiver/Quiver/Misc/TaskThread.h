@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace qvr
+{
+
+// A thread that runs one task at a time for whoever owns it, so that the owner can get on
+// with something else in the meantime. Unlike a WorkerPool, the owner doesn't wait for the
+// task until it asks to.
+class TaskThread {
+public:
+	using Task = std::function<void()>;
+
+	TaskThread() = default;
+	// Waits for the task in progress, if there is one.
+	~TaskThread();
+
+	TaskThread(const TaskThread&) = delete;
+	TaskThread(const TaskThread&&) = delete;
+
+	TaskThread& operator=(const TaskThread&) = delete;
+	TaskThread& operator=(const TaskThread&&) = delete;
+
+	// Waits for the last task to finish first. The thread is only created the first time.
+	void Start(Task task);
+
+	// Blocks until the last task started has finished. Returns straight away if it has.
+	void Wait();
+
+	bool IsBusy() const;
+
+private:
+	void ThreadMain();
+
+	std::thread mThread;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mTaskAvailable;
+	std::condition_variable mTaskFinished;
+
+	// Protected by mMutex.
+	Task mTask;
+	bool mBusy = false;
+	bool mQuit = false;
+};
+
+}
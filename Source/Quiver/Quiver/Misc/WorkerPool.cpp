@@ -0,0 +1,116 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace qvr
+{
+
+WorkerPool::WorkerPool(const unsigned threadCount)
+	: mNextIndex(0)
+{
+	assert(threadCount > 0);
+
+	// The calling thread counts as one of the workers.
+	for (unsigned i = 1; i < threadCount; i++)
+	{
+		mThreads.emplace_back(&WorkerPool::WorkerMain, this, (int)i);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+
+	mWorkAvailable.notify_all();
+
+	for (auto& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+void WorkerPool::ParallelFor(const int count, const int chunkSize, const RangeFunction& function)
+{
+	assert(chunkSize > 0);
+
+	if (count <= 0) return;
+
+	// Not worth waking anyone up for.
+	if (mThreads.empty() || count <= chunkSize)
+	{
+		function(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFunction = &function;
+		mCount = count;
+		mChunkSize = chunkSize;
+		mNextIndex = 0;
+		mBusyWorkers = (int)mThreads.size();
+		mGeneration++;
+	}
+
+	mWorkAvailable.notify_all();
+
+	ProcessChunks(0);
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	mWorkFinished.wait(lock, [this]() { return mBusyWorkers == 0; });
+
+	mFunction = nullptr;
+}
+
+void WorkerPool::WorkerMain(const int workerIndex)
+{
+	unsigned lastGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+
+			mWorkAvailable.wait(lock, [this, lastGeneration]() {
+				return mQuit || mGeneration != lastGeneration;
+			});
+
+			if (mQuit) return;
+
+			lastGeneration = mGeneration;
+		}
+
+		ProcessChunks(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBusyWorkers--;
+		}
+
+		mWorkFinished.notify_one();
+	}
+}
+
+void WorkerPool::ProcessChunks(const int workerIndex)
+{
+	while (true)
+	{
+		const int begin = mNextIndex.fetch_add(mChunkSize);
+
+		if (begin >= mCount) return;
+
+		(*mFunction)(begin, std::min(begin + mChunkSize, mCount), workerIndex);
+	}
+}
+
+unsigned GetHardwareThreadCount()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+}
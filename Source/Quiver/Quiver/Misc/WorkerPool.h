@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qvr
+{
+
+// A fixed set of threads that split a range of work items between them.
+// The thread that calls ParallelFor does a share of the work as well, so a WorkerPool
+// with a thread count of 1 creates no threads and runs everything on the caller.
+class WorkerPool {
+public:
+	// Called with a half-open range of work items [begin, end) and the index of the worker
+	// processing it. Worker indices are in [0, GetThreadCount()), and no two ranges are
+	// ever processed at the same time by the same worker index.
+	using RangeFunction = std::function<void(int begin, int end, int workerIndex)>;
+
+	explicit WorkerPool(const unsigned threadCount);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool(const WorkerPool&&) = delete;
+
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&&) = delete;
+
+	unsigned GetThreadCount() const { return (unsigned)mThreads.size() + 1; }
+
+	// Hands out [0, count) in chunks of chunkSize items to whichever worker is free next,
+	// and blocks until every chunk has been processed.
+	void ParallelFor(const int count, const int chunkSize, const RangeFunction& function);
+
+private:
+	void WorkerMain(const int workerIndex);
+	void ProcessChunks(const int workerIndex);
+
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkFinished;
+
+	// Protected by mMutex.
+	unsigned mGeneration = 0;
+	int mBusyWorkers = 0;
+	bool mQuit = false;
+
+	// Describes the ParallelFor call currently in progress.
+	const RangeFunction* mFunction = nullptr;
+	int mCount = 0;
+	int mChunkSize = 1;
+	std::atomic<int> mNextIndex;
+};
+
+// std::thread::hardware_concurrency, or 1 if it can't be determined.
+unsigned GetHardwareThreadCount();
+
+}
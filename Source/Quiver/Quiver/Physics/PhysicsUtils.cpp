@@ -11,6 +11,20 @@ void b2BodyDeleter::operator()(b2Body* body) const {
 	body->GetWorld()->DestroyBody(body);
 }
 
+b2Transform Interpolate(const b2Transform& from, const b2Transform& to, const float alpha)
+{
+	const float fromAngle = from.q.GetAngle();
+
+	float turn = to.q.GetAngle() - fromAngle;
+
+	if (turn > b2_pi) turn -= 2.0f * b2_pi;
+	if (turn < -b2_pi) turn += 2.0f * b2_pi;
+
+	return b2Transform(
+		from.p + alpha * (to.p - from.p),
+		b2Rot(fromAngle + alpha * turn));
+}
+
 }
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <memory>
 
 class b2Body;
+struct b2Transform;
 
 namespace qvr {
 
@@ -19,6 +20,10 @@ using b2BodyUniquePtr = std::unique_ptr<b2Body, b2BodyDeleter>;
 
 static_assert(sizeof(b2BodyUniquePtr) == sizeof(b2Body*), "Oh no!");
 
+// Part way from one transform to another, with alpha from 0 to 1. Turns whichever way round
+// is shorter.
+b2Transform Interpolate(const b2Transform& from, const b2Transform& to, const float alpha);
+
 }
 
 }
\ No newline at end of file
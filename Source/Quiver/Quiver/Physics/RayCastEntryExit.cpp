@@ -0,0 +1,103 @@
+#include "RayCastEntryExit.h"
+
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+
+namespace qvr {
+
+namespace Physics {
+
+namespace {
+
+float32 CalculateExitFraction(
+	const b2CircleShape& circle, 
+	const b2Transform& transform, 
+	const b2RayCastInput& input)
+{
+	// Solve |p1 + t * d - centre| = radius for the larger root.
+	const b2Vec2 centre = b2Mul(transform, circle.m_p);
+	const b2Vec2 s = input.p1 - centre;
+	const b2Vec2 d = input.p2 - input.p1;
+
+	const float32 a = b2Dot(d, d);
+	const float32 b = b2Dot(s, d);
+	const float32 c = b2Dot(s, s) - circle.m_radius * circle.m_radius;
+
+	const float32 discriminant = b * b - a * c;
+
+	if (discriminant < 0.0f || a < b2_epsilon)
+	{
+		return 1.0f;
+	}
+
+	return (-b + b2Sqrt(discriminant)) / a;
+}
+
+float32 CalculateExitFraction(
+	const b2PolygonShape& polygon,
+	const b2Transform& transform,
+	const b2RayCastInput& input)
+{
+	// Same clipping as b2PolygonShape::RayCast, except we keep the upper bound.
+	const b2Vec2 p1 = b2MulT(transform.q, input.p1 - transform.p);
+	const b2Vec2 p2 = b2MulT(transform.q, input.p2 - transform.p);
+	const b2Vec2 d = p2 - p1;
+
+	float32 upper = 1.0f;
+
+	for (int32 i = 0; i < polygon.m_count; ++i)
+	{
+		const float32 numerator = b2Dot(polygon.m_normals[i], polygon.m_vertices[i] - p1);
+		const float32 denominator = b2Dot(polygon.m_normals[i], d);
+
+		// The segment exits this half-space.
+		if (denominator > 0.0f && numerator < upper * denominator)
+		{
+			upper = numerator / denominator;
+		}
+	}
+
+	return upper;
+}
+
+}
+
+float32 CalculateExitFraction(
+	const b2Fixture& fixture, 
+	const int32 childIndex,
+	const b2RayCastInput& input, 
+	const float32 entryFraction)
+{
+	return CalculateExitFraction(
+		fixture, fixture.GetBody()->GetTransform(), childIndex, input, entryFraction);
+}
+
+float32 CalculateExitFraction(
+	const b2Fixture& fixture, 
+	const b2Transform& transform,
+	const int32, // Circles and polygons only have the one child.
+	const b2RayCastInput& input, 
+	const float32 entryFraction)
+{
+	float32 exitFraction = entryFraction;
+
+	switch (fixture.GetType())
+	{
+	case b2Shape::e_circle:
+		exitFraction = CalculateExitFraction(
+			*(const b2CircleShape*)fixture.GetShape(), transform, input);
+		break;
+	case b2Shape::e_polygon:
+		exitFraction = CalculateExitFraction(
+			*(const b2PolygonShape*)fixture.GetShape(), transform, input);
+		break;
+	default:
+		break;
+	}
+
+	return b2Clamp(exitFraction, entryFraction, 1.0f);
+}
+
+}
+
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
+
+namespace qvr {
+
+namespace Physics {
+
+// One child of a fixture's shape (there's only ever one, unless the shape is a chain).
+// b2DynamicTrees passed to RayCastEntryExit must have a FixtureChild* as the user data 
+// of each proxy.
+struct FixtureChild {
+	const b2Fixture* fixture;
+	int32 childIndex;
+};
+
+// A FixtureChild that gets cast against somewhere other than where its body is.
+struct TransformedFixtureChild {
+	FixtureChild child;
+	b2Transform transform;
+};
+
+// A b2DynamicTree whose user data are TransformedFixtureChild pointers. RayCastEntryExit 
+// casts against each child at its own transform, rather than its body's.
+struct TransformedFixtureTree {
+	b2DynamicTree tree;
+
+	template<typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const {
+		tree.RayCast(callback, input);
+	}
+
+	template<typename T>
+	void RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const {
+		tree.RayCastPacket(callback, inputs, count);
+	}
+};
+
+// A fixture that a ray passes through, with the points where the ray goes in and comes out.
+struct RayCastHit {
+	const b2Fixture* fixture;
+	int32 childIndex;
+
+	b2Vec2 entryPoint;
+	b2Vec2 entryNormal;
+	float32 entryFraction;
+
+	b2Vec2 exitPoint;
+	float32 exitFraction;
+};
+
+// Given that the ray in input enters the child shape at entryFraction, returns the 
+// fraction along the ray at which it leaves. Circles and polygons are solved directly; 
+// edges and chains have no inside, so the ray leaves where it went in.
+// If the ray ends inside the shape this returns 1.
+float32 CalculateExitFraction(
+	const b2Fixture& fixture, 
+	const int32 childIndex, 
+	const b2RayCastInput& input, 
+	const float32 entryFraction);
+
+// The same, with the fixture at transform rather than where its body is.
+float32 CalculateExitFraction(
+	const b2Fixture& fixture, 
+	const b2Transform& transform,
+	const int32 childIndex, 
+	const b2RayCastInput& input, 
+	const float32 entryFraction);
+
+namespace detail {
+
+inline FixtureChild GetFixtureChild(const b2BroadPhase& broadPhase, const int32 proxyId)
+{
+	const b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase.GetUserData(proxyId);
+	return FixtureChild{ proxy->fixture, proxy->childIndex };
+}
+
+inline FixtureChild GetFixtureChild(const b2DynamicTree& tree, const int32 proxyId)
+{
+	return *(const FixtureChild*)tree.GetUserData(proxyId);
+}
+
+inline FixtureChild GetFixtureChild(const TransformedFixtureTree& tree, const int32 proxyId)
+{
+	return ((const TransformedFixtureChild*)tree.tree.GetUserData(proxyId))->child;
+}
+
+template<typename Tree>
+const b2Transform& GetTransform(const Tree&, const int32, const FixtureChild& child)
+{
+	return child.fixture->GetBody()->GetTransform();
+}
+
+inline const b2Transform& GetTransform(
+	const TransformedFixtureTree& tree, 
+	const int32 proxyId, 
+	const FixtureChild&)
+{
+	return ((const TransformedFixtureChild*)tree.tree.GetUserData(proxyId))->transform;
+}
+
+// Callbacks can return a bool (false to stop the ray), or the fraction to clip the ray to.
+inline float32 ToClipFraction(const bool result, const float32 maxFraction)
+{
+	return result ? maxFraction : 0.0f;
+}
+
+inline float32 ToClipFraction(const float32 result, const float32 maxFraction)
+{
+	return b2Min(result, maxFraction);
+}
+
+// Does the exact ray cast against the child's fixture and passes the hit on to callback.
+template<typename Callback>
+float32 ReportEntryExit(
+	const FixtureChild& child,
+	const b2Transform& transform,
+	Callback& callback,
+	const b2RayCastInput& input)
+{
+	b2RayCastOutput output;
+	if (!child.fixture->GetShape()->RayCast(&output, input, transform, child.childIndex))
+	{
+		return input.maxFraction;
+	}
+
+	RayCastHit hit;
+	hit.fixture = child.fixture;
+	hit.childIndex = child.childIndex;
+	hit.entryFraction = output.fraction;
+	hit.entryNormal = output.normal;
+	hit.entryPoint = input.p1 + output.fraction * (input.p2 - input.p1);
+	hit.exitFraction = 
+		CalculateExitFraction(*child.fixture, transform, child.childIndex, input, output.fraction);
+	hit.exitPoint = input.p1 + hit.exitFraction * (input.p2 - input.p1);
+
+	return ToClipFraction(callback(hit), input.maxFraction);
+}
+
+struct AcceptAll
+{
+	bool operator()(const FixtureChild&) const { return true; }
+};
+
+template<typename Tree, typename Callback, typename Filter>
+struct EntryExitRayCastWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		const FixtureChild child = GetFixtureChild(*tree, proxyId);
+
+		if (!(*filter)(child)) return input.maxFraction;
+
+		return ReportEntryExit(child, GetTransform(*tree, proxyId, child), *callback, input);
+	}
+
+	const Tree* tree;
+	Callback* callback;
+	const Filter* filter;
+};
+
+template<typename Tree, typename Callback, typename Filter>
+struct EntryExitRayCastPacketWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId, int32 rayIndex)
+	{
+		const FixtureChild child = GetFixtureChild(*tree, proxyId);
+
+		if (!(*filter)(child)) return input.maxFraction;
+
+		return ReportEntryExit(child, GetTransform(*tree, proxyId, child), callbacks[rayIndex], input);
+	}
+
+	const Tree* tree;
+	Callback* callbacks;
+	const Filter* filter;
+};
+
+}
+
+// Casts a ray from point1 to point2 through every proxy in tree, calling 
+// callback(const RayCastHit&) once for each fixture it passes through. Unlike b2World::RayCast, 
+// this finds the exit points without casting a second ray back the other way.
+// Hits are reported in no particular order. Return false from the callback to stop early,
+// or a float32 fraction to ignore anything further along the ray than that (like a 
+// b2RayCastCallback). Hits further along than maxFraction are never reported.
+// Tree can be a b2BroadPhase, a b2DynamicTree whose user data are FixtureChild pointers, or
+// a TransformedFixtureTree.
+// Children that filter(const FixtureChild&) returns false for are skipped without being
+// cast against.
+template<typename Tree, typename Callback, typename Filter = detail::AcceptAll>
+void RayCastEntryExit(
+	const Tree& tree, 
+	Callback& callback, 
+	const b2Vec2& point1, 
+	const b2Vec2& point2,
+	const float32 maxFraction = 1.0f,
+	const Filter& filter = Filter())
+{
+	detail::EntryExitRayCastWrapper<Tree, Callback, Filter> wrapper;
+	wrapper.tree = &tree;
+	wrapper.callback = &callback;
+	wrapper.filter = &filter;
+
+	b2RayCastInput input;
+	input.maxFraction = maxFraction;
+	input.p1 = point1;
+	input.p2 = point2;
+
+	tree.RayCast(&wrapper, input);
+}
+
+// Like RayCastEntryExit, but casts count rays at once using b2DynamicTree::RayCastPacket. 
+// Hits on the ray from point1s[i] to point2s[i] are reported to callbacks[i]. Returning 
+// false from a callback only stops its own ray. maxFractions can be null, or hold a 
+// maxFraction for each ray.
+// count must be no more than b2_maxRayPacketSize.
+template<typename Tree, typename Callback, typename Filter = detail::AcceptAll>
+void RayCastEntryExitPacket(
+	const Tree& tree,
+	Callback* callbacks,
+	const b2Vec2* point1s,
+	const b2Vec2* point2s,
+	const int32 count,
+	const float32* maxFractions = nullptr,
+	const Filter& filter = Filter())
+{
+	detail::EntryExitRayCastPacketWrapper<Tree, Callback, Filter> wrapper;
+	wrapper.tree = &tree;
+	wrapper.callbacks = callbacks;
+	wrapper.filter = &filter;
+
+	b2RayCastInput inputs[b2_maxRayPacketSize];
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		inputs[i].maxFraction = maxFractions ? maxFractions[i] : 1.0f;
+		inputs[i].p1 = point1s[i];
+		inputs[i].p2 = point2s[i];
+	}
+
+	tree.RayCastPacket(&wrapper, inputs, count);
+}
+
+// Casts against every fixture in the world (that filter accepts).
+template<typename Callback, typename Filter = detail::AcceptAll>
+void RayCastEntryExit(
+	const b2World& world, 
+	Callback& callback, 
+	const b2Vec2& point1, 
+	const b2Vec2& point2,
+	const float32 maxFraction = 1.0f,
+	const Filter& filter = Filter())
+{
+	RayCastEntryExit(
+		world.GetContactManager().m_broadPhase, callback, point1, point2, maxFraction, filter);
+}
+
+// Casts a packet against every fixture in the world (that filter accepts).
+template<typename Callback, typename Filter = detail::AcceptAll>
+void RayCastEntryExitPacket(
+	const b2World& world,
+	Callback* callbacks,
+	const b2Vec2* point1s,
+	const b2Vec2* point2s,
+	const int32 count,
+	const float32* maxFractions = nullptr,
+	const Filter& filter = Filter())
+{
+	RayCastEntryExitPacket(
+		world.GetContactManager().m_broadPhase, callbacks, point1s, point2s, count, maxFractions, filter);
+}
+
+}
+
+}
@@ -0,0 +1,102 @@
+#include "StaticGeometryGrid.h"
+
+#include <algorithm>
+
+#include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Common/b2Settings.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+namespace qvr {
+
+namespace Physics {
+
+StaticGeometryGrid::StaticGeometryGrid(const float cellSize)
+	: mCellSize(cellSize)
+{
+	assert(cellSize > 0.0f);
+}
+
+void StaticGeometryGrid::AddBody(const b2Body& body)
+{
+	// Only Entities' bodies have user data.
+	if (body.GetType() != b2_staticBody || body.GetUserData() == nullptr) return;
+
+	if (Contains(body)) return;
+
+	std::vector<CellKey>& bodyCells = mBodies[&body];
+
+	for (const b2Fixture* fixture = body.GetFixtureList(); fixture; fixture = fixture->GetNext())
+	{
+		const b2Shape& shape = *fixture->GetShape();
+
+		for (int32 childIndex = 0; childIndex < shape.GetChildCount(); childIndex++)
+		{
+			b2AABB aabb;
+			shape.ComputeAABB(&aabb, body.GetTransform(), childIndex);
+
+			// Pad it a bit so that hits right on the edge still land in a cell it's listed in.
+			const b2Vec2 padding(b2_linearSlop, b2_linearSlop);
+
+			const int32 minX = ToCell(aabb.lowerBound.x - padding.x);
+			const int32 minY = ToCell(aabb.lowerBound.y - padding.y);
+			const int32 maxX = ToCell(aabb.upperBound.x + padding.x);
+			const int32 maxY = ToCell(aabb.upperBound.y + padding.y);
+
+			for (int32 x = minX; x <= maxX; x++)
+			{
+				for (int32 y = minY; y <= maxY; y++)
+				{
+					const CellKey key = MakeKey(x, y);
+					
+					mCells[key].push_back(Entry{ FixtureChild{ fixture, childIndex }, &body });
+
+					bodyCells.push_back(key);
+				}
+			}
+		}
+	}
+
+	std::sort(bodyCells.begin(), bodyCells.end());
+	bodyCells.erase(std::unique(bodyCells.begin(), bodyCells.end()), bodyCells.end());
+}
+
+void StaticGeometryGrid::RemoveBody(const b2Body& body)
+{
+	const auto bodyIt = mBodies.find(&body);
+
+	if (bodyIt == mBodies.end()) return;
+
+	for (const CellKey key : bodyIt->second)
+	{
+		const auto cellIt = mCells.find(key);
+
+		if (cellIt == mCells.end()) continue;
+
+		auto& cell = cellIt->second;
+
+		cell.erase(
+			std::remove_if(
+				cell.begin(), 
+				cell.end(), 
+				[&body](const Entry& entry) { return entry.body == &body; }),
+			cell.end());
+
+		if (cell.empty())
+		{
+			mCells.erase(cellIt);
+		}
+	}
+
+	mBodies.erase(bodyIt);
+}
+
+void StaticGeometryGrid::Clear()
+{
+	mCells.clear();
+	mBodies.clear();
+}
+
+}
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Common/b2Math.h>
+
+#include "Quiver/Physics/RayCastEntryExit.h"
+
+class b2Body;
+
+namespace qvr {
+
+namespace Physics {
+
+// A uniform grid over the fixtures of static Entity bodies, for casting rays through the
+// level's walls without going through the b2World broadphase (and everything that moves).
+// Each fixture is listed in every cell its AABB overlaps. Rays walk the cells in order (DDA),
+// and a fixture is only reported from the cell that contains the point the ray enters it, so 
+// each one is reported once without having to keep track of which have been visited.
+// Fixtures are kept whether or not they have render data at the moment, so adding or 
+// removing a RenderComponent doesn't need a rebuild.
+class StaticGeometryGrid {
+public:
+	explicit StaticGeometryGrid(const float cellSize = 2.0f);
+
+	StaticGeometryGrid(const StaticGeometryGrid&) = delete;
+	StaticGeometryGrid& operator=(const StaticGeometryGrid&) = delete;
+
+	// Adds the body's fixtures if it is a static Entity body. Otherwise does nothing.
+	void AddBody(const b2Body& body);
+
+	// Removes the body's fixtures, if they are in the grid.
+	void RemoveBody(const b2Body& body);
+
+	// Call when a body has moved, changed type or had its fixtures changed.
+	void UpdateBody(const b2Body& body) {
+		RemoveBody(body);
+		AddBody(body);
+	}
+
+	void Clear();
+
+	bool Contains(const b2Body& body) const { return mBodies.count(&body) > 0; }
+
+	// Calls function(const b2Body&) for each body in the grid, in no particular order.
+	template<typename Function>
+	void ForEachBody(Function function) const {
+		for (const auto& body : mBodies) {
+			function(*body.first);
+		}
+	}
+
+	int GetBodyCount() const { return (int)mBodies.size(); }
+	int GetCellCount() const { return (int)mCells.size(); }
+
+	float GetCellSize() const { return mCellSize; }
+
+	// Works like Physics::RayCastEntryExit. callback(const RayCastHit&) is called once for 
+	// each fixture in the grid that the ray passes through, in roughly front-to-back order.
+	// That makes clipping the ray from the callback especially effective here, since it 
+	// stops the walk through the cells.
+	template<typename Callback>
+	void RayCast(
+		Callback& callback, 
+		const b2Vec2& point1, 
+		const b2Vec2& point2, 
+		const float32 maxFraction = 1.0f) const;
+
+private:
+	using CellKey = std::uint64_t;
+
+	static CellKey MakeKey(const int32 x, const int32 y) {
+		return ((CellKey)(std::uint32_t)x << 32) | (CellKey)(std::uint32_t)y;
+	}
+
+	int32 ToCell(const float32 coordinate) const {
+		return (int32)floorf(coordinate / mCellSize);
+	}
+
+	struct Entry {
+		FixtureChild child;
+		const b2Body* body;
+	};
+
+	float mCellSize;
+
+	std::unordered_map<CellKey, std::vector<Entry>> mCells;
+
+	// The cells each body's fixtures were put in, so they can be taken out again.
+	std::unordered_map<const b2Body*, std::vector<CellKey>> mBodies;
+};
+
+template<typename Callback>
+void StaticGeometryGrid::RayCast(
+	Callback& callback, 
+	const b2Vec2& point1, 
+	const b2Vec2& point2, 
+	const float32 maxFraction) const
+{
+	if (mCells.empty()) return;
+
+	const b2Vec2 d = point2 - point1;
+
+	b2RayCastInput input;
+	input.p1 = point1;
+	input.p2 = point2;
+	input.maxFraction = maxFraction;
+
+	int32 cellX = ToCell(point1.x);
+	int32 cellY = ToCell(point1.y);
+
+	const int32 stepX = d.x > 0.0f ? 1 : -1;
+	const int32 stepY = d.y > 0.0f ? 1 : -1;
+
+	// Fraction along the ray it takes to cross one cell in each axis, and the fraction at 
+	// which the ray crosses into the next cell in each axis.
+	const float32 hugeFraction = FLT_MAX;
+
+	const float32 deltaX = d.x != 0.0f ? b2Abs(mCellSize / d.x) : hugeFraction;
+	const float32 deltaY = d.y != 0.0f ? b2Abs(mCellSize / d.y) : hugeFraction;
+
+	float32 nextX = d.x != 0.0f ? 
+		((cellX + (stepX > 0 ? 1 : 0)) * mCellSize - point1.x) / d.x : 
+		hugeFraction;
+	float32 nextY = d.y != 0.0f ? 
+		((cellY + (stepY > 0 ? 1 : 0)) * mCellSize - point1.y) / d.y : 
+		hugeFraction;
+
+	float32 cellEnter = 0.0f;
+
+	while (cellEnter < input.maxFraction)
+	{
+		const float32 cellExit = b2Min(b2Min(nextX, nextY), 1.0f);
+
+		const auto it = mCells.find(MakeKey(cellX, cellY));
+
+		if (it != mCells.end())
+		{
+			for (const Entry& entry : it->second)
+			{
+				const FixtureChild& child = entry.child;
+
+				b2RayCastOutput output;
+				if (!child.fixture->RayCast(&output, input, child.childIndex))
+				{
+					continue;
+				}
+
+				// Each hit belongs to the one cell whose stretch of the ray it lies in.
+				if (output.fraction < cellEnter || output.fraction >= cellExit)
+				{
+					// Unless the ray ends exactly on the hit.
+					if (!(cellExit == 1.0f && output.fraction == 1.0f))
+					{
+						continue;
+					}
+				}
+
+				RayCastHit hit;
+				hit.fixture = child.fixture;
+				hit.childIndex = child.childIndex;
+				hit.entryFraction = output.fraction;
+				hit.entryNormal = output.normal;
+				hit.entryPoint = point1 + output.fraction * d;
+				hit.exitFraction = 
+					CalculateExitFraction(*child.fixture, child.childIndex, input, output.fraction);
+				hit.exitPoint = point1 + hit.exitFraction * d;
+
+				input.maxFraction = detail::ToClipFraction(callback(hit), input.maxFraction);
+
+				if (input.maxFraction == 0.0f)
+				{
+					return;
+				}
+			}
+		}
+
+		if (nextX < nextY)
+		{
+			cellX += stepX;
+			nextX += deltaX;
+		}
+		else
+		{
+			cellY += stepY;
+			nextY += deltaY;
+		}
+
+		cellEnter = cellExit;
+	}
+}
+
+}
+
+}
@@ -1,5 +1,8 @@
 #include "World.h"
 
+#include <algorithm>
+#include <functional>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -30,9 +33,13 @@
 #include "Quiver/Entity/PhysicsComponent/PhysicsComponentDef.h"
 #include "Quiver/Entity/RenderComponent/RenderComponent.h"
 #include "Quiver/Graphics/b2DrawSFML.h"
+#include "Quiver/Graphics/BillboardStore.h"
 #include "Quiver/Graphics/Camera2D.h"
 #include "Quiver/Graphics/Camera3D.h"
 #include "Quiver/Graphics/ColourUtils.h"
+#include "Quiver/Graphics/ColumnDepthBuffer.h"
+#include "Quiver/Graphics/ColumnStrideController.h"
+#include "Quiver/Graphics/PotentiallyVisibleSets.h"
 #include "Quiver/Graphics/TextureLibrary.h"
 #include "Quiver/Graphics/WorldRaycastRenderer.h"
 #include "Quiver/Graphics/WorldUiRenderer.h"
@@ -41,7 +48,10 @@
 #include "Quiver/Misc/ImGuiHelpers.h"
 #include "Quiver/Misc/JsonHelpers.h"
 #include "Quiver/Misc/Profiler.h"
+#include "Quiver/Misc/WorkerPool.h"
 #include "Quiver/Physics/ContactListener.h"
+#include "Quiver/Physics/PhysicsUtils.h"
+#include "Quiver/Physics/StaticGeometryGrid.h"
 #include "Quiver/World/WorldContext.h"
 
 namespace qvr {
@@ -67,6 +77,27 @@ bool SaveWorld(const World & world, const std::string filename) {
 
 	log->debug("Serialized the World in JSON format to {}", filename);
 
+	// Keep the potentially visible sets next to the World, or get rid of the old ones if
+	// they've been thrown away since.
+	{
+		const std::string pvsFilename = GetPotentiallyVisibleSetsFilename(filename);
+
+		nlohmann::json pvsJson;
+
+		if (world.GetPotentiallyVisibleSets().ToJson(pvsJson)) {
+			std::ofstream pvsOut(pvsFilename);
+			if (!pvsOut.is_open()) {
+				log->error("Couldn't save the potentially visible sets to {}", pvsFilename);
+				return true;
+			}
+
+			pvsOut << pvsJson.dump();
+		}
+		else {
+			std::remove(pvsFilename.c_str());
+		}
+	}
+
 	return true;
 }
 
@@ -85,6 +116,20 @@ std::unique_ptr<World> LoadWorld(
 
 		log->debug("Loaded World from JSON file {}", filename);
 
+		const std::string pvsFilename = GetPotentiallyVisibleSetsFilename(filename);
+
+		if (std::ifstream(pvsFilename).is_open()) {
+			if (world->GetPotentiallyVisibleSets().FromJson(
+				JsonHelp::LoadJsonFromFile(pvsFilename), 
+				world->GetStaticGeometry()))
+			{
+				log->debug("Loaded potentially visible sets from {}", pvsFilename);
+			}
+		}
+
+		// Everything the World's RenderComponents need is loaded by now.
+		world->GetTextureLibrary().BuildAtlas();
+
 		return world;
 	}
 	catch (std::exception e)
@@ -102,8 +147,14 @@ World::World(
 	, mPhysicsWorld(std::make_unique<b2World>(b2Vec2_zero))
 	, mAudioLibrary(std::make_unique<AudioLibrary>())
 	, mTextureLibrary(std::make_unique<TextureLibrary>())
+	, mStaticGeometry(std::make_unique<Physics::StaticGeometryGrid>())
+	, mPotentiallyVisibleSets(std::make_unique<PotentiallyVisibleSets>())
+	, mColumnDepthBuffer(std::make_unique<ColumnDepthBuffer>())
+	, mBillboards(std::make_unique<BillboardStore>())
 {
 	mPhysicsWorld->SetContactListener(mContactListener.get());
+
+	OnBodiesChanged();
 }
 
 World::~World() {}
@@ -116,6 +167,15 @@ void World::TakeStep(qvr::RawInputDevices& inputDevices)
 
 	ProfilerScope ps(sStepProfiler);
 
+	mStepStartBodies.clear();
+
+	for (const b2Body* body = mPhysicsWorld->GetBodyList(); body; body = body->GetNext())
+	{
+		if (body->GetType() == b2_staticBody || !body->IsAwake()) continue;
+
+		mStepStartBodies.push_back(InterpolatedBody{ body, body->GetTransform(), b2Transform() });
+	}
+
 	// Update physics world.
 	{
 		int velocity_iterations = 8;
@@ -139,9 +199,95 @@ void World::TakeStep(qvr::RawInputDevices& inputDevices)
 		}
 	}
 
+	// Nothing that was asleep at the start and the end of the step can have moved. Ones 
+	// that were created or removed during it have called OnBodiesChanged.
+	for (const InterpolatedBody& stepStart : mStepStartBodies) {
+		if (stepStart.mBody) {
+			mBodyChanges.m_MovedBodies.push_back(stepStart.mBody);
+		}
+	}
+
+	for (const b2Body* body = mPhysicsWorld->GetBodyList(); body; body = body->GetNext())
+	{
+		if (body->GetType() == b2_staticBody || !body->IsAwake()) continue;
+
+		mBodyChanges.m_MovedBodies.push_back(body);
+	}
+
+	// It goes on filling up until the World is rendered.
+	{
+		auto& movedBodies = mBodyChanges.m_MovedBodies;
+		std::sort(movedBodies.begin(), movedBodies.end());
+		movedBodies.erase(std::unique(movedBodies.begin(), movedBodies.end()), movedBodies.end());
+	}
+
+	// Bodies that were created during the step aren't interpolated, and removed ones have
+	// been forgotten about already. New bodies go on the front of the body list, and the
+	// rest stay in the same order, so the bodies that were there at the start can be 
+	// picked out by walking the list and mStepStartBodies together.
+	mInterpolatedBodies.clear();
+
+	auto stepStart = mStepStartBodies.begin();
+
+	for (const b2Body* body = mPhysicsWorld->GetBodyList(); body; body = body->GetNext())
+	{
+		while (stepStart != mStepStartBodies.end() && stepStart->mBody == nullptr) {
+			++stepStart;
+		}
+
+		if (stepStart == mStepStartBodies.end()) break;
+
+		if (stepStart->mBody != body) continue;
+
+		const b2Transform& previous = stepStart->mPrevious;
+		const b2Transform& current = body->GetTransform();
+
+		++stepStart;
+
+		if (previous.p == current.p && previous.q.s == current.q.s && previous.q.c == current.q.c) {
+			continue;
+		}
+
+		mInterpolatedBodies.push_back(InterpolatedBody{ body, previous, current });
+	}
+
+	mStepStartBodies.clear();
+
+	UpdateDrawnTransforms();
+
 	mStepCount += 1;
 }
 
+void World::SetRenderInterpolation(const float alpha)
+{
+	if (alpha == mRenderInterpolation) return;
+
+	mRenderInterpolation = alpha;
+
+	UpdateDrawnTransforms();
+}
+
+void World::UpdateDrawnTransforms()
+{
+	mDrawnTransforms.clear();
+
+	if (mRenderInterpolation >= 1.0f) return;
+
+	for (const InterpolatedBody& interpolated : mInterpolatedBodies)
+	{
+		mDrawnTransforms.push_back(
+			DrawnTransform{
+				interpolated.mBody,
+				Physics::Interpolate(interpolated.mPrevious, interpolated.mCurrent, mRenderInterpolation) });
+	}
+
+	std::sort(
+		mDrawnTransforms.begin(), 
+		mDrawnTransforms.end(), 
+		[](const DrawnTransform& a, const DrawnTransform& b) {
+			return std::less<const b2Body*>()(a.m_Body, b.m_Body); });
+}
+
 void World::SetPaused(const bool paused)
 {
 	if (paused)
@@ -192,6 +338,8 @@ void World::Render2D(sf::RenderTarget& target, const Camera2D& camera)
 Profiler sPreRenderProfiler(512);
 Profiler sRenderProfiler(512);
 Profiler sColumnsProfiler(512);
+RaycastRenderStats sRaycastRenderStats;
+ColumnStrideController sColumnStrideController;
 
 void DrawGradientRectVertical(
 	sf::RenderTarget& target,
@@ -264,17 +412,89 @@ void World::Render3D(
 	const Camera3D & camera,
 	WorldRaycastRenderer & raycastRenderer)
 {
+	const RaycastView view{ &camera, &target };
+
+	Render3D(gsl::make_span(&view, 1), raycastRenderer);
+}
+
+void World::Render3D(
+	const gsl::span<const RaycastView> views,
+	WorldRaycastRenderer & raycastRenderer)
+{
+	if (views.empty()) return;
+
 	{
 		ProfilerScope ps(sPreRenderProfiler);
 
-		UpdateDetachedRenderComponents(camera);
+		UpdateDetachedRenderComponents();
 	}
 
-	const sf::Vector2u targetSize = target.getSize();
+	const sf::Vector2u firstTargetSize = views[0].m_Target->getSize();
+
+	if (sColumnsProfiler.BufferSize() != static_cast<int>(firstTargetSize.x)) {
+		sColumnsProfiler.Resize(firstTargetSize.x);
+	}
+
+	for (const RaycastView& view : views) {
+		RenderBackground3D(
+			*view.m_Target, 
+			*view.m_Camera, 
+			groundColor, 
+			skyColor, 
+			mAmbientLight, 
+			mDirectionalLight, 
+			mFog, 
+			mSky);
+	}
+
+	const auto renderStart = std::chrono::steady_clock::now();
 
-	if (sColumnsProfiler.BufferSize() != static_cast<int>(targetSize.x)) {
-		sColumnsProfiler.Resize(targetSize.x);
+	raycastRenderer.Render(*this, views, mRenderSettings);
+
+	OnRendered3D(raycastRenderer, std::chrono::steady_clock::now() - renderStart);
+
+	// Render stuff that goes on top of the 3D image (effects, HUD, weapons...)
+	for (const RaycastView& view : views) {
+		view.m_Camera->DrawOverlay(*view.m_Target);
 	}
+}
+
+void World::OnRendered3D(
+	const WorldRaycastRenderer& raycastRenderer,
+	const std::chrono::duration<float, std::milli> renderTime)
+{
+	sRenderProfiler.AddSample(renderTime);
+
+	sRaycastRenderStats = raycastRenderer.GetStats();
+
+	*mColumnDepthBuffer = raycastRenderer.GetColumnDepthBuffer();
+
+	mBodyChanges.m_RenderCount++;
+
+	ResetMovedBodies();
+
+	if (mRenderSettings.m_AdaptiveColumnStride)
+	{
+		sColumnStrideController.AddSample(
+			sRenderProfiler.GetLatestSample(),
+			Profiler::SampleUnit(mRenderSettings.m_RenderBudgetMs),
+			mRenderSettings.m_MaxColumnStride);
+
+		mRenderSettings.m_ColumnStride = sColumnStrideController.GetStride();
+	}
+}
+
+void RenderBackground3D(
+	sf::RenderTarget& target,
+	const Camera3D& camera,
+	const sf::Color groundColor,
+	const sf::Color skyColor,
+	const AmbientLight& ambientLight,
+	const DirectionalLight& directionalLight,
+	const Fog& fog,
+	const Sky& sky)
+{
+	const sf::Vector2u targetSize = target.getSize();
 
 	// Draw ground.
 	{
@@ -282,12 +502,12 @@ void World::Render3D(
 		const int top = (targetSize.y / 2) + GetPitchOffsetInPixels(camera, targetSize.y);
 		rect.setPosition(0.0f, (float)top);
 		rect.setSize(sf::Vector2f((float)targetSize.x, (float)(targetSize.y - top)));
-		float fraction = std::max(0.0f, -mDirectionalLight.GetDirection().z);
-		sf::Color directionalLightColor = mDirectionalLight.GetColor();
+		float fraction = std::max(0.0f, -directionalLight.GetDirection().z);
+		sf::Color directionalLightColor = directionalLight.GetColor();
 		directionalLightColor.r = (sf::Uint8)((float)directionalLightColor.r * fraction);
 		directionalLightColor.g = (sf::Uint8)((float)directionalLightColor.g * fraction);
 		directionalLightColor.b = (sf::Uint8)((float)directionalLightColor.b * fraction);
-		rect.setFillColor(groundColor * mAmbientLight.mColor + directionalLightColor);
+		rect.setFillColor(groundColor * ambientLight.mColor + directionalLightColor);
 		target.draw(rect);
 
 		// Draw distance-shade on top of it.
@@ -304,16 +524,16 @@ void World::Render3D(
 
 			const int maxIntensityPoint = horizontalMetresToPixels(
 				targetSize.y,
-				mFog.GetMaxDistance(),
+				fog.GetMaxDistance(),
 				camera.GetHeight());
 
 			rect.setSize(sf::Vector2f((float)targetSize.x, (float)maxIntensityPoint));
 
 			const sf::Color maxIntensityColor(
-				mFog.GetColor().r,
-				mFog.GetColor().g,
-				mFog.GetColor().b,
-				(sf::Uint8)(mFog.GetMaxIntensity() * 255));
+				fog.GetColor().r,
+				fog.GetColor().g,
+				fog.GetColor().b,
+				(sf::Uint8)(fog.GetMaxIntensity() * 255));
 
 			rect.setFillColor(maxIntensityColor);
 
@@ -321,10 +541,10 @@ void World::Render3D(
 
 			const int minIntensityPoint = horizontalMetresToPixels(
 				targetSize.y,
-				mFog.GetMinDistance(),
+				fog.GetMinDistance(),
 				camera.GetHeight());
 
-			const sf::Color minIntensityColor = mFog.GetColor();
+			const sf::Color minIntensityColor = fog.GetColor();
 
 			DrawGradientRectVertical(
 				target,
@@ -347,17 +567,8 @@ void World::Render3D(
 			target.draw(rect);
 		}
 
-		mSky.Render(target, camera);
-	}
-
-	{
-		ProfilerScope ps(sRenderProfiler);
-
-		raycastRenderer.Render(*this, camera, mRenderSettings, target);
+		sky.Render(target, camera);
 	}
-
-	// Render stuff that goes on top of the 3D image (effects, HUD, weapons...)
-	camera.DrawOverlay(target);
 }
 
 bool World::RegisterUiRenderer(WorldUiRenderer& renderer)
@@ -430,11 +641,76 @@ bool World::RemoveEntityImmediate(const Entity & entity)
 
 	if (it == mEntities.end()) return false;
 
+	if (entity.GetPhysics()) {
+		if (mStaticGeometry->Contains(entity.GetPhysics()->GetBody())) {
+			mPotentiallyVisibleSets->Clear();
+		}
+
+		mStaticGeometry->RemoveBody(entity.GetPhysics()->GetBody());
+
+		const b2Body* body = &entity.GetPhysics()->GetBody();
+
+		for (InterpolatedBody& stepStart : mStepStartBodies) {
+			if (stepStart.mBody == body) {
+				stepStart.mBody = nullptr;
+			}
+		}
+
+		mInterpolatedBodies.erase(
+			std::remove_if(
+				mInterpolatedBodies.begin(),
+				mInterpolatedBodies.end(),
+				[body](const InterpolatedBody& interpolated) { return interpolated.mBody == body; }),
+			mInterpolatedBodies.end());
+
+		mDrawnTransforms.erase(
+			std::remove_if(
+				mDrawnTransforms.begin(),
+				mDrawnTransforms.end(),
+				[body](const DrawnTransform& drawn) { return drawn.m_Body == body; }),
+			mDrawnTransforms.end());
+	}
+
 	mEntities.erase(it);
 
 	return true;
 }
 
+void World::OnStaticGeometryChanged(const b2Body& body)
+{
+	mStaticGeometry->UpdateBody(body);
+
+	mPotentiallyVisibleSets->Clear();
+
+	OnBodiesChanged();
+}
+
+void World::OnBodiesChanged()
+{
+	mBodyChanges.m_Revision = NewBodiesRevision();
+
+	// Everything gets looked at next time anyway.
+	ResetMovedBodies();
+}
+
+void World::ResetMovedBodies()
+{
+	mBodyChanges.m_MovedBodies.clear();
+
+	for (const InterpolatedBody& interpolated : mInterpolatedBodies)
+	{
+		mBodyChanges.m_MovedBodies.push_back(interpolated.mBody);
+	}
+}
+
+void World::ComputePotentiallyVisibleSets()
+{
+	PotentiallyVisibleSets::ComputeSettings settings;
+	settings.m_RayLength = mRenderSettings.m_RayLength;
+
+	mPotentiallyVisibleSets->Compute(*mStaticGeometry, settings);
+}
+
 bool World::AddEntity(std::unique_ptr<Entity> entity)
 {
 	assert(entity != nullptr);
@@ -445,6 +721,14 @@ bool World::AddEntity(std::unique_ptr<Entity> entity)
 	if (&entity->GetWorld() != this) return false;
 	if (mEntities.count(entity->GetId()) != 0) return false;
 
+	if (entity->GetPhysics()) {
+		mStaticGeometry->AddBody(entity->GetPhysics()->GetBody());
+
+		if (mStaticGeometry->Contains(entity->GetPhysics()->GetBody())) {
+			mPotentiallyVisibleSets->Clear();
+		}
+	}
+
 	mEntities[entity->GetId()] = std::move(entity);
 
 	return true;
@@ -477,6 +761,8 @@ bool World::ToJson(nlohmann::json & j) const {
 
 	j["RenderSettings"] = mRenderSettings.ToJson();
 
+	j["StepThreadCount"] = m_CustomComponentUpdater.GetThreadCount();
+
 	{
 		b2Vec2 gravity = this->mPhysicsWorld->GetGravity();
 		j["Gravity"] = { gravity.x, gravity.y };
@@ -542,6 +828,8 @@ World::World(
 
 	mRenderSettings = RenderSettings(j.value<nlohmann::json>("RenderSettings", {}));
 
+	m_CustomComponentUpdater.SetThreadCount(j.value<int>("StepThreadCount", 1));
+
 	if (!(j.find("DirectionalLight") != j.end() &&
 		mDirectionalLight.FromJson(j["DirectionalLight"])))
 	{
@@ -706,11 +994,12 @@ bool World::UnregisterDetachedRenderComponent(const RenderComponent& renderCompo
 	return false;
 }
 
-void World::UpdateDetachedRenderComponents(const Camera3D& camera)
+void World::UpdateDetachedRenderComponents()
 {
 	for (auto renderComp : mDetachedRenderComponents) {
-		renderComp.get().UpdateDetachedBodyPosition();
-		renderComp.get().UpdateDetachedBodyRotation(camera.GetRotation());
+		const b2Body& body = renderComp.get().GetEntity().GetPhysics()->GetBody();
+
+		renderComp.get().UpdateBillboardPosition(GetDrawnTransform(body, &mDrawnTransforms).p);
 	}
 }
 
@@ -796,6 +1085,15 @@ void World::GuiControls() {
 
 			mPhysicsWorld->SetGravity(gravity);
 		}
+
+		{
+			// For the CustomComponents whose types are parallel-safe.
+			int stepThreadCount = m_CustomComponentUpdater.GetThreadCount();
+
+			if (ImGui::SliderInt("Step Threads", &stepThreadCount, 1, (int)GetHardwareThreadCount())) {
+				m_CustomComponentUpdater.SetThreadCount(stepThreadCount);
+			}
+		}
 	}
 
 	if (ImGui::CollapsingHeader("Ambient Light")) {
@@ -860,6 +1158,73 @@ void World::GuiControls() {
 		ImGui::AutoIndent indent;
 
 		ImGui::SliderFloat("Ray Length", &mRenderSettings.m_RayLength, 1.0f, 100.0f);
+
+		ImGui::Checkbox("Clamp Ray Length To Fog", &mRenderSettings.m_ClampRayLengthToFog);
+
+		ImGui::SliderFloat("Far Field Distance", &mRenderSettings.m_FarFieldDistance, 0.0f, mRenderSettings.m_RayLength);
+
+		ImGui::SliderInt("Threads", &mRenderSettings.m_ThreadCount, 1, (int)GetHardwareThreadCount());
+
+		{
+			static const int packetSizes[] = { 1, 4, 8, 16 };
+			
+			int current = (int)(std::find(std::begin(packetSizes), std::end(packetSizes), mRenderSettings.m_RayPacketSize) - std::begin(packetSizes));
+			
+			if (ImGui::Combo("Ray Packet Size", &current, "1\0" "4\0" "8\0" "16\0")) {
+				mRenderSettings.m_RayPacketSize = packetSizes[current];
+			}
+		}
+
+		ImGui::Checkbox("Use Static Geometry Grid", &mRenderSettings.m_UseStaticGeometryGrid);
+
+		ImGui::Checkbox("Cull To View", &mRenderSettings.m_CullToView);
+
+		ImGui::Checkbox("Merge Front Faces", &mRenderSettings.m_MergeFrontFaces);
+
+		ImGui::Checkbox("Use Depth Buffer", &mRenderSettings.m_UseDepthBuffer);
+
+		ImGui::Checkbox("Use Texture Atlas", &mRenderSettings.m_UseTextureAtlas);
+
+		ImGui::Checkbox("Use Texture LODs", &mRenderSettings.m_UseTextureLods);
+
+		ImGui::Checkbox("Use Software Rasterizer", &mRenderSettings.m_UseSoftwareRasterizer);
+
+		ImGui::Checkbox("Reuse Columns", &mRenderSettings.m_ReuseColumns);
+
+		if (ImGui::Checkbox("Adaptive Column Stride", &mRenderSettings.m_AdaptiveColumnStride))
+		{
+			sColumnStrideController.Reset();
+			mRenderSettings.m_ColumnStride = 1;
+		}
+
+		if (mRenderSettings.m_AdaptiveColumnStride)
+		{
+			ImGui::SliderFloat("Render Budget (ms)", &mRenderSettings.m_RenderBudgetMs, 1.0f, 33.0f);
+			ImGui::SliderInt("Max Column Stride", &mRenderSettings.m_MaxColumnStride, 1, 8);
+			ImGui::Text("Column Stride: %d", mRenderSettings.m_ColumnStride);
+		}
+		else
+		{
+			ImGui::SliderInt("Column Stride", &mRenderSettings.m_ColumnStride, 1, 8);
+		}
+
+		ImGui::Text(
+			"Static Geometry Grid: %d bodies, %d cells", 
+			mStaticGeometry->GetBodyCount(), 
+			mStaticGeometry->GetCellCount());
+
+		ImGui::Checkbox("Use Potentially Visible Sets", &mRenderSettings.m_UsePotentiallyVisibleSets);
+
+		if (mPotentiallyVisibleSets->IsEmpty()) {
+			ImGui::Text("Potentially Visible Sets: None");
+		}
+		else {
+			ImGui::Text("Potentially Visible Sets: %d cells", mPotentiallyVisibleSets->GetCellCount());
+		}
+
+		if (ImGui::Button("Compute Potentially Visible Sets")) {
+			ComputePotentiallyVisibleSets();
+		}
 	}
 }
 
@@ -913,6 +1278,41 @@ void World::GuiPerformanceInfo()
 			FLT_MAX,
 			FLT_MAX,
 			ImVec2(0, 80));
+
+		ImGui::Text(
+			"Raycast: %d columns cast, %d interpolated, %d lines/quads, %d vertices",
+			sRaycastRenderStats.m_ColumnsCast,
+			sRaycastRenderStats.m_ColumnsInterpolated,
+			sRaycastRenderStats.m_PrimitiveCount,
+			sRaycastRenderStats.m_VertexCount);
+
+		if (sRaycastRenderStats.m_PotentiallyVisibleFixtures > 0)
+		{
+			ImGui::Text(
+				"Raycast: %d static fixtures in the potentially visible set",
+				sRaycastRenderStats.m_PotentiallyVisibleFixtures);
+		}
+
+		if (mRenderSettings.m_CullToView)
+		{
+			ImGui::Text(
+				"Raycast: %d fixtures in view, %d culled",
+				sRaycastRenderStats.m_FixturesInView,
+				sRaycastRenderStats.m_FixturesCulled);
+		}
+
+		ImGui::Text(
+			"Raycast: %d draw calls, %d shader changes, %d texture changes",
+			sRaycastRenderStats.m_DrawCalls,
+			sRaycastRenderStats.m_ShaderChanges,
+			sRaycastRenderStats.m_TextureChanges);
+
+		if (mRenderSettings.m_UseTextureAtlas)
+		{
+			ImGui::Text(
+				"Raycast: %d drawables outside the texture atlas",
+				sRaycastRenderStats.m_DrawablesOutsideAtlas);
+		}
 	}
 
 	if (ImGui::CollapsingHeader("TakeStep"))
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <chrono>
+#include <unordered_map>
 #include <vector>
 
 #include <Box2D/Common/b2Math.h>
 #include <function2.hpp>
+#include <gsl/span>
 #include <json.hpp>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/Texture.hpp>
@@ -15,6 +17,7 @@
 #include "Quiver/Entity/EntityPrefab.h"
 #include "Quiver/Graphics/Fog.h"
 #include "Quiver/Graphics/Light.h"
+#include "Quiver/Graphics/RaycastSceneSnapshot.h"
 #include "Quiver/Graphics/RenderSettings.h"
 #include "Quiver/Graphics/Sky.h"
 #include "Quiver/World/WorldContext.h"
@@ -36,13 +39,17 @@ class ApplicationState;
 class ApplicationStateContext;
 class AudioComponent;
 class AudioLibrary;
+class BillboardStore;
 class Camera2D;
 class Camera3D;
+class ColumnDepthBuffer;
 class CustomComponent;
 class CustomComponentTypeLibrary;
 class Entity;
 class EntityPrefab;
+class PotentiallyVisibleSets;
 class RawInputDevices;
+struct RaycastView;
 class RenderComponent;
 class TextureLibrary;
 class World;
@@ -50,6 +57,10 @@ class WorldContext;
 class WorldRaycastRenderer;
 class WorldUiRenderer;
 
+namespace Physics {
+class StaticGeometryGrid;
+}
+
 bool SaveWorld(
 	const World & world, 
 	const std::string filename);
@@ -80,6 +91,15 @@ public:
 	void SetPaused(const bool paused);
 	bool IsPaused() const { return mPaused; }
 
+	// How far from the start to the end of the last step to draw the bodies that moved in it,
+	// from 0 to 1, for rendering in between steps.
+	void SetRenderInterpolation(const float alpha);
+	float GetRenderInterpolation() const { return mRenderInterpolation; }
+
+	// Where the render interpolation says to draw the bodies that moved in the last step, 
+	// sorted by body. The bodies themselves stay where the step left them.
+	const std::vector<DrawnTransform>& GetDrawnTransforms() const { return mDrawnTransforms; }
+
 	void RenderDebug(
 		sf::RenderTarget& target, 
 		const Camera2D& camera);
@@ -93,6 +113,19 @@ public:
 		const Camera3D& camera,
 		WorldRaycastRenderer& raycastRenderer);
 
+	// Renders every view, sharing the work that doesn't depend on the camera between them.
+	// Each view's target gets its own camera's ground, sky and overlay.
+	void Render3D(
+		const gsl::span<const RaycastView> views,
+		WorldRaycastRenderer& raycastRenderer);
+
+	// Render3D calls this itself. Otherwise, call it once raycastRenderer has finished 
+	// rendering a frame of this World somewhere else (from a RenderSnapshot, say), so that 
+	// the ColumnDepthBuffer, the performance info and the column stride keep up.
+	void OnRendered3D(
+		const WorldRaycastRenderer& raycastRenderer, 
+		const std::chrono::duration<float, std::milli> renderTime);
+
 	void RenderUI(sf::RenderTarget& target);
 
 	Entity* CreateEntity(const b2Shape & shape, const b2Vec2 & position, const float angle = 0.0f);
@@ -112,6 +145,24 @@ public:
 
 	bool RemoveEntityImmediate(const Entity& entity);
 
+	// Call after moving a static body, or changing a body's type or fixtures, so that the 
+	// static geometry grid stays up to date. Throws away the potentially visible sets.
+	// Does OnBodiesChanged too.
+	void OnStaticGeometryChanged(const b2Body& body);
+
+	// Call after creating or destroying a body, moving one outside of a step, or changing
+	// its type, its fixtures or which of them have FixtureRenderData, so that the renderer
+	// looks at every body for changes next time. A body moved during a step has to be 
+	// awake at the end of it, or this has to be called too.
+	void OnBodiesChanged();
+
+	// Which bodies might have moved since the World was last rendered.
+	const BodyChanges& GetBodyChanges() const { return mBodyChanges; }
+
+	// Works out which static geometry can be seen from where, for the raycast renderer. 
+	// Slow, so it's meant to be done in the editor and saved along with the World.
+	void ComputePotentiallyVisibleSets();
+
 	void GuiControls();
 	void GuiPerformanceInfo();
 
@@ -127,7 +178,7 @@ public:
 	bool RegisterDetachedRenderComponent(const RenderComponent& renderComponent);
 	bool UnregisterDetachedRenderComponent(const RenderComponent& renderComponent);
 
-	void UpdateDetachedRenderComponents(const Camera3D& camera);
+	void UpdateDetachedRenderComponents();
 
 	bool RegisterAudioComponent(const AudioComponent& audioComponent);
 	bool UnregisterAudioComponent(const AudioComponent& audioComponent);
@@ -144,9 +195,21 @@ public:
 
 	inline const b2World* GetPhysicsWorld() const { return mPhysicsWorld.get(); }
 
+	inline const Physics::StaticGeometryGrid& GetStaticGeometry() const { return *mStaticGeometry; }
+
+	inline const PotentiallyVisibleSets& GetPotentiallyVisibleSets() const { return *mPotentiallyVisibleSets; }
+	inline       PotentiallyVisibleSets& GetPotentiallyVisibleSets()       { return *mPotentiallyVisibleSets; }
+
+	inline const BillboardStore& GetBillboards() const { return *mBillboards; }
+	inline       BillboardStore& GetBillboards()       { return *mBillboards; }
+
+	// From the last call to Render3D, for the (first) camera it was given. Empty until then.
+	inline const ColumnDepthBuffer& GetColumnDepthBuffer() const { return *mColumnDepthBuffer; }
+
 	AnimatorCollection& GetAnimators() { return mAnimators; }
 	AudioLibrary&    GetAudioLibrary() { return *mAudioLibrary.get(); }
 	TextureLibrary&  GetTextureLibrary() { return *mTextureLibrary.get(); }
+	const TextureLibrary& GetTextureLibrary() const { return *mTextureLibrary.get(); }
 
 	EntityId GetNextEntityId() { 
 		EntityId id = mNextEntityId; 
@@ -166,6 +229,9 @@ public:
 
 	const AmbientLight& GetAmbientLight() const { return mAmbientLight; }
 	const Fog&          GetFog()          const { return mFog; }
+	const Sky&          GetSky()          const { return mSky; }
+
+	const RenderSettings& GetRenderSettings() const { return mRenderSettings; }
 
 	CustomComponentTypeLibrary& GetCustomComponentTypes() const {
 		return mContext.GetCustomComponentTypes();
@@ -196,6 +262,33 @@ private:
 
 	int mStepCount = 0;
 
+	float mRenderInterpolation = 1.0f;
+
+	// Each body that moved in the last step, with its transform from the start and the end.
+	struct InterpolatedBody
+	{
+		const b2Body* mBody;
+		b2Transform mPrevious;
+		b2Transform mCurrent;
+	};
+
+	std::vector<InterpolatedBody> mInterpolatedBodies;
+
+	std::vector<DrawnTransform> mDrawnTransforms;
+
+	void UpdateDrawnTransforms();
+
+	// Filled in at the start of each step, for working out mInterpolatedBodies at the end: 
+	// the awake bodies that move, in body list order, with just mPrevious. Bodies removed 
+	// during the step are set to null.
+	std::vector<InterpolatedBody> mStepStartBodies;
+
+	// Outlives mEntities, whose components tell it when they change the bodies.
+	BodyChanges mBodyChanges;
+
+	// Forgets the moved bodies, except the ones render interpolation still moves.
+	void ResetMovedBodies();
+
 	bool mPaused = false;
 
 	TimePoint mTotalTime = TimePoint(0.0f);
@@ -220,6 +313,11 @@ private:
 	std::unique_ptr<AudioLibrary>      mAudioLibrary;
 	std::unique_ptr<TextureLibrary>    mTextureLibrary;
 
+	std::unique_ptr<Physics::StaticGeometryGrid> mStaticGeometry;
+	std::unique_ptr<PotentiallyVisibleSets>      mPotentiallyVisibleSets;
+	std::unique_ptr<ColumnDepthBuffer>           mColumnDepthBuffer;
+	std::unique_ptr<BillboardStore>              mBillboards;
+
 	std::vector<std::reference_wrapper<Camera3D>>        mCameras;
 	std::vector<std::reference_wrapper<RenderComponent>> mDetachedRenderComponents;
 	std::vector<std::reference_wrapper<AudioComponent>>  mAudioComponents;
@@ -236,4 +334,15 @@ private:
 	ApplicationStateCreator mNextApplicationStateFactory;
 };
 
+// Draws the ground and the sky, for the raycast view to go on top of.
+void RenderBackground3D(
+	sf::RenderTarget& target,
+	const Camera3D& camera,
+	const sf::Color groundColor,
+	const sf::Color skyColor,
+	const AmbientLight& ambientLight,
+	const DirectionalLight& directionalLight,
+	const Fog& fog,
+	const Sky& sky);
+
 }
\ No newline at end of file
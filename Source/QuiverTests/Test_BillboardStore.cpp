@@ -0,0 +1,87 @@
+#include <catch.hpp>
+
+#include <vector>
+
+#include "Quiver/Graphics/BillboardStore.h"
+#include "Quiver/Graphics/FixtureRenderData.h"
+
+using namespace qvr;
+
+TEST_CASE("BillboardStore", "[Graphics]")
+{
+	BillboardStore store;
+
+	FixtureRenderData a, b, c;
+
+	const BillboardId idA = store.Add(a, b2Vec2(0.0f, 5.0f), 0.5f);
+	const BillboardId idB = store.Add(b, b2Vec2(0.0f, 10.0f), 0.5f);
+	const BillboardId idC = store.Add(c, b2Vec2(3.0f, 10.0f), 0.5f);
+
+	REQUIRE(store.GetCount() == 3);
+
+	const b2Vec2 forwards(0.0f, 1.0f);
+
+	auto CastAlongY = [&](const float x)
+	{
+		std::vector<const FixtureRenderData*> hits;
+
+		auto Callback = [&](const int index, const float32)
+		{
+			hits.push_back(&store.GetRenderData(index));
+			return 1.0f;
+		};
+
+		store.RayCast(Callback, b2Vec2(x, 0.0f), b2Vec2(x, 20.0f), forwards, 1.0f);
+
+		return hits;
+	};
+
+	SECTION("Rays hit everything in their way")
+	{
+		REQUIRE(CastAlongY(0.2f).size() == 2);
+		REQUIRE(CastAlongY(3.4f).size() == 1);
+		REQUIRE(CastAlongY(1.5f).empty());
+	}
+
+	SECTION("Billboards face along forwards")
+	{
+		float32 fraction = 0.0f;
+
+		REQUIRE(BillboardStore::RayCast(
+			b2Vec2(0.0f, 0.0f), b2Vec2(0.0f, 20.0f), forwards, b2Vec2(0.4f, 5.0f), 0.5f, 1.0f, fraction));
+		REQUIRE(fraction == Approx(0.25f));
+
+		// Side-on to a ray that's heading along them.
+		REQUIRE(!BillboardStore::RayCast(
+			b2Vec2(0.0f, 5.0f), b2Vec2(20.0f, 5.0f), forwards, b2Vec2(10.0f, 5.0f), 0.5f, 1.0f, fraction));
+	}
+
+	SECTION("Removing one leaves the rest where they were")
+	{
+		store.Remove(idA);
+
+		REQUIRE(!store.Contains(idA));
+		REQUIRE(store.Contains(idB));
+		REQUIRE(store.Contains(idC));
+		REQUIRE(store.GetCount() == 2);
+
+		const auto hits = CastAlongY(3.0f);
+		REQUIRE(hits.size() == 1);
+		REQUIRE(hits[0] == &c);
+
+		// Its id gets used again.
+		REQUIRE(store.Add(a, b2Vec2(0.0f, 5.0f), 0.5f).get() == idA.get());
+	}
+
+	SECTION("Moving one moves where rays hit it")
+	{
+		store.SetPosition(idC, b2Vec2(-3.0f, 10.0f));
+
+		REQUIRE(CastAlongY(3.0f).empty());
+		REQUIRE(CastAlongY(-3.0f).size() == 1);
+
+		store.SetRadius(idC, 2.0f);
+
+		REQUIRE(CastAlongY(-1.2f).size() == 1);
+	}
+}
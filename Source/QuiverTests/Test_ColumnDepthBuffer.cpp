@@ -0,0 +1,79 @@
+#include <catch.hpp>
+
+#include "Quiver/Graphics/Camera3D.h"
+#include "Quiver/Graphics/ColumnDepthBuffer.h"
+
+using namespace qvr;
+
+TEST_CASE("ColumnDepthBuffer", "[Graphics]")
+{
+	ColumnDepthBuffer buffer;
+	buffer.Resize(100);
+
+	// Facing along the y axis.
+	const Camera3D camera(b2Transform(b2Vec2_zero, b2Rot(0.0f)));
+
+	const b2Vec2 ahead = camera.GetForwards();
+	const b2Vec2 across = camera.GetRightwards();
+
+	SECTION("Nothing is hidden in an empty buffer")
+	{
+		REQUIRE(!buffer.IsHidden(camera, 10.0f * ahead));
+	}
+
+	SECTION("A point straight ahead is in the middle column")
+	{
+		float distance = 0.0f;
+		REQUIRE(buffer.GetColumn(camera, 10.0f * ahead, &distance) == 50);
+		REQUIRE(distance == Approx(10.0f));
+	}
+
+	SECTION("Points behind the camera aren't on screen")
+	{
+		REQUIRE(buffer.GetColumn(camera, -10.0f * ahead) == -1);
+		REQUIRE(!buffer.IsHidden(camera, -10.0f * ahead));
+	}
+
+	SECTION("Only points beyond a column's depth are hidden")
+	{
+		for (int column = 0; column < buffer.GetWidth(); column++) {
+			buffer.SetDepth(column, 5.0f);
+		}
+
+		REQUIRE(buffer.IsHidden(camera, 10.0f * ahead));
+		REQUIRE(!buffer.IsHidden(camera, 3.0f * ahead));
+
+		// Far enough to the side to be off screen.
+		REQUIRE(!buffer.IsHidden(camera, 10.0f * ahead + 100.0f * across));
+	}
+
+	SECTION("Only what's between the face's top and bottom is hidden")
+	{
+		buffer.SetHorizon(50.0f);
+
+		buffer.SetDepth(50, 5.0f, 40.0f, 60.0f);
+
+		REQUIRE(buffer.IsHidden(50, 10.0f, 45.0f, 55.0f));
+		REQUIRE(!buffer.IsHidden(50, 10.0f, 30.0f, 55.0f));
+		REQUIRE(!buffer.IsHidden(50, 3.0f, 45.0f, 55.0f));
+
+		// At eye level.
+		REQUIRE(buffer.IsHidden(50, 10.0f));
+
+		buffer.SetDepth(50, 5.0f, 60.0f, 70.0f);
+
+		REQUIRE(!buffer.IsHidden(50, 10.0f));
+	}
+
+	SECTION("A sprite is only hidden if every column it covers hides it")
+	{
+		for (int column = 0; column < buffer.GetWidth(); column++) {
+			buffer.SetDepth(column, 5.0f);
+		}
+
+		buffer.SetDepth(buffer.GetColumn(camera, 10.0f * ahead + 0.5f * across), 20.0f);
+
+		REQUIRE(buffer.IsHidden(camera, 10.0f * ahead, 0.25f));
+		REQUIRE(!buffer.IsHidden(camera, 10.0f * ahead, 1.0f));
+	}
+}
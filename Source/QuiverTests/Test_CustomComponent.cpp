@@ -0,0 +1,183 @@
+#include <catch.hpp>
+
+#include <memory>
+#include <vector>
+
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+
+#include "Quiver/Entity/Entity.h"
+#include "Quiver/Entity/CustomComponent/CustomComponent.h"
+#include "Quiver/Entity/CustomComponent/CustomComponentUpdater.h"
+#include "Quiver/Entity/PhysicsComponent/PhysicsComponentDef.h"
+#include "Quiver/Input/JoystickProvider.h"
+#include "Quiver/Input/Keyboard.h"
+#include "Quiver/Input/Mouse.h"
+#include "Quiver/Input/RawInput.h"
+#include "Quiver/Misc/Logging.h"
+#include "Quiver/World/World.h"
+
+using namespace qvr;
+
+namespace {
+
+class NoKeyboard : public Keyboard {
+public:
+	bool IsDown  (const KeyboardKey) const override { return false; }
+	bool JustDown(const KeyboardKey) const override { return false; }
+	bool JustUp  (const KeyboardKey) const override { return false; }
+};
+
+class NoJoysticks : public JoystickProvider {
+public:
+	const Joystick* GetJoystick(const JoystickIndex) const override { return nullptr; }
+};
+
+// Defers writing its index, twice, to a log they all share.
+class LoggingComponent : public CustomComponent {
+public:
+	LoggingComponent(Entity& entity) : CustomComponent(entity) {}
+
+	void OnStep(const std::chrono::duration<float>) override {
+		// Only its own state. Busy for long enough that the workers share the components out.
+		mSteps++;
+
+		for (int i = 0; i < 100000; i++) {
+			mChecksum = mChecksum * 31u + (unsigned)i;
+		}
+
+		if (firstCommand) {
+			Defer(std::move(firstCommand));
+		}
+
+		Defer([this]() { log->push_back(index); });
+		Defer([this]() { log->push_back(index); });
+	}
+
+	std::string GetTypeName() const override { return "LoggingComponent"; }
+
+	void DeferNow(Command command) { Defer(std::move(command)); }
+
+	std::vector<int>* log = nullptr;
+	int index = 0;
+	// Deferred before the logging, the next time it's stepped.
+	Command firstCommand;
+	int mSteps = 0;
+	unsigned mChecksum = 0;
+};
+
+}
+
+TEST_CASE("CustomComponentUpdater steps parallel-safe components", "[Entity]")
+{
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	CustomComponentType parallelSafeType(
+		"LoggingComponent",
+		[](Entity& entity) { return std::make_unique<LoggingComponent>(entity); });
+
+	parallelSafeType.SetParallelSafe(true);
+
+	const int count = 200;
+
+	std::vector<int> log;
+
+	std::vector<std::unique_ptr<Entity>> entities;
+
+	CustomComponentUpdater updater;
+
+	for (int index = 0; index < count; index++) {
+		entities.push_back(std::make_unique<Entity>(
+			world,
+			PhysicsComponentDef(b2CircleShape(), b2Vec2((float)index, 0.0f), 0.0f)));
+
+		auto component = parallelSafeType.CreateInstance(*entities.back());
+
+		REQUIRE(component->IsParallelSafe());
+
+		auto& logging = static_cast<LoggingComponent&>(*component);
+		logging.log = &log;
+		logging.index = index;
+
+		updater.Register(logging);
+
+		entities.back()->AddCustomComponent(std::move(component));
+	}
+
+	Mouse mouse;
+	NoKeyboard keyboard;
+	NoJoysticks joysticks;
+
+	RawInputDevices devices(mouse, keyboard, joysticks);
+
+	std::vector<int> expectedLog;
+	for (int index = 0; index < count; index++) {
+		expectedLog.push_back(index);
+		expectedLog.push_back(index);
+	}
+
+	SECTION("Deferred commands run in registration order whatever the thread count")
+	{
+		for (const int threadCount : { 1, 4 }) {
+			updater.SetThreadCount(threadCount);
+
+			log.clear();
+
+			updater.Update(std::chrono::duration<float>(1.0f / 60.0f), devices);
+
+			REQUIRE(log == expectedLog);
+		}
+
+		for (const auto& entity : entities) {
+			REQUIRE(static_cast<LoggingComponent*>(entity->GetCustomComponent())->mSteps == 2);
+		}
+	}
+
+	SECTION("Commands deferred by a component removed by an earlier command don't run")
+	{
+		updater.SetThreadCount(4);
+
+		auto& first = static_cast<LoggingComponent&>(*entities[0]->GetCustomComponent());
+		auto& second = static_cast<LoggingComponent&>(*entities[1]->GetCustomComponent());
+
+		// Like World::RemoveEntityImmediate would.
+		first.firstCommand = [&updater, &entities, &second]() {
+			updater.Unregister(second);
+			entities[1].reset();
+		};
+
+		log.clear();
+
+		updater.Update(std::chrono::duration<float>(1.0f / 60.0f), devices);
+
+		REQUIRE(entities[1] == nullptr);
+
+		expectedLog.erase(expectedLog.begin() + 2, expectedLog.begin() + 4);
+
+		REQUIRE(log == expectedLog);
+
+		// And the component that's gone isn't stepped any more.
+		log.clear();
+
+		updater.Update(std::chrono::duration<float>(1.0f / 60.0f), devices);
+
+		REQUIRE(log == expectedLog);
+	}
+
+	SECTION("Outside the parallel phase, Defer runs the command straight away")
+	{
+		auto& logging = static_cast<LoggingComponent&>(*entities.front()->GetCustomComponent());
+
+		bool ran = false;
+
+		logging.DeferNow([&ran]() { ran = true; });
+
+		REQUIRE(ran);
+	}
+}
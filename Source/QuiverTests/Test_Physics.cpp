@@ -1,12 +1,19 @@
 #include <catch.hpp>
 
+#include <algorithm>
+#include <vector>
+
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Dynamics/b2World.h>
 
 #include "Quiver/Entity/Entity.h"
 #include "Quiver/Entity/CustomComponent/CustomComponent.h"
 #include "Quiver/Entity/PhysicsComponent/PhysicsComponent.h"
 #include "Quiver/Entity/PhysicsComponent/PhysicsComponentDef.h"
+#include "Quiver/Physics/PhysicsUtils.h"
+#include "Quiver/Physics/RayCastEntryExit.h"
+#include "Quiver/Physics/StaticGeometryGrid.h"
 #include "Quiver/World/World.h"
 
 using namespace qvr;
@@ -33,4 +40,259 @@ TEST_CASE("PhysicsComponent creation and cleanup", "[Physics]")
 	entity.reset();
 
 	REQUIRE(world.GetPhysicsWorld()->GetBodyCount() == 0);
-}
\ No newline at end of file
+}
+TEST_CASE("RayCastEntryExit", "[Physics]")
+{
+	b2World world(b2Vec2_zero);
+
+	b2BodyDef bodyDef;
+
+	// A 2x2 box centred on (5, 0) and a circle of radius 1 centred on (10, 0).
+	bodyDef.position.Set(5.0f, 0.0f);
+	{
+		b2PolygonShape box;
+		box.SetAsBox(1.0f, 1.0f);
+		world.CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+
+	bodyDef.position.Set(10.0f, 0.0f);
+	{
+		b2CircleShape circle;
+		circle.m_radius = 1.0f;
+		world.CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+	}
+
+	std::vector<Physics::RayCastHit> hits;
+
+	auto callback = [&hits](const Physics::RayCastHit& hit) {
+		hits.push_back(hit);
+		return true;
+	};
+
+	SECTION("Finds the entry and exit points of each fixture")
+	{
+		Physics::RayCastEntryExit(world, callback, b2Vec2(0.0f, 0.0f), b2Vec2(20.0f, 0.0f));
+
+		REQUIRE(hits.size() == 2);
+
+		std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
+			return a.entryFraction < b.entryFraction;
+		});
+
+		REQUIRE(hits[0].fixture->GetType() == b2Shape::e_polygon);
+		REQUIRE(hits[0].entryPoint.x == Approx(4.0f));
+		REQUIRE(hits[0].exitPoint.x == Approx(6.0f));
+
+		REQUIRE(hits[1].fixture->GetType() == b2Shape::e_circle);
+		REQUIRE(hits[1].entryPoint.x == Approx(9.0f));
+		REQUIRE(hits[1].exitPoint.x == Approx(11.0f));
+		REQUIRE(hits[1].exitFraction == Approx(11.0f / 20.0f));
+	}
+
+	SECTION("Exits at the end of the ray if it ends inside a fixture")
+	{
+		Physics::RayCastEntryExit(world, callback, b2Vec2(0.0f, 0.0f), b2Vec2(5.0f, 0.0f));
+
+		REQUIRE(hits.size() == 1);
+		REQUIRE(hits[0].entryPoint.x == Approx(4.0f));
+		REQUIRE(hits[0].exitFraction == Approx(1.0f));
+	}
+
+	SECTION("Returning a fraction from the callback clips the ray")
+	{
+		auto clippingCallback = [&hits](const Physics::RayCastHit& hit) {
+			hits.push_back(hit);
+			return hit.entryFraction;
+		};
+
+		Physics::RayCastEntryExit(world, clippingCallback, b2Vec2(0.0f, 0.0f), b2Vec2(20.0f, 0.0f));
+
+		// The box can't be ruled out until it's been hit, but nothing behind it can be
+		// reported after that.
+		REQUIRE(!hits.empty());
+		REQUIRE(hits.back().fixture->GetType() == b2Shape::e_polygon);
+	}
+
+	SECTION("Nothing beyond maxFraction is reported")
+	{
+		Physics::RayCastEntryExit(world, callback, b2Vec2(0.0f, 0.0f), b2Vec2(20.0f, 0.0f), 0.4f);
+
+		REQUIRE(hits.size() == 1);
+		REQUIRE(hits[0].fixture->GetType() == b2Shape::e_polygon);
+		REQUIRE(hits[0].exitPoint.x == Approx(6.0f));
+	}
+}
+
+TEST_CASE("RayCastEntryExitPacket matches RayCastEntryExit", "[Physics]")
+{
+	b2World world(b2Vec2_zero);
+
+	// A ring of boxes and circles around the origin.
+	for (int i = 0; i < 24; i++) {
+		b2BodyDef bodyDef;
+		const float angle = (b2_pi * 2.0f * i) / 24.0f;
+		bodyDef.position.Set(cosf(angle) * (5.0f + i % 3), sinf(angle) * (5.0f + i % 3));
+		bodyDef.angle = angle;
+
+		b2Body* body = world.CreateBody(&bodyDef);
+
+		if (i % 2) {
+			b2PolygonShape box;
+			box.SetAsBox(0.5f, 0.25f);
+			body->CreateFixture(&box, 1.0f);
+		}
+		else {
+			b2CircleShape circle;
+			circle.m_radius = 0.4f;
+			body->CreateFixture(&circle, 1.0f);
+		}
+	}
+
+	struct Collector {
+		std::vector<std::pair<const b2Fixture*, float32>> hits;
+
+		bool operator()(const Physics::RayCastHit& hit) {
+			hits.push_back({ hit.fixture, hit.entryFraction });
+			return true;
+		}
+	};
+
+	const int rayCount = 256;
+
+	// Includes rays that are exactly horizontal or vertical.
+	std::vector<b2Vec2> rayEnds;
+	for (int i = 0; i < rayCount; i++) {
+		const float angle = (b2_pi * 2.0f * i) / rayCount;
+		rayEnds.push_back(b2Vec2(cosf(angle) * 20.0f, sinf(angle) * 20.0f));
+	}
+
+	const std::vector<b2Vec2> rayStarts(rayCount, b2Vec2_zero);
+
+	for (const int packetSize : { 4, 7, 16 }) {
+		std::vector<Collector> singles(rayCount);
+		std::vector<Collector> packets(rayCount);
+
+		for (int i = 0; i < rayCount; i++) {
+			Physics::RayCastEntryExit(world, singles[i], rayStarts[i], rayEnds[i]);
+		}
+
+		for (int i = 0; i < rayCount; i += packetSize) {
+			Physics::RayCastEntryExitPacket(
+				world, 
+				&packets[i], 
+				&rayStarts[i], 
+				&rayEnds[i], 
+				std::min(packetSize, rayCount - i));
+		}
+
+		for (int i = 0; i < rayCount; i++) {
+			std::sort(singles[i].hits.begin(), singles[i].hits.end());
+			std::sort(packets[i].hits.begin(), packets[i].hits.end());
+
+			REQUIRE(singles[i].hits == packets[i].hits);
+		}
+	}
+}
+
+TEST_CASE("StaticGeometryGrid matches RayCastEntryExit", "[Physics]")
+{
+	b2World world(b2Vec2_zero);
+
+	Physics::StaticGeometryGrid grid(1.5f);
+
+	// The grid only takes bodies with user data (i.e. Entities' bodies), so give them some.
+	int dummyUserData = 0;
+
+	std::vector<b2Body*> bodies;
+
+	for (int x = -6; x <= 6; x++) {
+		for (int y = -6; y <= 6; y++) {
+			if ((x * 7 + y * 3) % 4 != 0) continue;
+
+			b2BodyDef bodyDef;
+			bodyDef.position.Set(x * 2.1f, y * 1.9f);
+			bodyDef.angle = (float)(x + y);
+			bodyDef.userData = &dummyUserData;
+
+			b2Body* body = world.CreateBody(&bodyDef);
+
+			b2PolygonShape box;
+			box.SetAsBox(0.3f + 0.1f * (x & 3), 0.7f);
+			body->CreateFixture(&box, 1.0f);
+
+			grid.AddBody(*body);
+
+			bodies.push_back(body);
+		}
+	}
+
+	REQUIRE(grid.GetBodyCount() == (int)bodies.size());
+
+	struct Collector {
+		std::vector<std::pair<const b2Fixture*, float32>> hits;
+
+		bool operator()(const Physics::RayCastHit& hit) {
+			hits.push_back({ hit.fixture, hit.entryFraction });
+			return true;
+		}
+	};
+
+	auto CompareAll = [&]() {
+		const int rayCount = 200;
+
+		for (int i = 0; i < rayCount; i++) {
+			const float angle = (b2_pi * 2.0f * i) / rayCount;
+			const b2Vec2 start(0.05f, -0.1f);
+			const b2Vec2 end = start + b2Vec2(cosf(angle) * 30.0f, sinf(angle) * 30.0f);
+
+			Collector fromWorld;
+			Collector fromGrid;
+
+			Physics::RayCastEntryExit(world, fromWorld, start, end);
+			grid.RayCast(fromGrid, start, end);
+
+			std::sort(fromWorld.hits.begin(), fromWorld.hits.end());
+			std::sort(fromGrid.hits.begin(), fromGrid.hits.end());
+
+			REQUIRE(fromWorld.hits == fromGrid.hits);
+		}
+	};
+
+	CompareAll();
+
+	SECTION("Moving a body")
+	{
+		bodies[3]->SetTransform(b2Vec2(1.0f, 1.0f), 0.5f);
+		grid.UpdateBody(*bodies[3]);
+
+		CompareAll();
+	}
+
+	SECTION("Removing a body")
+	{
+		grid.RemoveBody(*bodies[5]);
+		world.DestroyBody(bodies[5]);
+
+		REQUIRE(grid.GetBodyCount() == (int)bodies.size() - 1);
+
+		CompareAll();
+	}
+}
+
+TEST_CASE("Interpolating between transforms", "[Physics]")
+{
+	const b2Transform from(b2Vec2(0.0f, 0.0f), b2Rot(b2_pi * 0.9f));
+	const b2Transform to(b2Vec2(2.0f, 4.0f), b2Rot(-b2_pi * 0.9f));
+
+	const b2Transform halfway = Physics::Interpolate(from, to, 0.5f);
+
+	REQUIRE(halfway.p.x == Approx(1.0f));
+	REQUIRE(halfway.p.y == Approx(2.0f));
+
+	// The short way round, through pi rather than through 0.
+	REQUIRE(halfway.q.c == Approx(-1.0f));
+
+	const b2Transform end = Physics::Interpolate(from, to, 1.0f);
+
+	REQUIRE(end.q.GetAngle() == Approx(to.q.GetAngle()));
+}
@@ -0,0 +1,212 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <Box2D/Common/b2Math.h>
+
+#include "Quiver/Graphics/RaycastDrawable.h"
+
+using namespace qvr;
+
+namespace {
+
+// Makes a column's worth of drawables in roughly the order the renderer produces them:
+// sorted by intersection, but with each intersection's top/bottom faces out of order.
+std::vector<RaycastDrawable> MakeColumn(std::mt19937& rng, const int count, const int column) {
+	std::uniform_real_distribution<float> jitter(-1.5f, 1.5f);
+
+	std::vector<RaycastDrawable> drawables(count);
+
+	for (int i = 0; i < count; i++) {
+		RaycastDrawable& d = drawables[i];
+		d = {};
+		d.m_X = (float)column;
+		d.m_DistanceFar = std::max(0.1f, (count - i) * 2.0f + jitter(rng));
+		d.m_DistanceNear = d.m_DistanceFar - 0.5f;
+		d.m_FarY = (float)(i % 3);
+	}
+
+	return drawables;
+}
+
+bool IsBackToFront(const std::vector<RaycastDrawable>& drawables) {
+	return std::is_sorted(drawables.begin(), drawables.end(), IsDrawnBefore);
+}
+
+}
+
+TEST_CASE("SortBackToFront", "[Graphics]") {
+	std::mt19937 rng(1234);
+
+	for (const int count : { 0, 1, 2, 7, 32, 64 }) {
+		auto drawables = MakeColumn(rng, count, 0);
+
+		SortBackToFront(drawables.data(), drawables.data() + drawables.size());
+
+		REQUIRE(IsBackToFront(drawables));
+	}
+
+	SECTION("Reversed input") {
+		auto drawables = MakeColumn(rng, 40, 0);
+
+		std::reverse(drawables.begin(), drawables.end());
+
+		SortBackToFront(drawables.data(), drawables.data() + drawables.size());
+
+		REQUIRE(IsBackToFront(drawables));
+	}
+}
+
+TEST_CASE("MergeFrontFaces stays close to the lines", "[Graphics]") {
+	// One layer of a 320x240 view of a flat wall at an angle, from (-3, 5) to (3, 7), with
+	// a texture 64 texels wide stretched across it. Column x looks along (x - 160) / 160 
+	// across and 1 ahead.
+	const int width = 320;
+	const float base = 120.0f;
+	const b2Vec2 wallStart(-3.0f, 5.0f);
+	const b2Vec2 wallEnd(3.0f, 7.0f);
+
+	std::vector<RaycastDrawable> lines;
+
+	for (int x = 0; x < width; x++) {
+		const b2Vec2 direction(((float)x + 0.5f - width / 2.0f) / (width / 2.0f), 1.0f);
+
+		// Where the ray meets the wall, as a fraction along it.
+		const b2Vec2 along = wallEnd - wallStart;
+		const float denominator = b2Cross(direction, along);
+		const float t = b2Cross(wallStart, direction) / denominator;
+
+		if (t < 0.0f || t > 1.0f) continue;
+
+		const float distance = (wallStart + t * along).y;
+
+		RaycastDrawable line = {};
+		line.m_X = (float)x;
+		line.m_DistanceNear = distance;
+		line.m_DistanceFar = distance + 0.5f;
+		line.m_Top = base - base / distance;
+		line.m_Bottom = base + base / distance;
+		line.m_U = t * 64.0f;
+		line.m_VTop = 0.0f;
+		line.m_VBottom = 64.0f;
+		line.m_BlendColor = sf::Color::White;
+		line.m_DrawFront = true;
+		lines.push_back(line);
+	}
+
+	REQUIRE(lines.size() > 100);
+
+	auto merged = lines;
+	std::vector<RaycastFrontQuad> quads;
+
+	MergeFrontFaces(merged, quads, std::numeric_limits<float>::max());
+
+	REQUIRE(!quads.empty());
+
+	// Every column's front face is drawn once, either as its line or as part of a quad.
+	std::vector<int> drawnCount(width, 0);
+
+	for (const RaycastDrawable& drawable : merged) {
+		if (drawable.m_DrawFront) drawnCount[(int)drawable.m_X]++;
+	}
+
+	for (const RaycastFrontQuad& quad : quads) {
+		for (int x = (int)quad.m_Left; x < (int)quad.m_Right; x++) {
+			drawnCount[x]++;
+
+			const auto line = std::find_if(lines.begin(), lines.end(), 
+				[x](const RaycastDrawable& line) { return line.m_X == (float)x; });
+
+			REQUIRE(line != lines.end());
+
+			// The quad's values where it covers the middle of the column. Screen position 
+			// interpolates linearly, and texture coordinates perspective-correctly.
+			const float f = ((float)x + 0.5f - quad.m_Left) / (quad.m_Right - quad.m_Left);
+
+			const float top = quad.m_TopLeft + f * (quad.m_TopRight - quad.m_TopLeft);
+			const float bottom = quad.m_BottomLeft + f * (quad.m_BottomRight - quad.m_BottomLeft);
+
+			const float inverseLeft = 1.0f / quad.m_DistanceLeft;
+			const float inverseRight = 1.0f / quad.m_DistanceRight;
+			const float inverseDistance = inverseLeft + f * (inverseRight - inverseLeft);
+
+			const float uOverDistance = 
+				quad.m_ULeft * inverseLeft + f * (quad.m_URight * inverseRight - quad.m_ULeft * inverseLeft);
+
+			const float u = uOverDistance / inverseDistance;
+
+			REQUIRE(std::abs(top - line->m_Top) <= 0.26f);
+			REQUIRE(std::abs(bottom - line->m_Bottom) <= 0.26f);
+			REQUIRE(std::abs(1.0f / inverseDistance - line->m_DistanceNear) <= 1e-2f * line->m_DistanceNear);
+			REQUIRE(std::abs(u - line->m_U) <= 0.3f);
+		}
+	}
+
+	for (const RaycastDrawable& line : lines) {
+		REQUIRE(drawnCount[(int)line.m_X] == 1);
+	}
+}
+
+// Hidden; run with "[Benchmark]" to compare sorting every column's drawables together 
+// (as the renderer used to) against sorting each column on its own.
+TEST_CASE("Benchmark: global vs per-column drawable sort", "[.][Benchmark][Graphics]") {
+	using Clock = std::chrono::high_resolution_clock;
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+
+	const int drawablesPerColumn = 12;
+	const int iterations = 20;
+
+	for (const int columnCount : { 1920, 3840 }) {
+		std::mt19937 rng(columnCount);
+
+		std::vector<std::vector<RaycastDrawable>> columns;
+		for (int column = 0; column < columnCount; column++) {
+			columns.push_back(MakeColumn(rng, drawablesPerColumn, column));
+		}
+
+		Milliseconds globalTime(0);
+		Milliseconds perColumnTime(0);
+
+		for (int i = 0; i < iterations; i++) {
+			{
+				auto copy = columns;
+
+				const auto start = Clock::now();
+
+				std::vector<RaycastDrawable> all;
+				for (const auto& column : copy) {
+					all.insert(all.end(), column.begin(), column.end());
+				}
+
+				std::sort(all.begin(), all.end(), IsDrawnBefore);
+
+				globalTime += Clock::now() - start;
+
+				REQUIRE(IsBackToFront(all));
+			}
+
+			{
+				auto copy = columns;
+
+				const auto start = Clock::now();
+
+				for (auto& column : copy) {
+					SortBackToFront(column.data(), column.data() + column.size());
+				}
+
+				perColumnTime += Clock::now() - start;
+
+				REQUIRE(IsBackToFront(copy.front()));
+			}
+		}
+
+		WARN(columnCount << " columns x " << drawablesPerColumn << " drawables: "
+			<< "global sort " << (globalTime.count() / iterations) << "ms, "
+			<< "per-column sort " << (perColumnTime.count() / iterations) << "ms");
+	}
+}
@@ -0,0 +1,166 @@
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "Quiver/Graphics/RaycastDrawable.h"
+#include "Quiver/Graphics/SoftwareRasterizer.h"
+#include "Quiver/Misc/WorkerPool.h"
+
+using namespace qvr;
+
+namespace {
+
+RaycastDrawable MakeFront(const int x, const float top, const float bottom, const sf::Color& color) {
+	RaycastDrawable d = {};
+	d.m_X = (float)x;
+	d.m_Top = top;
+	d.m_Bottom = bottom;
+	d.m_DistanceNear = 1.0f;
+	d.m_DistanceFar = 1.0f;
+	d.m_VTop = 0.0f;
+	d.m_VBottom = bottom - top;
+	d.m_BlendColor = color;
+	d.m_Normal = sf::Vector3f(-1.0f, 0.0f, 0.0f);
+	d.m_DrawFront = true;
+	return d;
+}
+
+bool IsClose(const sf::Color& a, const sf::Color& b) {
+	return
+		std::abs(a.r - b.r) <= 1 &&
+		std::abs(a.g - b.g) <= 1 &&
+		std::abs(a.b - b.b) <= 1 &&
+		std::abs(a.a - b.a) <= 1;
+}
+
+}
+
+TEST_CASE("SoftwareRasterizer", "[Graphics]") {
+	SoftwareFramebuffer framebuffer;
+	framebuffer.Resize(4, 8);
+
+	SoftwareRasterizer rasterizer;
+
+	const sf::Color transparent(0, 0, 0, 0);
+	const sf::Color white(255, 255, 255, 255);
+
+	SECTION("Front faces cover the pixels whose centres they pass through") {
+		const RaycastDrawable d = MakeFront(1, 2.0f, 5.0f, white);
+
+		rasterizer.RasterizeColumn(framebuffer, &d, &d + 1);
+
+		for (int y = 0; y < framebuffer.GetHeight(); y++) {
+			INFO("y = " << y);
+			REQUIRE(IsClose(framebuffer.GetPixel(1, y), (y >= 2 && y < 5) ? white : transparent));
+			REQUIRE(IsClose(framebuffer.GetPixel(0, y), transparent));
+			REQUIRE(IsClose(framebuffer.GetPixel(2, y), transparent));
+		}
+	}
+
+	SECTION("Fog and light are added on top of the blend colour") {
+		RaycastShading shading;
+		shading.m_AmbientLightColor = sf::Color(128, 128, 128, 255);
+		shading.m_FogColor = sf::Color(255, 0, 0, 255);
+		shading.m_FogMinDistance = 0.0f;
+		shading.m_FogMaxDistance = 2.0f;
+		shading.m_FogMaxIntensity = 1.0f;
+		shading.m_DirectionalLightDirection = sf::Vector3f(1.0f, 0.0f, 0.0f);
+		shading.m_DirectionalLightColor = sf::Color(0, 0, 64, 0);
+
+		rasterizer.SetShading(shading);
+
+		// Half way into the fog, facing the light head-on.
+		const RaycastDrawable d = MakeFront(0, 0.0f, 8.0f, white);
+
+		rasterizer.RasterizeColumn(framebuffer, &d, &d + 1);
+
+		REQUIRE(IsClose(framebuffer.GetPixel(0, 4), sf::Color(255, 128, 192, 255)));
+	}
+
+	SECTION("Drawables are blended over the ones before them") {
+		const RaycastDrawable drawables[] = {
+			MakeFront(3, 0.0f, 8.0f, sf::Color(0, 0, 255, 255)),
+			MakeFront(3, 0.0f, 4.0f, sf::Color(255, 0, 0, 128))
+		};
+
+		rasterizer.RasterizeColumn(framebuffer, std::begin(drawables), std::end(drawables));
+
+		REQUIRE(IsClose(framebuffer.GetPixel(3, 2), sf::Color(128, 0, 127, 255)));
+		REQUIRE(IsClose(framebuffer.GetPixel(3, 6), sf::Color(0, 0, 255, 255)));
+	}
+
+	SECTION("Textures are sampled with texel coordinates") {
+		// 2x2: red, green / blue, white.
+		const sf::Uint8 pixels[] = {
+			255, 0, 0, 255,    0, 255, 0, 255,
+			0, 0, 255, 255,    255, 255, 255, 255
+		};
+
+		// Any non-null pointer will do as the key.
+		const sf::Texture* texture = reinterpret_cast<const sf::Texture*>(&pixels);
+
+		rasterizer.SetTexture(texture, SoftwareTexture{ pixels, 2, 2 });
+
+		RaycastDrawable d = MakeFront(2, 0.0f, 8.0f, white);
+		d.m_Texture = texture;
+		d.m_U = 1.5f;
+		d.m_VTop = 0.0f;
+		d.m_VBottom = 2.0f;
+
+		rasterizer.RasterizeColumn(framebuffer, &d, &d + 1);
+
+		REQUIRE(IsClose(framebuffer.GetPixel(2, 1), sf::Color(0, 255, 0, 255)));
+		REQUIRE(IsClose(framebuffer.GetPixel(2, 6), white));
+	}
+}
+
+// Hidden; run with "[Benchmark]" to see how long filling a screen takes.
+TEST_CASE("Benchmark: SoftwareRasterizer", "[.][Benchmark][Graphics]") {
+	using Clock = std::chrono::high_resolution_clock;
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+
+	const int width = 1920;
+	const int height = 1080;
+	const int drawablesPerColumn = 4;
+	const int iterations = 20;
+
+	std::vector<std::vector<RaycastDrawable>> columns(width);
+
+	for (int x = 0; x < width; x++) {
+		for (int i = 0; i < drawablesPerColumn; i++) {
+			const float inset = i * 100.0f;
+			columns[x].push_back(MakeFront(x, inset, height - inset, sf::Color(255, 255, 255, 200)));
+		}
+	}
+
+	SoftwareFramebuffer framebuffer;
+	framebuffer.Resize(width, height);
+
+	SoftwareRasterizer rasterizer;
+
+	for (const unsigned threadCount : { 1u, GetHardwareThreadCount() }) {
+		WorkerPool pool(threadCount);
+
+		const auto start = Clock::now();
+
+		for (int i = 0; i < iterations; i++) {
+			framebuffer.Clear();
+
+			pool.ParallelFor(width, 32, [&](const int begin, const int end, const int) {
+				for (int x = begin; x < end; x++) {
+					rasterizer.RasterizeColumn(
+						framebuffer,
+						columns[x].data(),
+						columns[x].data() + columns[x].size());
+				}
+			});
+		}
+
+		const Milliseconds time = Clock::now() - start;
+
+		WARN(width << "x" << height << ", " << drawablesPerColumn << " drawables per column, "
+			<< threadCount << " threads: " << (time.count() / iterations) << "ms");
+	}
+}
@@ -0,0 +1,35 @@
+#include <catch.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "Quiver/Misc/TaskThread.h"
+
+using namespace qvr;
+
+TEST_CASE("TaskThread", "[Misc]") {
+	TaskThread thread;
+
+	REQUIRE_FALSE(thread.IsBusy());
+
+	// Nothing to wait for yet.
+	thread.Wait();
+
+	std::vector<int> order;
+	std::thread::id taskThreadId;
+
+	for (int task = 0; task < 3; task++) {
+		// Starting the next one waits for the last, so they never overlap.
+		thread.Start([&order, &taskThreadId, task]() {
+			taskThreadId = std::this_thread::get_id();
+			order.push_back(task);
+		});
+	}
+
+	thread.Wait();
+
+	REQUIRE_FALSE(thread.IsBusy());
+	const std::vector<int> expectedOrder{ 0, 1, 2 };
+	REQUIRE(order == expectedOrder);
+	REQUIRE(taskThreadId != std::this_thread::get_id());
+}
@@ -0,0 +1,55 @@
+#include <catch.hpp>
+
+#include <vector>
+
+#include "Quiver/Graphics/TextureAtlas.h"
+
+using namespace qvr;
+
+TEST_CASE("TextureAtlas::Pack", "[Graphics]")
+{
+	const unsigned pageSize = 64;
+
+	std::vector<sf::Vector2u> sizes;
+
+	for (unsigned i = 0; i < 20; i++) {
+		sizes.push_back(sf::Vector2u(10 + (i * 7) % 23, 8 + (i * 5) % 19));
+	}
+
+	// Too big to go on any page.
+	sizes.push_back(sf::Vector2u(pageSize + 1, 4));
+
+	int pageCount = 0;
+	const std::vector<TextureAtlas::Placement> placements =
+		TextureAtlas::Pack(sizes, pageSize, pageCount);
+
+	REQUIRE(placements.size() == sizes.size());
+
+	// There's more than one page's worth.
+	REQUIRE(pageCount > 1);
+
+	REQUIRE(placements.back().m_Page == -1);
+
+	for (int a = 0; a < (int)sizes.size() - 1; a++) {
+		const TextureAtlas::Placement& pa = placements[a];
+
+		REQUIRE(pa.m_Page >= 0);
+		REQUIRE(pa.m_Page < pageCount);
+		REQUIRE(pa.m_X + sizes[a].x <= pageSize);
+		REQUIRE(pa.m_Y + sizes[a].y <= pageSize);
+
+		for (int b = a + 1; b < (int)sizes.size() - 1; b++) {
+			const TextureAtlas::Placement& pb = placements[b];
+
+			if (pa.m_Page != pb.m_Page) continue;
+
+			const bool apart =
+				pa.m_X + sizes[a].x <= pb.m_X ||
+				pb.m_X + sizes[b].x <= pa.m_X ||
+				pa.m_Y + sizes[a].y <= pb.m_Y ||
+				pb.m_Y + sizes[b].y <= pa.m_Y;
+
+			REQUIRE(apart);
+		}
+	}
+}
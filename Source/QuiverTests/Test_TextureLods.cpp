@@ -0,0 +1,36 @@
+#include <catch.hpp>
+
+#include <SFML/Graphics/Image.hpp>
+
+#include "Quiver/Graphics/TextureLods.h"
+
+using namespace qvr;
+
+TEST_CASE("TextureLods::Downsample", "[Graphics]")
+{
+	sf::Image image;
+	image.create(5, 2, sf::Color::Transparent);
+
+	// Half red, half see-through.
+	image.setPixel(0, 0, sf::Color(255, 0, 0, 255));
+	image.setPixel(1, 1, sf::Color(255, 0, 0, 255));
+
+	// Solid, but different shades.
+	image.setPixel(2, 0, sf::Color(0, 0, 100, 255));
+	image.setPixel(3, 0, sf::Color(0, 0, 200, 255));
+	image.setPixel(2, 1, sf::Color(0, 0, 100, 255));
+	image.setPixel(3, 1, sf::Color(0, 0, 200, 255));
+
+	const sf::Image half = TextureLods::Downsample(image);
+
+	REQUIRE(half.getSize() == sf::Vector2u(2, 1));
+
+	// The see-through pixels don't darken the red.
+	REQUIRE(half.getPixel(0, 0) == sf::Color(255, 0, 0, 127));
+
+	REQUIRE(half.getPixel(1, 0) == sf::Color(0, 0, 150, 255));
+
+	const sf::Image quarter = TextureLods::Downsample(half);
+
+	REQUIRE(quarter.getSize() == sf::Vector2u(1, 1));
+}
@@ -0,0 +1,46 @@
+#include <catch.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "Quiver/Misc/WorkerPool.h"
+
+using namespace qvr;
+
+TEST_CASE("WorkerPool", "[Misc]") {
+	for (const unsigned threadCount : { 1u, 2u, 4u }) {
+		WorkerPool pool(threadCount);
+
+		REQUIRE(pool.GetThreadCount() == threadCount);
+
+		const int count = 1000;
+
+		std::vector<std::atomic<int>> visits(count);
+		for (auto& v : visits) v = 0;
+
+		std::atomic<bool> badWorkerIndex(false);
+
+		// Run it a few times to make sure the pool can be reused.
+		for (int run = 0; run < 3; run++) {
+			pool.ParallelFor(count, 7, [&](const int begin, const int end, const int workerIndex) {
+				if (workerIndex < 0 || workerIndex >= (int)threadCount) {
+					badWorkerIndex = true;
+				}
+				for (int i = begin; i < end; i++) {
+					visits[i]++;
+				}
+			});
+		}
+
+		REQUIRE_FALSE(badWorkerIndex);
+
+		for (auto& v : visits) {
+			REQUIRE(v == 3);
+		}
+
+		// Nothing to do, so the function shouldn't get called.
+		bool called = false;
+		pool.ParallelFor(0, 16, [&](int, int, int) { called = true; });
+		REQUIRE_FALSE(called);
+	}
+}
@@ -0,0 +1,876 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include "Quiver/Entity/Entity.h"
+#include "Quiver/Entity/CustomComponent/CustomComponent.h"
+#include "Quiver/Entity/PhysicsComponent/PhysicsComponent.h"
+#include "Quiver/Entity/RenderComponent/RenderComponent.h"
+#include "Quiver/Graphics/Camera3D.h"
+#include "Quiver/Graphics/ColumnDepthBuffer.h"
+#include "Quiver/Graphics/ColumnStrideController.h"
+#include "Quiver/Graphics/FixtureRenderData.h"
+#include "Quiver/Graphics/PotentiallyVisibleSets.h"
+#include "Quiver/Graphics/RaycastSceneSnapshot.h"
+#include "Quiver/Graphics/RenderSettings.h"
+#include "Quiver/Graphics/RenderSnapshot.h"
+#include "Quiver/Graphics/SoftwareRasterizer.h"
+#include "Quiver/Graphics/WorldRaycastRenderer.h"
+#include "Quiver/Input/JoystickProvider.h"
+#include "Quiver/Input/Keyboard.h"
+#include "Quiver/Input/Mouse.h"
+#include "Quiver/Input/RawInput.h"
+#include "Quiver/Misc/Logging.h"
+#include "Quiver/Physics/StaticGeometryGrid.h"
+#include "Quiver/World/World.h"
+
+using namespace qvr;
+
+namespace {
+
+sf::Image Render(
+	WorldRaycastRenderer& renderer, 
+	const World& world, 
+	const Camera3D& camera, 
+	const RenderSettings& settings) 
+{
+	sf::RenderTexture target;
+	target.create(320, 240);
+	target.clear();
+
+	renderer.Render(world, camera, settings, target);
+
+	target.display();
+
+	return target.getTexture().copyToImage();
+}
+
+// Doesn't need OpenGL, as long as nothing in the World has a texture.
+SoftwareFramebuffer RenderSoftware(
+	WorldRaycastRenderer& renderer, 
+	const World& world, 
+	const Camera3D& camera, 
+	const RenderSettings& settings) 
+{
+	SoftwareFramebuffer target;
+	target.Resize(320, 240);
+
+	renderer.Render(world, camera, settings, target);
+
+	return target;
+}
+
+// Whether anything was drawn in each column.
+std::vector<bool> GetDrawnColumns(const SoftwareFramebuffer& framebuffer) {
+	std::vector<bool> drawn(framebuffer.GetWidth(), false);
+
+	for (int x = 0; x < framebuffer.GetWidth(); x++) {
+		for (int y = 0; y < framebuffer.GetHeight(); y++) {
+			if (framebuffer.GetPixel(x, y).a != 0) {
+				drawn[x] = true;
+				break;
+			}
+		}
+	}
+
+	return drawn;
+}
+
+int CountDifferentPixels(const sf::Image& a, const sf::Image& b, const int tolerance) {
+	int count = 0;
+
+	for (unsigned y = 0; y < a.getSize().y; y++) {
+		for (unsigned x = 0; x < a.getSize().x; x++) {
+			const sf::Color ca = a.getPixel(x, y);
+			const sf::Color cb = b.getPixel(x, y);
+
+			if (std::abs(ca.r - cb.r) > tolerance ||
+				std::abs(ca.g - cb.g) > tolerance ||
+				std::abs(ca.b - cb.b) > tolerance)
+			{
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+bool SamePicture(const SoftwareFramebuffer& a, const SoftwareFramebuffer& b) {
+	const auto pixelCount = a.GetWidth() * a.GetHeight() * 4;
+
+	return a.GetWidth() == b.GetWidth()
+		&& a.GetHeight() == b.GetHeight()
+		&& std::equal(a.GetPixels(), a.GetPixels() + pixelCount, b.GetPixels());
+}
+
+class NoKeyboard : public Keyboard {
+public:
+	bool IsDown  (const KeyboardKey) const override { return false; }
+	bool JustDown(const KeyboardKey) const override { return false; }
+	bool JustUp  (const KeyboardKey) const override { return false; }
+};
+
+class NoJoysticks : public JoystickProvider {
+public:
+	const Joystick* GetJoystick(const JoystickIndex) const override { return nullptr; }
+};
+
+void AddBoxes(World& world) {
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	const b2Vec2 positions[] = { { 5.0f, 0.0f }, { 7.0f, -2.0f }, { 4.0f, 2.5f }, { 9.0f, 1.0f } };
+	const float angles[] = { 0.0f, 0.4f, -0.7f, 1.2f };
+
+	for (int i = 0; i < 4; i++) {
+		Entity* entity = world.CreateEntity(box, positions[i], angles[i]);
+		REQUIRE(entity);
+		entity->AddGraphics();
+	}
+}
+
+}
+
+TEST_CASE("RaycastSceneSnapshot", "[Graphics]") {
+	b2World world(b2Vec2_zero);
+
+	FixtureRenderData renderData;
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	auto CreateBox = [&](const b2Vec2& position) {
+		b2BodyDef bodyDef;
+		bodyDef.position = position;
+		b2Body* body = world.CreateBody(&bodyDef);
+		body->CreateFixture(&box, 1.0f)->SetUserData(&renderData);
+		return body;
+	};
+
+	b2Body* a = CreateBox(b2Vec2(0.0f, 0.0f));
+	b2Body* b = CreateBox(b2Vec2(5.0f, 0.0f));
+
+	// Fixtures without render data are ignored.
+	CreateBox(b2Vec2(10.0f, 0.0f))->GetFixtureList()->SetUserData(nullptr);
+
+	RaycastSceneSnapshot snapshot;
+
+	snapshot.Update(world);
+
+	REQUIRE(snapshot.GetChangedRegions().size() == 2);
+
+	snapshot.Update(world);
+
+	REQUIRE(snapshot.GetChangedRegions().empty());
+
+	SECTION("Moving a body gives where it was and where it is") {
+		a->SetTransform(b2Vec2(2.0f, 0.0f), 0.0f);
+
+		snapshot.Update(world);
+
+		const auto& regions = snapshot.GetChangedRegions();
+
+		REQUIRE(regions.size() == 2);
+		REQUIRE(regions[0].GetCenter() == b2Vec2(0.0f, 0.0f));
+		REQUIRE(regions[1].GetCenter() == b2Vec2(2.0f, 0.0f));
+	}
+
+	SECTION("Removing a body gives where it was") {
+		world.DestroyBody(b);
+
+		snapshot.Update(world);
+
+		const auto& regions = snapshot.GetChangedRegions();
+
+		REQUIRE(regions.size() == 1);
+		REQUIRE(regions[0].GetCenter() == b2Vec2(5.0f, 0.0f));
+	}
+
+	SECTION("Clear makes everything count as added") {
+		snapshot.Clear();
+		snapshot.Update(world);
+
+		REQUIRE(snapshot.GetChangedRegions().size() == 2);
+	}
+
+	SECTION("With BodyChanges, only the bodies that might have moved are looked at") {
+		BodyChanges changes;
+		changes.m_Revision = 1;
+
+		// The first time, everything is.
+		snapshot.Update(world, nullptr, &changes);
+
+		REQUIRE(snapshot.GetChangedRegions().empty());
+
+		changes.m_RenderCount++;
+		changes.m_MovedBodies.push_back(b);
+
+		a->SetTransform(b2Vec2(2.0f, 0.0f), 0.0f);
+		b->SetTransform(b2Vec2(7.0f, 0.0f), 0.0f);
+
+		snapshot.Update(world, nullptr, &changes);
+
+		{
+			const auto& regions = snapshot.GetChangedRegions();
+
+			REQUIRE(regions.size() == 2);
+			REQUIRE(regions[0].GetCenter() == b2Vec2(5.0f, 0.0f));
+			REQUIRE(regions[1].GetCenter() == b2Vec2(7.0f, 0.0f));
+		}
+
+		// A new revision means anything could have changed.
+		changes.m_Revision++;
+
+		snapshot.Update(world, nullptr, &changes);
+
+		{
+			const auto& regions = snapshot.GetChangedRegions();
+
+			REQUIRE(regions.size() == 2);
+			REQUIRE(regions[0].GetCenter() == b2Vec2(0.0f, 0.0f));
+			REQUIRE(regions[1].GetCenter() == b2Vec2(2.0f, 0.0f));
+		}
+	}
+}
+
+TEST_CASE("ColumnStrideController", "[Graphics]") {
+	using Milliseconds = Profiler::SampleUnit;
+
+	ColumnStrideController controller;
+
+	const Milliseconds budget(10.0f);
+	const int maxStride = 4;
+
+	REQUIRE(controller.GetStride() == 1);
+
+	// Pretend the render time is proportional to the number of columns cast.
+	auto Simulate = [&](const float msPerStride1, const int frames) {
+		for (int i = 0; i < frames; i++) {
+			controller.AddSample(Milliseconds(msPerStride1 / controller.GetStride()), budget, maxStride);
+		}
+	};
+
+	SECTION("Stays put within budget") {
+		Simulate(5.0f, 100);
+		REQUIRE(controller.GetStride() == 1);
+	}
+
+	SECTION("Goes up until it's within budget") {
+		Simulate(25.0f, 100);
+		REQUIRE(controller.GetStride() == 3);
+	}
+
+	SECTION("Stops at the maximum") {
+		Simulate(100.0f, 100);
+		REQUIRE(controller.GetStride() == maxStride);
+	}
+
+	SECTION("Comes back down when things get cheaper") {
+		Simulate(25.0f, 100);
+		Simulate(5.0f, 100);
+		REQUIRE(controller.GetStride() == 1);
+	}
+}
+
+TEST_CASE("PotentiallyVisibleSets", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	auto AddBox = [&world](const b2Vec2& position, const b2Vec2& halfSize, const float height, const bool opaque) {
+		b2PolygonShape box;
+		box.SetAsBox(halfSize.x, halfSize.y);
+		Entity* entity = world.CreateEntity(box, position);
+		REQUIRE(entity);
+		entity->AddGraphics();
+		entity->GetGraphics()->SetHeight(height);
+		entity->GetGraphics()->SetOpaque(opaque);
+		return entity->GetPhysics()->GetBody().GetFixtureList();
+	};
+
+	// A long opaque wall, with a box in front of it and a short and a tall box behind it.
+	const b2Fixture* wall = AddBox(b2Vec2(5.0f, 0.0f), b2Vec2(0.5f, 20.0f), 1.0f, true);
+	const b2Fixture* inFront = AddBox(b2Vec2(-6.0f, 0.0f), b2Vec2(0.5f, 0.5f), 1.0f, false);
+	const b2Fixture* shortBehind = AddBox(b2Vec2(10.0f, 0.0f), b2Vec2(0.5f, 0.5f), 1.0f, false);
+	const b2Fixture* tallBehind = AddBox(b2Vec2(12.0f, 0.0f), b2Vec2(0.5f, 0.5f), 3.0f, false);
+
+	PotentiallyVisibleSets::ComputeSettings settings;
+	settings.m_CellSize = 4.0f;
+
+	PotentiallyVisibleSets sets;
+	sets.Compute(world.GetStaticGeometry(), settings);
+
+	const auto IsVisible = [](const std::vector<Physics::FixtureChild>& set, const b2Fixture* fixture) {
+		return std::any_of(set.begin(), set.end(), [fixture](const Physics::FixtureChild& child) {
+			return child.fixture == fixture;
+		});
+	};
+
+	const b2Vec2 cameraPosition(2.0f, 1.0f);
+
+	const auto visible = sets.GetVisibleFixtures(cameraPosition, settings.m_RayLength);
+
+	REQUIRE(visible);
+	REQUIRE(IsVisible(*visible, wall));
+	REQUIRE(IsVisible(*visible, inFront));
+	REQUIRE(IsVisible(*visible, tallBehind));
+	REQUIRE_FALSE(IsVisible(*visible, shortBehind));
+
+	nlohmann::json j;
+	REQUIRE(sets.ToJson(j));
+
+	SECTION("Loading gives the same sets") {
+		PotentiallyVisibleSets loaded;
+		REQUIRE(loaded.FromJson(j, world.GetStaticGeometry()));
+
+		REQUIRE(loaded.GetCellCount() == sets.GetCellCount());
+		REQUIRE(loaded.GetVisibleFixtures(cameraPosition, settings.m_RayLength)->size() == visible->size());
+	}
+
+	SECTION("They can't be used with longer rays than they were worked out for") {
+		REQUIRE_FALSE(sets.GetVisibleFixtures(cameraPosition, settings.m_RayLength + 1.0f));
+	}
+
+	SECTION("What can only be seen through a gap narrower than the rays are apart is kept") {
+		// Two walls end to end, with a slit between them that none of the sample points 
+		// line up with.
+		AddBox(b2Vec2(-10.0f, -8.85f), b2Vec2(0.5f, 11.15f), 1.0f, true);
+		AddBox(b2Vec2(-10.0f, 11.155f), b2Vec2(0.5f, 8.845f), 1.0f, true);
+		const b2Fixture* throughGap = AddBox(b2Vec2(-17.0f, 2.305f), b2Vec2(0.5f, 0.5f), 1.0f, false);
+
+		sets.Compute(world.GetStaticGeometry(), settings);
+
+		const auto withGap = sets.GetVisibleFixtures(b2Vec2(-6.0f, 2.305f), settings.m_RayLength);
+
+		REQUIRE(withGap);
+		REQUIRE(IsVisible(*withGap, throughGap));
+	}
+
+	SECTION("Loading fails once the static geometry has moved") {
+		b2Body* body = const_cast<b2Body*>(shortBehind->GetBody());
+		body->SetTransform(b2Vec2(10.0f, 1.0f), 0.0f);
+		world.OnStaticGeometryChanged(*body);
+
+		PotentiallyVisibleSets loaded;
+		REQUIRE_FALSE(loaded.FromJson(j, world.GetStaticGeometry()));
+		REQUIRE(loaded.IsEmpty());
+	}
+}
+
+TEST_CASE("Interpolated columns don't miss what's between the cast ones", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	// Looking along the y axis.
+	const Camera3D camera(b2Transform(b2Vec2_zero, b2Rot(0.0f)));
+
+	WorldRaycastRenderer renderer;
+
+	RenderSettings settings;
+
+	const int stride = 4;
+
+	// Make room for the column depth buffer.
+	RenderSoftware(renderer, world, camera, settings);
+
+	// A pillar much thinner than a column, in the middle of one half way between two 
+	// columns that get cast.
+	const ColumnDepthBuffer& columns = renderer.GetColumnDepthBuffer();
+	const int column = columns.GetWidth() / 2 + stride / 2;
+
+	float minX = 1.0f;
+	float maxX = -1.0f;
+
+	for (float x = -1.0f; x < 1.0f; x += 0.0001f) {
+		if (columns.GetColumn(camera, b2Vec2(x, 5.0f)) == column) {
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+		}
+	}
+
+	const b2Vec2 position(0.5f * (minX + maxX), 5.0f);
+
+	REQUIRE(columns.GetColumn(camera, position) == column);
+
+	b2PolygonShape pillar;
+	pillar.SetAsBox(0.2f * (maxX - minX), 0.01f);
+
+	Entity* entity = world.CreateEntity(pillar, position);
+	REQUIRE(entity);
+	entity->AddGraphics();
+
+	settings.m_ColumnStride = 1;
+	const auto everyColumn = GetDrawnColumns(RenderSoftware(renderer, world, camera, settings));
+
+	REQUIRE(everyColumn[column]);
+
+	settings.m_ColumnStride = stride;
+	const auto strided = GetDrawnColumns(RenderSoftware(renderer, world, camera, settings));
+
+	REQUIRE(renderer.GetStats().m_ColumnsInterpolated > 0);
+	REQUIRE(strided == everyColumn);
+}
+
+TEST_CASE("An opaque wall stops the rays, so nothing behind it is drawn", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	auto AddBox = [&world](const b2Vec2& position, const b2Vec2& halfSize, const bool opaque) {
+		b2PolygonShape box;
+		box.SetAsBox(halfSize.x, halfSize.y);
+		Entity* entity = world.CreateEntity(box, position);
+		REQUIRE(entity);
+		entity->AddGraphics();
+		entity->GetGraphics()->SetOpaque(opaque);
+	};
+
+	// Looking along the y axis, at a wall on the ground, the same height as the box behind it.
+	const Camera3D camera(b2Transform(b2Vec2_zero, b2Rot(0.0f)));
+
+	AddBox(b2Vec2(0.0f, 3.0f), b2Vec2(6.0f, 0.25f), true);
+
+	WorldRaycastRenderer renderer;
+
+	RenderSettings settings;
+
+	RenderSoftware(renderer, world, camera, settings);
+
+	const int wallOnly = renderer.GetStats().m_PrimitiveCount;
+
+	REQUIRE(wallOnly > 0);
+
+	AddBox(b2Vec2(0.0f, 8.0f), b2Vec2(0.5f, 0.5f), false);
+
+	RenderSoftware(renderer, world, camera, settings);
+
+	REQUIRE(renderer.GetStats().m_PrimitiveCount == wallOnly);
+}
+
+TEST_CASE("The column depth buffer has the nearest opaque wall in it", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	// Looking along the y axis, at a wall on the ground 5 metres away.
+	const Camera3D camera(b2Transform(b2Vec2_zero, b2Rot(0.0f)));
+
+	b2PolygonShape box;
+	box.SetAsBox(6.0f, 0.25f);
+	Entity* entity = world.CreateEntity(box, b2Vec2(0.0f, 5.25f));
+	REQUIRE(entity);
+	entity->AddGraphics();
+	entity->GetGraphics()->SetOpaque(true);
+
+	WorldRaycastRenderer renderer;
+
+	RenderSoftware(renderer, world, camera, RenderSettings());
+
+	const ColumnDepthBuffer& columns = renderer.GetColumnDepthBuffer();
+	const int middle = columns.GetWidth() / 2;
+
+	REQUIRE(columns.GetDepth(middle) == Approx(5.0f));
+	REQUIRE(columns.GetTop(middle) < columns.GetHorizon());
+	REQUIRE(columns.GetBottom(middle) > columns.GetHorizon());
+
+	REQUIRE(columns.IsHidden(camera, b2Vec2(0.0f, 10.0f)));
+	REQUIRE(!columns.IsHidden(camera, b2Vec2(0.0f, 3.0f)));
+	REQUIRE(columns.IsHidden(camera, b2Vec2(0.0f, 10.0f), 0.5f));
+}
+
+TEST_CASE("Rendering on several threads gives the same picture as on one", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	AddBoxes(world);
+
+	// Looking along the x axis, at the boxes.
+	const Camera3D camera(b2Transform(b2Vec2_zero, b2Rot(-b2_pi / 2)));
+
+	RenderSettings settings;
+
+	settings.m_ThreadCount = 1;
+	WorldRaycastRenderer serialRenderer;
+	const SoftwareFramebuffer serial = RenderSoftware(serialRenderer, world, camera, settings);
+
+	settings.m_ThreadCount = 4;
+	WorldRaycastRenderer parallelRenderer;
+	const SoftwareFramebuffer parallel = RenderSoftware(parallelRenderer, world, camera, settings);
+
+	REQUIRE(serialRenderer.GetStats().m_PrimitiveCount > 0);
+	REQUIRE(parallelRenderer.GetStats().m_PrimitiveCount == serialRenderer.GetStats().m_PrimitiveCount);
+
+	const auto pixelCount = serial.GetWidth() * serial.GetHeight() * 4;
+
+	REQUIRE(std::equal(serial.GetPixels(), serial.GetPixels() + pixelCount, parallel.GetPixels()));
+}
+
+TEST_CASE("Casting past the static geometry grid gives the same picture as casting through the World", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	AddBoxes(world);
+
+	// And one that isn't in the grid.
+	b2PolygonShape box;
+	box.SetAsBox(0.25f, 0.25f);
+	Entity* entity = world.CreateEntity(box, b2Vec2(6.0f, 1.0f));
+	REQUIRE(entity);
+	entity->AddGraphics();
+
+	b2Body& body = entity->GetPhysics()->GetBody();
+	body.SetType(b2_dynamicBody);
+	world.OnStaticGeometryChanged(body);
+
+	REQUIRE(!world.GetStaticGeometry().Contains(body));
+
+	world.ComputePotentiallyVisibleSets();
+
+	// Looking along the x axis, at the boxes.
+	const Camera3D camera(b2Transform(b2Vec2(1.0f, 0.0f), b2Rot(-b2_pi / 2)));
+
+	RenderSettings settings;
+	settings.m_ReuseColumns = false;
+	settings.m_UseStaticGeometryGrid = false;
+	settings.m_UsePotentiallyVisibleSets = false;
+
+	WorldRaycastRenderer worldRenderer;
+	const SoftwareFramebuffer expected = RenderSoftware(worldRenderer, world, camera, settings);
+
+	REQUIRE(worldRenderer.GetStats().m_PrimitiveCount > 0);
+
+	const auto pixelCount = expected.GetWidth() * expected.GetHeight() * 4;
+
+	auto RequireSamePicture = [&](const RenderSettings& settings) {
+		WorldRaycastRenderer renderer;
+
+		// Twice, since what's kept from the first frame gets used for the second.
+		for (int frame = 0; frame < 2; frame++) {
+			const SoftwareFramebuffer picture = RenderSoftware(renderer, world, camera, settings);
+
+			REQUIRE(renderer.GetStats().m_PrimitiveCount == worldRenderer.GetStats().m_PrimitiveCount);
+			REQUIRE(std::equal(expected.GetPixels(), expected.GetPixels() + pixelCount, picture.GetPixels()));
+		}
+
+		return renderer.GetStats();
+	};
+
+	settings.m_UseStaticGeometryGrid = true;
+
+	SECTION("With the grid") {
+		RequireSamePicture(settings);
+	}
+
+	SECTION("With the potentially visible sets") {
+		settings.m_UsePotentiallyVisibleSets = true;
+
+		REQUIRE(RequireSamePicture(settings).m_PotentiallyVisibleFixtures > 0);
+	}
+
+	SECTION("Culled to the view") {
+		settings.m_UsePotentiallyVisibleSets = true;
+		settings.m_CullToView = true;
+
+		REQUIRE(RequireSamePicture(settings).m_FixturesInView > 0);
+	}
+}
+
+TEST_CASE("Rendering a RenderSnapshot gives the same picture as rendering the World", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	AddBoxes(world);
+
+	// And one that moves about in front of them.
+	b2PolygonShape box;
+	box.SetAsBox(0.25f, 0.25f);
+	Entity* entity = world.CreateEntity(box, b2Vec2(3.0f, 0.0f));
+	REQUIRE(entity);
+	entity->AddGraphics();
+
+	b2Body& body = entity->GetPhysics()->GetBody();
+	body.SetType(b2_dynamicBody);
+	world.OnStaticGeometryChanged(body);
+
+	// Looking along the x axis, at the boxes.
+	const Camera3D camera(b2Transform(b2Vec2(1.0f, 0.0f), b2Rot(-b2_pi / 2)));
+
+	RenderSettings settings;
+
+	// The World isn't told when the box is moved, so it can't reuse columns.
+	RenderSettings worldSettings = settings;
+	worldSettings.m_ReuseColumns = false;
+
+	WorldRaycastRenderer worldRenderer;
+
+	// Taking turns, like pipelined rendering does, each with a renderer of its own.
+	RenderSnapshot snapshots[2];
+	WorldRaycastRenderer snapshotRenderers[2];
+
+	for (int frame = 0; frame < 4; frame++) {
+		body.SetTransform(b2Vec2(3.0f, -0.5f + 0.25f * frame), 0.0f);
+
+		RenderSnapshot& snapshot = snapshots[frame % 2];
+		WorldRaycastRenderer& snapshotRenderer = snapshotRenderers[frame % 2];
+
+		snapshot.Capture(world, camera);
+
+		REQUIRE(snapshot.GetRaycastScene().m_StaticGeometry);
+		REQUIRE(snapshot.GetRaycastScene().m_StaticGeometry->GetBodyCount() == 4);
+
+		const SoftwareFramebuffer expected = RenderSoftware(worldRenderer, world, camera, worldSettings);
+
+		SoftwareFramebuffer picture;
+		picture.Resize(expected.GetWidth(), expected.GetHeight());
+		snapshotRenderer.Render(snapshot.GetRaycastScene(), camera, settings, picture);
+
+		REQUIRE(worldRenderer.GetStats().m_PrimitiveCount > 0);
+		REQUIRE(snapshotRenderer.GetStats().m_PrimitiveCount == worldRenderer.GetStats().m_PrimitiveCount);
+
+		const auto pixelCount = expected.GetWidth() * expected.GetHeight() * 4;
+
+		REQUIRE(std::equal(expected.GetPixels(), expected.GetPixels() + pixelCount, picture.GetPixels()));
+
+		// Only the columns the box has moved through need casting again.
+		if (frame >= 2) {
+			REQUIRE(snapshotRenderer.GetStats().m_ColumnsCast > 0);
+			REQUIRE(snapshotRenderer.GetStats().m_ColumnsCast < expected.GetWidth());
+		}
+	}
+}
+
+TEST_CASE("Bodies are drawn where the render interpolation says, and left where the step put them", "[Graphics]") {
+	qvr::InitLoggers(spdlog::level::off);
+
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.25f, 0.25f);
+
+	// A box that moves across in front of the others.
+	World world(worldContext);
+
+	AddBoxes(world);
+
+	Entity* entity = world.CreateEntity(box, b2Vec2(3.0f, -0.5f));
+	REQUIRE(entity);
+	entity->AddGraphics();
+
+	b2Body& body = entity->GetPhysics()->GetBody();
+	body.SetType(b2_dynamicBody);
+	body.SetLinearVelocity(b2Vec2(0.0f, 30.0f));
+	body.SetAngularVelocity(6.0f);
+	world.OnStaticGeometryChanged(body);
+
+	Mouse mouse;
+	NoKeyboard keyboard;
+	NoJoysticks joysticks;
+
+	RawInputDevices devices(mouse, keyboard, joysticks);
+
+	const b2Transform previous = body.GetTransform();
+
+	world.TakeStep(devices);
+
+	const b2Transform current = body.GetTransform();
+
+	REQUIRE(!(previous.p == current.p));
+
+	world.SetRenderInterpolation(0.5f);
+
+	// The body itself hasn't been touched.
+	REQUIRE(body.GetTransform().p == current.p);
+	REQUIRE(body.GetTransform().q.s == current.q.s);
+	REQUIRE(body.GetTransform().q.c == current.q.c);
+
+	REQUIRE(world.GetDrawnTransforms().size() == 1);
+	REQUIRE(world.GetDrawnTransforms()[0].m_Body == &body);
+
+	const b2Transform drawn = world.GetDrawnTransforms()[0].m_Transform;
+
+	REQUIRE(drawn.p.x == Approx(0.5f * (previous.p.x + current.p.x)));
+	REQUIRE(drawn.p.y == Approx(0.5f * (previous.p.y + current.p.y)));
+	REQUIRE(drawn.q.GetAngle() == Approx(0.5f * (previous.q.GetAngle() + current.q.GetAngle())));
+
+	// The same boxes, with the moving one placed where it's drawn.
+	World placed(worldContext);
+
+	AddBoxes(placed);
+
+	Entity* placedEntity = placed.CreateEntity(box, drawn.p, drawn.q.GetAngle());
+	REQUIRE(placedEntity);
+	placedEntity->AddGraphics();
+
+	b2Body& placedBody = placedEntity->GetPhysics()->GetBody();
+	placedBody.SetType(b2_dynamicBody);
+	placed.OnStaticGeometryChanged(placedBody);
+
+	const Camera3D camera(b2Transform(b2Vec2(1.0f, 0.0f), b2Rot(-b2_pi / 2)));
+
+	RenderSettings settings;
+
+	WorldRaycastRenderer placedRenderer;
+	const SoftwareFramebuffer expected = RenderSoftware(placedRenderer, placed, camera, settings);
+
+	SECTION("Rendering the World") {
+		WorldRaycastRenderer renderer;
+
+		REQUIRE(SamePicture(RenderSoftware(renderer, world, camera, settings), expected));
+	}
+
+	SECTION("Rendering a RenderSnapshot") {
+		RenderSnapshot snapshot;
+		snapshot.Capture(world, camera);
+
+		REQUIRE(body.GetTransform().p == current.p);
+
+		SoftwareFramebuffer picture;
+		picture.Resize(expected.GetWidth(), expected.GetHeight());
+
+		WorldRaycastRenderer renderer;
+		renderer.Render(snapshot.GetRaycastScene(), camera, settings, picture);
+
+		REQUIRE(SamePicture(picture, expected));
+	}
+
+	SECTION("Without interpolation, bodies are drawn where they are") {
+		world.SetRenderInterpolation(1.0f);
+
+		REQUIRE(world.GetDrawnTransforms().empty());
+
+		placedBody.SetTransform(current.p, current.q.GetAngle());
+		placed.OnStaticGeometryChanged(placedBody);
+
+		// Told nothing about the move, so it mustn't reuse columns.
+		RenderSettings placedSettings = settings;
+		placedSettings.m_ReuseColumns = false;
+
+		WorldRaycastRenderer renderer;
+
+		REQUIRE(SamePicture(
+			RenderSoftware(renderer, world, camera, settings), 
+			RenderSoftware(placedRenderer, placed, camera, placedSettings)));
+	}
+}
+
+// These need an OpenGL context, so they're hidden by default. They only use OpenGL 1.1 
+// vertex arrays and GLSL 1.30, so a software implementation will do (e.g. Mesa's llvmpipe, 
+// with LIBGL_ALWAYS_SOFTWARE=1).
+
+TEST_CASE("Merged front faces look the same as lines", "[.][GL][Graphics]") {
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	AddBoxes(world);
+
+	WorldRaycastRenderer renderer;
+
+	// Looking along the x axis, at the boxes.
+	const Camera3D camera(b2Transform(b2Vec2_zero, b2Rot(-b2_pi / 2)));
+
+	RenderSettings settings;
+
+	settings.m_MergeFrontFaces = false;
+	const sf::Image lines = Render(renderer, world, camera, settings);
+
+	settings.m_MergeFrontFaces = true;
+	const sf::Image quads = Render(renderer, world, camera, settings);
+
+	const int pixelCount = (int)(lines.getSize().x * lines.getSize().y);
+
+	// Merging isn't exact, so neither is this. MergeFrontFaces fits one quad to a run of 
+	// columns as long as each column's top and bottom are within a quarter of a pixel of 
+	// the quad's edges (a pixel, in the far field), and its texture coordinate within a 
+	// quarter of a texel (a texel). So along a face's top and bottom edges, a pixel can be 
+	// covered by one and not the other, and where a column lands near the boundary between 
+	// two texels it can pick a different one. The quad's fog is also interpolated between 
+	// its corners rather than worked out for each column, which can be a shade or two out.
+	// Demanding an exact fit would leave almost nothing merged, since columns' values are 
+	// rounded floats that never lie exactly on a line.
+	const int colorTolerance = 8;
+	REQUIRE(CountDifferentPixels(lines, quads, colorTolerance) < pixelCount / 100);
+}
+
+TEST_CASE("Raycast drawables are drawn in batches", "[.][GL][Graphics]") {
+	CustomComponentTypeLibrary types;
+	FixtureFilterBitNames filterBitNames;
+
+	WorldContext worldContext(types, filterBitNames);
+
+	World world(worldContext);
+
+	AddBoxes(world);
+
+	WorldRaycastRenderer renderer;
+
+	RenderSettings settings;
+	settings.m_MergeFrontFaces = false;
+
+	// Looking along the x axis, at the boxes.
+	Render(renderer, world, Camera3D(b2Transform(b2Vec2_zero, b2Rot(-b2_pi / 2))), settings);
+
+	const RaycastRenderStats& stats = renderer.GetStats();
+
+	REQUIRE(stats.m_PrimitiveCount > 0);
+	REQUIRE(stats.m_DrawCalls == stats.m_BatchCount);
+	// Every box uses the same (default) texture, so there's at most one batch per layer.
+	REQUIRE(stats.m_DrawCalls < stats.m_PrimitiveCount / 10);
+	REQUIRE(stats.m_TextureChanges <= stats.m_DrawCalls);
+}